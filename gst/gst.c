@@ -159,6 +159,119 @@ GSList *_priv_gst_preload_plugins = NULL;
 
 const gchar g_log_domain_gstreamer[] = "GStreamer";
 
+/* the enum and flags types of the core. They are registered in gst_init() so
+ * that they can be looked up by name, their classes are only created when
+ * they are first used. */
+static GType (*const core_enum_types[]) (void) = {
+  gst_object_flags_get_type,
+  gst_bin_flags_get_type,
+  gst_buffer_flag_get_type,
+  gst_buffer_copy_flags_get_type,
+  gst_buffer_list_item_get_type,
+  gst_bus_flags_get_type,
+  gst_bus_sync_reply_get_type,
+  gst_caps_flags_get_type,
+  gst_clock_return_get_type,
+  gst_clock_entry_type_get_type,
+  gst_clock_flags_get_type,
+  gst_clock_type_get_type,
+  gst_debug_graph_details_get_type,
+  gst_state_get_type,
+  gst_state_change_return_get_type,
+  gst_state_change_get_type,
+  gst_element_flags_get_type,
+  gst_core_error_get_type,
+  gst_library_error_get_type,
+  gst_resource_error_get_type,
+  gst_stream_error_get_type,
+  gst_event_type_flags_get_type,
+  gst_event_type_get_type,
+  gst_seek_type_get_type,
+  gst_seek_flags_get_type,
+  gst_format_get_type,
+  gst_index_certainty_get_type,
+  gst_index_entry_type_get_type,
+  gst_index_lookup_method_get_type,
+  gst_assoc_flags_get_type,
+  gst_index_resolver_method_get_type,
+  gst_index_flags_get_type,
+  gst_debug_level_get_type,
+  gst_debug_color_flags_get_type,
+  gst_iterator_result_get_type,
+  gst_iterator_item_get_type,
+  gst_message_type_get_type,
+  gst_mini_object_flags_get_type,
+  gst_pad_link_return_get_type,
+  gst_pad_link_check_get_type,
+  gst_flow_return_get_type,
+  gst_activate_mode_get_type,
+  gst_pad_direction_get_type,
+  gst_pad_flags_get_type,
+  gst_pad_presence_get_type,
+  gst_pad_template_flags_get_type,
+  gst_pipeline_flags_get_type,
+  gst_plugin_error_get_type,
+  gst_plugin_flags_get_type,
+  gst_plugin_dependency_flags_get_type,
+  gst_rank_get_type,
+  gst_query_type_get_type,
+  gst_buffering_mode_get_type,
+  gst_stream_status_type_get_type,
+  gst_structure_change_type_get_type,
+  gst_tag_merge_mode_get_type,
+  gst_tag_flag_get_type,
+  gst_task_pool_get_type,
+  gst_task_state_get_type,
+  gst_alloc_trace_flags_get_type,
+  gst_type_find_probability_get_type,
+  gst_uri_type_get_type,
+  gst_parse_error_get_type,
+  gst_parse_flags_get_type,
+  gst_search_mode_get_type,
+};
+
+/* GST_INIT_TRACE: the time at the end of each step of gst_init() */
+#define INIT_TRACE_MAX_MARKS 16
+
+typedef struct
+{
+  const gchar *step;
+  GstClockTime time;
+} InitTraceMark;
+
+static gboolean init_trace = FALSE;
+static InitTraceMark init_trace_marks[INIT_TRACE_MAX_MARKS];
+static guint init_trace_n_marks = 0;
+
+static void
+init_trace_mark (const gchar * step)
+{
+  if (G_LIKELY (!init_trace) || init_trace_n_marks == INIT_TRACE_MAX_MARKS)
+    return;
+
+  init_trace_marks[init_trace_n_marks].step = step;
+  init_trace_marks[init_trace_n_marks].time = gst_util_get_timestamp ();
+  init_trace_n_marks++;
+}
+
+static void
+init_trace_print (void)
+{
+  guint i;
+
+  if (G_LIKELY (!init_trace) || init_trace_n_marks == 0)
+    return;
+
+  for (i = 1; i < init_trace_n_marks; i++) {
+    g_printerr ("gst_init: %-12s %" GST_TIME_FORMAT "\n",
+        init_trace_marks[i].step, GST_TIME_ARGS (init_trace_marks[i].time -
+            init_trace_marks[i - 1].time));
+  }
+  g_printerr ("gst_init: %-12s %" GST_TIME_FORMAT "\n", "total",
+      GST_TIME_ARGS (init_trace_marks[init_trace_n_marks - 1].time -
+          init_trace_marks[0].time));
+}
+
 static void
 debug_log_handler (const gchar * log_domain,
     GLogLevelFlags log_level, const gchar * message, gpointer user_data)
@@ -556,6 +669,9 @@ init_pre (GOptionContext * context, GOptionGroup * group, gpointer data,
     return TRUE;
   }
 
+  init_trace = g_getenv ("GST_INIT_TRACE") != NULL;
+  init_trace_mark ("start");
+
   /* GStreamer was built against a GLib >= 2.8 and is therefore not doing
    * the refcount hack. Check that it isn't being run against an older GLib */
   if (glib_major_version < 2 ||
@@ -567,6 +683,7 @@ init_pre (GOptionContext * context, GOptionGroup * group, gpointer data,
   }
 
   g_type_init ();
+  init_trace_mark ("gtype");
 
   /* we need threading to be enabled right here */
   g_assert (g_thread_get_initialized ());
@@ -594,6 +711,7 @@ init_pre (GOptionContext * context, GOptionGroup * group, gpointer data,
 
   priv_gst_dump_dot_dir = g_getenv ("GST_DEBUG_DUMP_DOT_DIR");
 #endif
+  init_trace_mark ("debug");
   /* This is the earliest we can make stuff show up in the logs.
    * So give some useful info about GStreamer here */
   GST_INFO ("Initializing GStreamer Core Library version %s", VERSION);
@@ -645,6 +763,7 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
     GError ** error)
 {
   GLogLevelFlags llf;
+  guint i;
 
 #ifndef GST_DISABLE_TRACE
   GstTrace *gst_trace;
@@ -655,10 +774,13 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
     return TRUE;
   }
 
+  init_trace_mark ("options");
+
   llf = G_LOG_LEVEL_CRITICAL | G_LOG_LEVEL_ERROR | G_LOG_FLAG_FATAL;
   g_log_set_handler (g_log_domain_gstreamer, llf, debug_log_handler, NULL);
 
   _priv_gst_quarks_initialize ();
+  init_trace_mark ("quarks");
   _gst_format_initialize ();
   _gst_query_initialize ();
   g_type_class_ref (gst_object_get_type ());
@@ -673,72 +795,11 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
 
   g_type_class_ref (gst_index_factory_get_type ());
   gst_uri_handler_get_type ();
+  init_trace_mark ("classes");
 
-  g_type_class_ref (gst_object_flags_get_type ());
-  g_type_class_ref (gst_bin_flags_get_type ());
-  g_type_class_ref (gst_buffer_flag_get_type ());
-  g_type_class_ref (gst_buffer_copy_flags_get_type ());
-  g_type_class_ref (gst_buffer_list_item_get_type ());
-  g_type_class_ref (gst_bus_flags_get_type ());
-  g_type_class_ref (gst_bus_sync_reply_get_type ());
-  g_type_class_ref (gst_caps_flags_get_type ());
-  g_type_class_ref (gst_clock_return_get_type ());
-  g_type_class_ref (gst_clock_entry_type_get_type ());
-  g_type_class_ref (gst_clock_flags_get_type ());
-  g_type_class_ref (gst_clock_type_get_type ());
-  g_type_class_ref (gst_debug_graph_details_get_type ());
-  g_type_class_ref (gst_state_get_type ());
-  g_type_class_ref (gst_state_change_return_get_type ());
-  g_type_class_ref (gst_state_change_get_type ());
-  g_type_class_ref (gst_element_flags_get_type ());
-  g_type_class_ref (gst_core_error_get_type ());
-  g_type_class_ref (gst_library_error_get_type ());
-  g_type_class_ref (gst_resource_error_get_type ());
-  g_type_class_ref (gst_stream_error_get_type ());
-  g_type_class_ref (gst_event_type_flags_get_type ());
-  g_type_class_ref (gst_event_type_get_type ());
-  g_type_class_ref (gst_seek_type_get_type ());
-  g_type_class_ref (gst_seek_flags_get_type ());
-  g_type_class_ref (gst_format_get_type ());
-  g_type_class_ref (gst_index_certainty_get_type ());
-  g_type_class_ref (gst_index_entry_type_get_type ());
-  g_type_class_ref (gst_index_lookup_method_get_type ());
-  g_type_class_ref (gst_assoc_flags_get_type ());
-  g_type_class_ref (gst_index_resolver_method_get_type ());
-  g_type_class_ref (gst_index_flags_get_type ());
-  g_type_class_ref (gst_debug_level_get_type ());
-  g_type_class_ref (gst_debug_color_flags_get_type ());
-  g_type_class_ref (gst_iterator_result_get_type ());
-  g_type_class_ref (gst_iterator_item_get_type ());
-  g_type_class_ref (gst_message_type_get_type ());
-  g_type_class_ref (gst_mini_object_flags_get_type ());
-  g_type_class_ref (gst_pad_link_return_get_type ());
-  g_type_class_ref (gst_pad_link_check_get_type ());
-  g_type_class_ref (gst_flow_return_get_type ());
-  g_type_class_ref (gst_activate_mode_get_type ());
-  g_type_class_ref (gst_pad_direction_get_type ());
-  g_type_class_ref (gst_pad_flags_get_type ());
-  g_type_class_ref (gst_pad_presence_get_type ());
-  g_type_class_ref (gst_pad_template_flags_get_type ());
-  g_type_class_ref (gst_pipeline_flags_get_type ());
-  g_type_class_ref (gst_plugin_error_get_type ());
-  g_type_class_ref (gst_plugin_flags_get_type ());
-  g_type_class_ref (gst_plugin_dependency_flags_get_type ());
-  g_type_class_ref (gst_rank_get_type ());
-  g_type_class_ref (gst_query_type_get_type ());
-  g_type_class_ref (gst_buffering_mode_get_type ());
-  g_type_class_ref (gst_stream_status_type_get_type ());
-  g_type_class_ref (gst_structure_change_type_get_type ());
-  g_type_class_ref (gst_tag_merge_mode_get_type ());
-  g_type_class_ref (gst_tag_flag_get_type ());
-  g_type_class_ref (gst_task_pool_get_type ());
-  g_type_class_ref (gst_task_state_get_type ());
-  g_type_class_ref (gst_alloc_trace_flags_get_type ());
-  g_type_class_ref (gst_type_find_probability_get_type ());
-  g_type_class_ref (gst_uri_type_get_type ());
-  g_type_class_ref (gst_parse_error_get_type ());
-  g_type_class_ref (gst_parse_flags_get_type ());
-  g_type_class_ref (gst_search_mode_get_type ());
+  for (i = 0; i < G_N_ELEMENTS (core_enum_types); i++)
+    core_enum_types[i] ();
+  init_trace_mark ("types");
 
   gst_structure_get_type ();
   _gst_value_initialize ();
@@ -749,6 +810,7 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
   _gst_buffer_list_initialize ();
   _gst_message_initialize ();
   _gst_tag_initialize ();
+  init_trace_mark ("values");
 
   _gst_plugin_initialize ();
 
@@ -759,6 +821,7 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
       "staticelements", "core elements linked into the GStreamer library",
       gst_register_core_elements, VERSION, GST_LICENSE, PACKAGE,
       GST_PACKAGE_NAME, GST_PACKAGE_ORIGIN);
+  init_trace_mark ("plugins");
 
   /*
    * Any errors happening below this point are non-fatal, we therefore mark
@@ -773,6 +836,8 @@ init_post (GOptionContext * context, GOptionGroup * group, gpointer data,
 
   if (!gst_update_registry ())
     return FALSE;
+  init_trace_mark ("registry");
+  init_trace_print ();
 
 #ifndef GST_DISABLE_TRACE
   _gst_trace_on = 0;
@@ -1022,6 +1087,8 @@ gst_deinit (void)
   gst_object_unref (clock);
   gst_object_unref (clock);
 
+  _priv_gst_buffer_cleanup ();
+  _priv_gst_uri_cleanup ();
   _priv_gst_registry_cleanup ();
 
   g_type_class_unref (g_type_class_peek (gst_object_get_type ()));
@@ -1033,74 +1100,6 @@ gst_deinit (void)
   g_type_class_unref (g_type_class_peek (gst_bus_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_task_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_index_factory_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_object_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_bin_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_buffer_flag_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_buffer_copy_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_buffer_list_item_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_bus_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_bus_sync_reply_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_caps_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_clock_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_clock_return_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_clock_entry_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_clock_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_debug_graph_details_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_state_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_state_change_return_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_state_change_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_element_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_core_error_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_library_error_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_plugin_dependency_flags_get_type
-          ()));
-  g_type_class_unref (g_type_class_peek (gst_parse_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_resource_error_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_search_mode_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_stream_error_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_stream_status_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_structure_change_type_get_type
-          ()));
-  g_type_class_unref (g_type_class_peek (gst_event_type_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_event_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_seek_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_seek_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_format_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_index_certainty_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_index_entry_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_index_lookup_method_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_assoc_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_index_resolver_method_get_type
-          ()));
-  g_type_class_unref (g_type_class_peek (gst_index_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_debug_level_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_debug_color_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_iterator_result_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_iterator_item_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_message_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_mini_object_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pad_link_return_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pad_link_check_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_flow_return_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_activate_mode_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pad_direction_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pad_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pad_presence_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pad_template_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_pipeline_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_plugin_error_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_plugin_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_rank_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_query_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_buffering_mode_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_tag_merge_mode_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_tag_flag_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_task_state_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_alloc_trace_flags_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_type_find_probability_get_type
-          ()));
-  g_type_class_unref (g_type_class_peek (gst_uri_type_get_type ()));
-  g_type_class_unref (g_type_class_peek (gst_parse_error_get_type ()));
   g_type_class_unref (g_type_class_peek (gst_param_spec_fraction_get_type ()));
 
   gst_deinitialized = TRUE;
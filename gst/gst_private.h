@@ -106,8 +106,18 @@ void  _gst_value_initialize (void);
 /* Private registry functions */
 gboolean _priv_gst_registry_remove_cache_plugins (GstRegistry *registry);
 void _priv_gst_registry_cleanup (void);
+void _priv_gst_registry_keep_mapping (GMappedFile * mapped);
+gboolean _priv_gst_registry_is_mapped (gconstpointer mem);
+void _priv_gst_uri_cleanup (void);
+void _priv_gst_buffer_cleanup (void);
 gboolean _gst_plugin_loader_client_run (void);
 
+/* strings loaded from a mapped registry cache are referenced in place */
+#define _priv_gst_registry_free_string(s) G_STMT_START {   \
+  if (!_priv_gst_registry_is_mapped (s))                    \
+    g_free (s);                                             \
+} G_STMT_END
+
 /* used in both gststructure.c and gstcaps.c; numbers are completely made up */
 #define STRUCTURE_ESTIMATED_STRING_LEN(s) (16 + (s)->fields->len * 22)
 
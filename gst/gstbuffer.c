@@ -133,6 +133,70 @@ static GstBuffer *_gst_buffer_copy (GstBuffer * buffer);
 
 static GType _gst_buffer_type = 0;
 
+/* Buffers are created and dropped at a high rate, mostly by one streaming
+ * thread that allocates them and another one after a queue that releases
+ * them. Finalized plain buffer instances are recycled into a small cache
+ * owned by the thread that created them, so that the instance memory and its
+ * refcount stay local to that thread.
+ *
+ * The owner pushes and pops its own free list without locking. A thread that
+ * releases a buffer of another thread pushes it on the lock-free return stack
+ * of the owning cache, which the owner takes over as a whole once its own free
+ * list runs empty. Cached buffers hold one reference and are chained through
+ * their (unused) parent field, the owning cache is kept in the private data
+ * of the buffer.
+ *
+ * A buffer is recycled from its finalizer, while gst_mini_object_free() still
+ * holds a reference that it drops after finalize. The owner could pop a
+ * returned buffer before that happens, so a releasing thread parks the buffer
+ * in its own cache and only returns it to the owner on its next release, when
+ * its refcount is back to the one reference of the cache. */
+#define BUFFER_CACHE_MAX 64
+
+typedef struct _GstBufferCache GstBufferCache;
+
+struct _GstBufferCache
+{
+  /* only used by the owning thread */
+  GstBuffer *free;
+  guint n_free;
+
+  /* pushed by other threads, taken as a whole by the owner */
+  volatile gpointer returned;
+  volatile gint n_returned;
+
+  /* a buffer of another cache released by this thread, returned to its owner
+   * on the next release */
+  GstBuffer *pending;
+
+  GstBufferCache *next;
+};
+
+typedef struct _GstBufferPrivate GstBufferPrivate;
+
+struct _GstBufferPrivate
+{
+  /* the cache that created the buffer */
+  GstBufferCache *cache;
+};
+
+/* plain buffers all have their private data at the same offset, it is looked
+ * up once in _gst_buffer_initialize(). Only valid for plain buffers. */
+static gssize buffer_private_offset = 0;
+
+#define BUFFER_CACHE(buf) \
+  (((GstBufferPrivate *) ((guint8 *) (buf) + buffer_private_offset))->cache)
+
+static GStaticPrivate buffer_cache_key = G_STATIC_PRIVATE_INIT;
+
+/* buffers keep a pointer to their cache after the owning thread exited, so
+ * caches are never freed before _priv_gst_buffer_cleanup(). The caches of
+ * exited threads are handed to the next new thread. */
+G_LOCK_DEFINE_STATIC (buffer_caches);
+static GstBufferCache *buffer_caches = NULL;
+static GSList *orphaned_caches = NULL;
+static gboolean buffer_caches_closed = FALSE;
+
 /* buffer alignment in bytes
  * an alignment of 8 would be the same as malloc() guarantees
  */
@@ -161,10 +225,19 @@ aligned_malloc (gpointer * memptr, guint size)
 void
 _gst_buffer_initialize (void)
 {
+  GstMiniObject *buffer;
+
   /* the GstMiniObject types need to be class_ref'd once before it can be
    * done from multiple threads;
    * see http://bugzilla.gnome.org/show_bug.cgi?id=304551 */
   g_type_class_ref (gst_buffer_get_type ());
+
+  /* looking up the private data of every buffer would take a global lock in
+   * GType, so remember where it is instead */
+  buffer = gst_mini_object_new (_gst_buffer_type);
+  buffer_private_offset = (guint8 *) G_TYPE_INSTANCE_GET_PRIVATE (buffer,
+      _gst_buffer_type, GstBufferPrivate) - (guint8 *) buffer;
+  gst_mini_object_unref (buffer);
 #ifdef HAVE_GETPAGESIZE
 #ifdef BUFFER_ALIGNMENT_PAGESIZE
   _gst_buffer_data_alignment = getpagesize ();
@@ -172,6 +245,196 @@ _gst_buffer_initialize (void)
 #endif
 }
 
+static void
+buffer_cache_free_list (GstBuffer * buffer)
+{
+  while (buffer) {
+    GstBuffer *next = buffer->parent;
+
+    buffer->parent = NULL;
+    gst_buffer_unref (buffer);
+    buffer = next;
+  }
+}
+
+void
+_priv_gst_buffer_cleanup (void)
+{
+  GstBufferCache *caches;
+
+  G_LOCK (buffer_caches);
+  caches = buffer_caches;
+  buffer_caches = NULL;
+  g_slist_free (orphaned_caches);
+  orphaned_caches = NULL;
+  buffer_caches_closed = TRUE;
+  G_UNLOCK (buffer_caches);
+
+  while (caches) {
+    GstBufferCache *next = caches->next;
+
+    buffer_cache_free_list (caches->free);
+    buffer_cache_free_list ((GstBuffer *) caches->returned);
+    buffer_cache_free_list (caches->pending);
+    g_slice_free (GstBufferCache, caches);
+    caches = next;
+  }
+}
+
+/* called when a thread with a cache exits */
+static void
+buffer_cache_orphan (GstBufferCache * cache)
+{
+  G_LOCK (buffer_caches);
+  /* after cleanup the cache is gone already */
+  if (!buffer_caches_closed)
+    orphaned_caches = g_slist_prepend (orphaned_caches, cache);
+  G_UNLOCK (buffer_caches);
+}
+
+/* returns the cache of the calling thread, creating or adopting one when
+ * needed, or NULL after cleanup */
+static inline GstBufferCache *
+buffer_cache_get (void)
+{
+  GstBufferCache *cache;
+
+  if (G_UNLIKELY (buffer_caches_closed))
+    return NULL;
+
+  cache = g_static_private_get (&buffer_cache_key);
+  if (G_UNLIKELY (cache == NULL)) {
+    G_LOCK (buffer_caches);
+    if (buffer_caches_closed) {
+      G_UNLOCK (buffer_caches);
+      return NULL;
+    }
+    if (orphaned_caches) {
+      cache = orphaned_caches->data;
+      orphaned_caches = g_slist_delete_link (orphaned_caches, orphaned_caches);
+    } else {
+      cache = g_slice_new0 (GstBufferCache);
+      cache->next = buffer_caches;
+      buffer_caches = cache;
+    }
+    G_UNLOCK (buffer_caches);
+
+    g_static_private_set (&buffer_cache_key, cache,
+        (GDestroyNotify) buffer_cache_orphan);
+  }
+  return cache;
+}
+
+/* returns a recycled buffer instance of @cache with one reference and all
+ * fields reset, or NULL when the cache is empty */
+static inline GstBuffer *
+buffer_cache_pop (GstBufferCache * cache)
+{
+  GstBuffer *buffer;
+
+  if (G_UNLIKELY (cache->free == NULL)) {
+    guint n = 0;
+
+    if (g_atomic_pointer_get (&cache->returned) == NULL)
+      return NULL;
+
+    /* take over everything other threads gave back */
+    do {
+      buffer = g_atomic_pointer_get (&cache->returned);
+    } while (!g_atomic_pointer_compare_and_exchange (&cache->returned, buffer,
+            NULL));
+
+    cache->free = buffer;
+    for (; buffer; buffer = buffer->parent)
+      n++;
+    cache->n_free = n;
+    g_atomic_int_add (&cache->n_returned, -(gint) n);
+  }
+
+  buffer = cache->free;
+  cache->free = buffer->parent;
+  cache->n_free--;
+
+  /* only the reference of the cache is left */
+  g_assert (GST_MINI_OBJECT_REFCOUNT_VALUE (buffer) == 1);
+
+  GST_BUFFER_FLAGS (buffer) = 0;
+  GST_BUFFER_DATA (buffer) = NULL;
+  GST_BUFFER_SIZE (buffer) = 0;
+  GST_BUFFER_TIMESTAMP (buffer) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_DURATION (buffer) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_OFFSET (buffer) = GST_BUFFER_OFFSET_NONE;
+  GST_BUFFER_OFFSET_END (buffer) = GST_BUFFER_OFFSET_NONE;
+  GST_BUFFER_MALLOCDATA (buffer) = NULL;
+  GST_BUFFER_FREE_FUNC (buffer) = g_free;
+  buffer->parent = NULL;
+
+  return buffer;
+}
+
+/* push @buffer, which holds one reference for the cache, on the return stack
+ * of @owner. Returns FALSE when @owner has enough buffers already. */
+static inline gboolean
+buffer_cache_return (GstBufferCache * owner, GstBuffer * buffer)
+{
+  gpointer head;
+
+  /* the count is only a hint, a few buffers more don't matter */
+  if (g_atomic_int_get (&owner->n_returned) >= BUFFER_CACHE_MAX)
+    return FALSE;
+
+  g_atomic_int_inc (&owner->n_returned);
+  do {
+    head = g_atomic_pointer_get (&owner->returned);
+    buffer->parent = head;
+  } while (!g_atomic_pointer_compare_and_exchange (&owner->returned, head,
+          buffer));
+
+  return TRUE;
+}
+
+/* called from finalize, takes a new reference to @buffer when it was
+ * recycled so that the instance is not freed */
+static inline void
+buffer_cache_push (GstBuffer * buffer)
+{
+  GstBufferCache *owner, *cache;
+  GstBuffer *pending;
+
+  if (G_UNLIKELY ((cache = buffer_cache_get ()) == NULL))
+    return;
+
+  /* the previously released buffer is not referenced by its
+   * gst_mini_object_free() anymore, hand it to its owner now */
+  if (G_UNLIKELY ((pending = cache->pending) != NULL)) {
+    cache->pending = NULL;
+    if (!buffer_cache_return (BUFFER_CACHE (pending), pending)) {
+      /* the owner has enough, release it again as a buffer of this cache */
+      BUFFER_CACHE (pending) = cache;
+      gst_buffer_unref (pending);
+    }
+  }
+
+  owner = BUFFER_CACHE (buffer);
+  if (G_UNLIKELY (owner == NULL)) {
+    /* created with gst_mini_object_new(), adopt it */
+    owner = BUFFER_CACHE (buffer) = cache;
+  }
+
+  if (owner == cache) {
+    if (cache->n_free >= BUFFER_CACHE_MAX)
+      return;
+
+    gst_buffer_ref (buffer);
+    buffer->parent = cache->free;
+    cache->free = buffer;
+    cache->n_free++;
+  } else {
+    gst_buffer_ref (buffer);
+    cache->pending = buffer;
+  }
+}
+
 #define _do_init \
 { \
   _gst_buffer_type = g_define_type_id; \
@@ -182,6 +445,8 @@ G_DEFINE_TYPE_WITH_CODE (GstBuffer, gst_buffer, GST_TYPE_MINI_OBJECT, _do_init);
 static void
 gst_buffer_class_init (GstBufferClass * klass)
 {
+  g_type_class_add_private (klass, sizeof (GstBufferPrivate));
+
   klass->mini_object_class.copy = (GstMiniObjectCopyFunction) _gst_buffer_copy;
   klass->mini_object_class.finalize =
       (GstMiniObjectFinalizeFunction) gst_buffer_finalize;
@@ -200,8 +465,15 @@ gst_buffer_finalize (GstBuffer * buffer)
 
   gst_caps_replace (&GST_BUFFER_CAPS (buffer), NULL);
 
-  if (buffer->parent)
+  if (buffer->parent) {
     gst_buffer_unref (buffer->parent);
+    buffer->parent = NULL;
+  }
+
+  /* only plain buffers are recycled, subclasses have their own instance
+   * layout and finalizers */
+  if (G_TYPE_FROM_INSTANCE (buffer) == _gst_buffer_type)
+    buffer_cache_push (buffer);
 
 /*   ((GstMiniObjectClass *) */
 /*       gst_buffer_parent_class)->finalize (GST_MINI_OBJECT_CAST (buffer)); */
@@ -328,9 +600,15 @@ gst_buffer_init (GstBuffer * buffer)
 GstBuffer *
 gst_buffer_new (void)
 {
+  GstBufferCache *cache;
   GstBuffer *newbuf;
 
-  newbuf = (GstBuffer *) gst_mini_object_new (_gst_buffer_type);
+  /* reuse a finalized buffer of this thread when possible */
+  cache = buffer_cache_get ();
+  if (cache == NULL || !(newbuf = buffer_cache_pop (cache))) {
+    newbuf = (GstBuffer *) gst_mini_object_new (_gst_buffer_type);
+    BUFFER_CACHE (newbuf) = cache;
+  }
 
   GST_CAT_LOG (GST_CAT_BUFFER, "new %p", newbuf);
 
@@ -675,6 +953,7 @@ gst_buffer_is_span_fast (GstBuffer * buf1, GstBuffer * buf2)
  * and are contiguous, the new buffer will be a child of the shared
  * parent, and thus no copying is necessary. you can use
  * gst_buffer_is_span_fast() to determine if a memcpy will be needed.
+ * gst_buffer_list_new_span() describes the same span without copying.
  *
  * MT safe.
  * Returns: the new #GstBuffer that spans the two source buffers.
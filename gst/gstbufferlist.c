@@ -265,6 +265,67 @@ gst_buffer_list_new (void)
   return list;
 }
 
+/**
+ * gst_buffer_list_new_span:
+ * @buf1: the first source #GstBuffer
+ * @offset: the offset in the first buffer where the span starts
+ * @buf2: the second source #GstBuffer
+ * @len: the total length of the span
+ *
+ * Creates a new #GstBufferList with one group that describes the same data
+ * as gst_buffer_span() would return for the given arguments. Instead of
+ * copying the data of non-contiguous buffers into a new buffer, the group
+ * contains sub-buffers of @buf1 and @buf2. When gst_buffer_is_span_fast()
+ * returns TRUE the group contains a single sub-buffer.
+ *
+ * This is useful for elements that push the span with gst_pad_push_list() to
+ * peers that accept buffer lists. The metadata of the span is found on the
+ * first buffer of the group.
+ *
+ * Returns: the new #GstBufferList. gst_buffer_list_unref() after usage.
+ * Returns NULL if the arguments are invalid.
+ *
+ * Since: 0.10.31
+ */
+GstBufferList *
+gst_buffer_list_new_span (GstBuffer * buf1, guint32 offset, GstBuffer * buf2,
+    guint32 len)
+{
+  GstBufferList *list;
+  GstBufferListIterator *it;
+  guint size1;
+
+  g_return_val_if_fail (GST_IS_BUFFER (buf1), NULL);
+  g_return_val_if_fail (GST_IS_BUFFER (buf2), NULL);
+  g_return_val_if_fail (len > 0, NULL);
+  g_return_val_if_fail (len <= buf1->size + buf2->size - offset, NULL);
+
+  list = gst_buffer_list_new ();
+  it = gst_buffer_list_iterate (list);
+  gst_buffer_list_iterator_add_group (it);
+
+  if (gst_buffer_is_span_fast (buf1, buf2)) {
+    gst_buffer_list_iterator_add (it, gst_buffer_span (buf1, offset, buf2,
+            len));
+  } else if (offset >= GST_BUFFER_SIZE (buf1)) {
+    gst_buffer_list_iterator_add (it, gst_buffer_create_sub (buf2,
+            offset - GST_BUFFER_SIZE (buf1), len));
+  } else {
+    size1 = MIN (GST_BUFFER_SIZE (buf1) - offset, len);
+
+    gst_buffer_list_iterator_add (it, gst_buffer_create_sub (buf1, offset,
+            size1));
+    if (len > size1)
+      gst_buffer_list_iterator_add (it, gst_buffer_create_sub (buf2, 0,
+              len - size1));
+  }
+  gst_buffer_list_iterator_free (it);
+
+  GST_LOG ("new span list %p from %p and %p", list, buf1, buf2);
+
+  return list;
+}
+
 /**
  * gst_buffer_list_n_groups:
  * @list: a #GstBufferList
@@ -112,6 +112,8 @@ GType gst_buffer_list_get_type (void);
 
 /* allocation */
 GstBufferList *gst_buffer_list_new (void);
+GstBufferList *gst_buffer_list_new_span (GstBuffer *buf1, guint32 offset,
+                                         GstBuffer *buf2, guint32 len);
 
 /* refcounting */
 /**
@@ -28,10 +28,10 @@ G_BEGIN_DECLS
 static inline void
 __gst_element_details_clear (GstElementDetails * dp)
 {
-  g_free (dp->longname);
-  g_free (dp->klass);
-  g_free (dp->description);
-  g_free (dp->author);
+  _priv_gst_registry_free_string (dp->longname);
+  _priv_gst_registry_free_string (dp->klass);
+  _priv_gst_registry_free_string (dp->description);
+  _priv_gst_registry_free_string (dp->author);
   memset (dp, 0, sizeof (GstElementDetails));
 }
 
@@ -162,7 +162,7 @@ gst_element_factory_cleanup (GstElementFactory * factory)
     GstStaticPadTemplate *templ = item->data;
     GstCaps *caps = (GstCaps *) & (templ->static_caps);
 
-    g_free ((gchar *) templ->static_caps.string);
+    _priv_gst_registry_free_string ((gchar *) templ->static_caps.string);
 
     /* FIXME: this is not threadsafe */
     if (caps->refcount == 1) {
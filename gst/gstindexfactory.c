@@ -64,7 +64,7 @@ gst_index_factory_finalize (GObject * object)
 {
   GstIndexFactory *factory = GST_INDEX_FACTORY (object);
 
-  g_free (factory->longdesc);
+  _priv_gst_registry_free_string (factory->longdesc);
 
   G_OBJECT_CLASS (factory_parent_class)->finalize (object);
 
@@ -90,7 +90,7 @@ gst_index_factory_new (const gchar * name, const gchar * longdesc, GType type)
 
   GST_PLUGIN_FEATURE_NAME (factory) = g_strdup (name);
   if (factory->longdesc)
-    g_free (factory->longdesc);
+    _priv_gst_registry_free_string (factory->longdesc);
   factory->longdesc = g_strdup (longdesc);
   factory->type = type;
 
@@ -103,6 +103,10 @@ enum
 struct _GstPadPrivate
 {
   GstPadChainListFunction chainlistfunc;
+
+  /* when the last FLUSH_START was received, only measured when the
+   * GST_PERFORMANCE debug category is at INFO, with LOCK */
+  GstClockTime flush_start;
 };
 
 static void gst_pad_dispose (GObject * object);
@@ -351,6 +355,7 @@ static void
 gst_pad_init (GstPad * pad)
 {
   pad->abidata.ABI.priv = GST_PAD_GET_PRIVATE (pad);
+  pad->abidata.ABI.priv->flush_start = GST_CLOCK_TIME_NONE;
 
   GST_PAD_DIRECTION (pad) = GST_PAD_UNKNOWN;
   GST_PAD_PEER (pad) = NULL;
@@ -4133,6 +4138,18 @@ gst_pad_chain_data_unchecked (GstPad * pad, gboolean is_buffer, void *data)
   if (G_UNLIKELY (GST_PAD_IS_FLUSHING (pad)))
     goto flushing;
 
+#ifndef GST_DISABLE_GST_DEBUG
+  /* seek latency as seen by this pad */
+  if (G_UNLIKELY (GST_CLOCK_TIME_IS_VALID (pad->abidata.ABI.
+              priv->flush_start))) {
+    GST_CAT_INFO_OBJECT (GST_CAT_PERFORMANCE, pad,
+        "first data %" GST_TIME_FORMAT " after flush-start",
+        GST_TIME_ARGS (gst_util_get_timestamp () -
+            pad->abidata.ABI.priv->flush_start));
+    pad->abidata.ABI.priv->flush_start = GST_CLOCK_TIME_NONE;
+  }
+#endif
+
   caps = gst_pad_data_get_caps (is_buffer, data);
   caps_changed = caps && caps != GST_PAD_CAPS (pad);
 
@@ -5060,6 +5077,11 @@ gst_pad_send_event (GstPad * pad, GstEvent * event)
         goto flushing;
       GST_PAD_SET_FLUSHING (pad);
       GST_CAT_DEBUG_OBJECT (GST_CAT_EVENT, pad, "set flush flag");
+#ifndef GST_DISABLE_GST_DEBUG
+      if (G_UNLIKELY (gst_debug_category_get_threshold
+              (GST_CAT_PERFORMANCE) >= GST_LEVEL_INFO))
+        pad->abidata.ABI.priv->flush_start = gst_util_get_timestamp ();
+#endif
       break;
     case GST_EVENT_FLUSH_STOP:
       GST_PAD_UNSET_FLUSHING (pad);
@@ -131,7 +131,7 @@ gst_plugin_finalize (GObject * object)
       g_warning ("removing plugin that is still in registry");
     }
   }
-  g_free (plugin->filename);
+  _priv_gst_registry_free_string (plugin->filename);
   g_free (plugin->basename);
 
   g_list_foreach (plugin->priv->deps, (GFunc) gst_plugin_ext_dep_free, NULL);
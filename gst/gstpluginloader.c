@@ -31,6 +31,7 @@
 #include <sys/wait.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <signal.h>
 #include <unistd.h>
 #else
 #define fsync(fd) _commit(fd)
@@ -38,6 +39,7 @@
 #endif
 
 #include <errno.h>
+#include <stdlib.h>
 
 #include <gst/gstconfig.h>
 
@@ -75,11 +77,31 @@ typedef struct _PendingPluginEntry
   time_t file_mtime;
 } PendingPluginEntry;
 
+/* maximum number of scanner processes loading plugins in parallel */
+#define MAX_WORKERS 16
+/* default time a scanner may spend loading one plugin file */
+#define DEFAULT_TIMEOUT (60 * GST_SECOND)
+
 struct _GstPluginLoader
 {
   GstRegistry *registry;
   GstPoll *fdset;
 
+  /* The loader returned to the registry owns the pool of scanner processes
+   * and is its first worker. All workers share its fdset so that replies of
+   * all scanners are read while waiting for any of them. Plugins are added to
+   * the registry in the order the scanners reply, so with more than one
+   * scanner the order of the registry plugin list differs between runs.
+   * Lookups are by name and nothing depends on that order. */
+  GstPluginLoader *pool;
+  GstPluginLoader *workers[MAX_WORKERS];
+  guint n_workers;
+  guint max_workers;
+  GstClockTime timeout;
+
+  /* when the first pending plugin was sent to the scanner */
+  GstClockTime head_time;
+
   gboolean child_running;
   GPid child_pid;
   GstPollFD fd_w;
@@ -136,13 +158,19 @@ static void plugin_loader_cleanup_child (GstPluginLoader * loader);
 static gboolean plugin_loader_sync_with_child (GstPluginLoader * l);
 
 static GstPluginLoader *
-plugin_loader_new (GstRegistry * registry)
+plugin_loader_new_worker (GstPluginLoader * pool, GstRegistry * registry)
 {
   GstPluginLoader *l = g_slice_new0 (GstPluginLoader);
 
   if (registry)
     l->registry = gst_object_ref (registry);
-  l->fdset = gst_poll_new (FALSE);
+  if (pool) {
+    l->pool = pool;
+    l->fdset = pool->fdset;
+  } else {
+    l->pool = l;
+    l->fdset = gst_poll_new (FALSE);
+  }
   gst_poll_fd_init (&l->fd_w);
   gst_poll_fd_init (&l->fd_r);
 
@@ -157,11 +185,60 @@ plugin_loader_new (GstRegistry * registry)
   return l;
 }
 
+static GstPluginLoader *
+plugin_loader_new (GstRegistry * registry)
+{
+  GstPluginLoader *l;
+  const gchar *env;
+  glong n_cpus = 1;
+
+  l = plugin_loader_new_worker (NULL, registry);
+  l->workers[0] = l;
+  l->n_workers = 1;
+
+#ifdef _SC_NPROCESSORS_ONLN
+  n_cpus = sysconf (_SC_NPROCESSORS_ONLN);
+#endif
+  env = g_getenv ("GST_PLUGIN_SCANNER_WORKERS");
+  if (env != NULL && *env != '\0')
+    n_cpus = atoi (env);
+  l->max_workers = CLAMP (n_cpus, 1, MAX_WORKERS);
+
+  l->timeout = DEFAULT_TIMEOUT;
+  env = g_getenv ("GST_PLUGIN_SCANNER_TIMEOUT");
+  if (env != NULL && *env != '\0') {
+    gint secs = atoi (env);
+
+    l->timeout = (secs > 0) ? secs * GST_SECOND : GST_CLOCK_TIME_NONE;
+  }
+
+  GST_DEBUG ("using up to %u plugin scanners, timeout %" GST_TIME_FORMAT,
+      l->max_workers, GST_TIME_ARGS (l->timeout));
+
+  return l;
+}
+
+/* restarts the scanners that died or were killed and have plugins pending,
+ * loading those plugins again */
 static gboolean
-plugin_loader_free (GstPluginLoader * loader)
+plugin_loader_recover_workers (GstPluginLoader * pool)
+{
+  gboolean res = TRUE;
+  guint i;
+
+  for (i = 0; i < pool->n_workers; i++) {
+    GstPluginLoader *w = pool->workers[i];
+
+    if (!w->child_running && w->pending_plugins != NULL)
+      res &= plugin_loader_replay_pending (w);
+  }
+  return res;
+}
+
+static void
+plugin_loader_shutdown (GstPluginLoader * loader)
 {
   GList *cur;
-  gboolean got_plugin_details;
 
   fsync (loader->fd_w.fd);
 
@@ -170,8 +247,11 @@ plugin_loader_free (GstPluginLoader * loader)
 
     /* Swap packets with the child until it exits cleanly */
     while (!loader->rx_done) {
-      if (exchange_packets (loader) || loader->rx_done)
+      if (exchange_packets (loader) || loader->rx_done) {
+        /* other scanners may have failed while we waited for this one */
+        plugin_loader_recover_workers (loader->pool);
         continue;
+      }
 
       if (!plugin_loader_replay_pending (loader))
         break;
@@ -180,20 +260,18 @@ plugin_loader_free (GstPluginLoader * loader)
 
     plugin_loader_cleanup_child (loader);
   } else {
-    close (loader->fd_w.fd);
-    close (loader->fd_r.fd);
+    if (loader->fd_w.fd >= 0)
+      close (loader->fd_w.fd);
+    if (loader->fd_r.fd >= 0)
+      close (loader->fd_r.fd);
   }
 
-  gst_poll_free (loader->fdset);
-
   g_free (loader->rx_buf);
   g_free (loader->tx_buf);
 
   if (loader->registry)
     gst_object_unref (loader->registry);
 
-  got_plugin_details = loader->got_plugin_details;
-
   /* Free any pending plugin entries */
   cur = loader->pending_plugins;
   while (cur) {
@@ -203,12 +281,75 @@ plugin_loader_free (GstPluginLoader * loader)
 
     cur = g_list_delete_link (cur, cur);
   }
+  loader->pending_plugins = loader->pending_plugins_tail = NULL;
+}
+
+static gboolean
+plugin_loader_free (GstPluginLoader * loader)
+{
+  gboolean got_plugin_details = FALSE;
+  guint i;
+
+  for (i = 0; i < loader->n_workers; i++)
+    plugin_loader_shutdown (loader->workers[i]);
+
+  for (i = 0; i < loader->n_workers; i++) {
+    GstPluginLoader *w = loader->workers[i];
+
+    got_plugin_details |= w->got_plugin_details;
+    if (w != loader)
+      g_slice_free (GstPluginLoader, w);
+  }
+
+  gst_poll_free (loader->fdset);
 
   g_slice_free (GstPluginLoader, loader);
 
   return got_plugin_details;
 }
 
+/* returns the running scanner with the fewest pending plugins. When all
+ * scanners are busy, another one is started if allowed */
+static GstPluginLoader *
+plugin_loader_pick_worker (GstPluginLoader * pool)
+{
+  GstPluginLoader *best = NULL;
+  guint best_pending = 0;
+  guint i;
+
+  for (i = 0; i < pool->n_workers; i++) {
+    GstPluginLoader *w = pool->workers[i];
+    guint n_pending;
+
+    if (!w->child_running && !gst_plugin_loader_spawn (w))
+      continue;
+
+    n_pending = g_list_length (w->pending_plugins);
+    if (best == NULL || n_pending < best_pending) {
+      best = w;
+      best_pending = n_pending;
+    }
+  }
+
+  if ((best == NULL || best_pending > 0) &&
+      pool->n_workers < pool->max_workers) {
+    GstPluginLoader *w = plugin_loader_new_worker (pool, pool->registry);
+
+    if (gst_plugin_loader_spawn (w)) {
+      GST_DEBUG ("started plugin scanner %u", pool->n_workers);
+      pool->workers[pool->n_workers++] = w;
+      best = w;
+    } else {
+      /* keep using the scanners we have */
+      pool->max_workers = pool->n_workers;
+      plugin_loader_shutdown (w);
+      g_slice_free (GstPluginLoader, w);
+    }
+  }
+
+  return best;
+}
+
 static gboolean
 plugin_loader_load (GstPluginLoader * loader, const gchar * filename,
     off_t file_size, time_t file_mtime)
@@ -216,7 +357,10 @@ plugin_loader_load (GstPluginLoader * loader, const gchar * filename,
   gint len;
   PendingPluginEntry *entry;
 
-  if (!gst_plugin_loader_spawn (loader))
+  if (!plugin_loader_recover_workers (loader))
+    return FALSE;
+
+  if (!(loader = plugin_loader_pick_worker (loader)))
     return FALSE;
 
   /* Send a packet to the child requesting that it load the given file */
@@ -231,9 +375,10 @@ plugin_loader_load (GstPluginLoader * loader, const gchar * filename,
   loader->pending_plugins_tail =
       g_list_append (loader->pending_plugins_tail, entry);
 
-  if (loader->pending_plugins == NULL)
+  if (loader->pending_plugins == NULL) {
     loader->pending_plugins = loader->pending_plugins_tail;
-  else
+    loader->head_time = gst_util_get_timestamp ();
+  } else
     loader->pending_plugins_tail = g_list_next (loader->pending_plugins_tail);
 
   len = strlen (filename);
@@ -317,6 +462,7 @@ plugin_loader_load_and_sync (GstPluginLoader * l, PendingPluginEntry * entry)
   GST_DEBUG_OBJECT (l->registry, "Synchronously loading plugin file %s",
       entry->filename);
 
+  l->head_time = gst_util_get_timestamp ();
   len = strlen (entry->filename);
   put_packet (l, PACKET_LOAD_PLUGIN, entry->tag,
       (guint8 *) entry->filename, len + 1);
@@ -366,12 +512,18 @@ gst_plugin_loader_try_helper (GstPluginLoader * loader, gchar * location)
   gst_poll_fd_ctl_read (loader->fdset, &loader->fd_r, TRUE);
 
   loader->tx_buf_write = loader->tx_buf_read = 0;
+  loader->rx_done = FALSE;
+  loader->head_time = gst_util_get_timestamp ();
+
+  /* mark the child as running already, so that it is cleaned up when the
+   * version exchange fails */
+  loader->child_running = TRUE;
 
   put_packet (loader, PACKET_VERSION, 0, NULL, 0);
-  if (!plugin_loader_sync_with_child (loader))
+  if (!plugin_loader_sync_with_child (loader)) {
+    plugin_loader_cleanup_child (loader);
     return FALSE;
-
-  loader->child_running = TRUE;
+  }
 
   return TRUE;
 }
@@ -422,6 +574,8 @@ plugin_loader_cleanup_child (GstPluginLoader * l)
 
   close (l->fd_w.fd);
   close (l->fd_r.fd);
+  gst_poll_fd_init (&l->fd_w);
+  gst_poll_fd_init (&l->fd_r);
 
 #ifndef G_OS_WIN32
   GST_LOG ("waiting for child process to exit");
@@ -439,7 +593,7 @@ _gst_plugin_loader_client_run (void)
 {
   GstPluginLoader *l;
 
-  l = plugin_loader_new (NULL);
+  l = plugin_loader_new_worker (NULL, NULL);
   if (l == NULL)
     return FALSE;
 
@@ -487,7 +641,9 @@ _gst_plugin_loader_client_run (void)
   /* Loop, listening for incoming packets on the fd and writing responses */
   while (!l->rx_done && exchange_packets (l));
 
-  plugin_loader_free (l);
+  plugin_loader_shutdown (l);
+  gst_poll_free (l->fdset);
+  g_slice_free (GstPluginLoader, l);
 
   return TRUE;
 }
@@ -557,34 +713,45 @@ put_chunk (GstPluginLoader * l, GstRegistryChunk * chunk, guint * pos)
   gst_poll_fd_ctl_write (l->fdset, &l->fd_w, TRUE);
 };
 
+/* writes all queued packets with one write, so that the plugin details of
+ * several plugins reach the parent in one go */
 static gboolean
 write_one (GstPluginLoader * l)
 {
   guint8 *out;
-  guint32 to_write, magic;
+  guint32 to_write, packet_len, magic;
+  guint n_packets = 0;
   int res;
 
   if (l->tx_buf_read + HEADER_SIZE > l->tx_buf_write)
     return FALSE;
 
   out = l->tx_buf + l->tx_buf_read;
+  to_write = 0;
 
-  magic = GST_READ_UINT32_BE (out + 8);
-  if (magic != HEADER_MAGIC) {
-    GST_ERROR ("Packet magic number is missing. Memory corruption detected");
-    goto fail_and_cleanup;
-  }
+  while (l->tx_buf_read + to_write + HEADER_SIZE <= l->tx_buf_write) {
+    guint8 *packet = out + to_write;
+
+    magic = GST_READ_UINT32_BE (packet + 8);
+    if (magic != HEADER_MAGIC) {
+      GST_ERROR ("Packet magic number is missing. Memory corruption detected");
+      goto fail_and_cleanup;
+    }
 
-  to_write = GST_READ_UINT32_BE (out + 4) + HEADER_SIZE;
-  /* Check that the magic is intact, and the size is sensible */
-  if (to_write > l->tx_buf_size) {
-    GST_ERROR ("Indicated packet size is too large. Corruption detected");
-    goto fail_and_cleanup;
+    packet_len = GST_READ_UINT32_BE (packet + 4) + HEADER_SIZE;
+    /* Check that the magic is intact, and the size is sensible */
+    if (l->tx_buf_read + to_write + packet_len > l->tx_buf_write) {
+      GST_ERROR ("Indicated packet size is too large. Corruption detected");
+      goto fail_and_cleanup;
+    }
+    to_write += packet_len;
+    n_packets++;
   }
 
   l->tx_buf_read += to_write;
 
-  GST_LOG ("Writing packet of size %d bytes to fd %d", to_write, l->fd_w.fd);
+  GST_LOG ("Writing %u packets of %d bytes to fd %d", n_packets, to_write,
+      l->fd_w.fd);
 
   do {
     res = write (l->fd_w.fd, out, to_write);
@@ -808,6 +975,9 @@ handle_rx_packet (GstPluginLoader * l,
       if (cur == NULL)
         l->pending_plugins_tail = NULL;
 
+      /* the scanner starts on the next pending plugin now */
+      l->head_time = gst_util_get_timestamp ();
+
       break;
     }
     case PACKET_SYNC:
@@ -908,10 +1078,80 @@ read_one (GstPluginLoader * l)
       l->rx_buf + HEADER_SIZE, packet_len);
 }
 
+/* handles the activity on the fds of one scanner after a poll */
+static gboolean
+exchange_one (GstPluginLoader * l)
+{
+  if (!l->rx_done) {
+    if (gst_poll_fd_has_error (l->fdset, &l->fd_r) ||
+        gst_poll_fd_has_closed (l->fdset, &l->fd_r)) {
+      GST_LOG ("read fd %d closed/errored", l->fd_r.fd);
+      return FALSE;
+    }
+
+    if (gst_poll_fd_can_read (l->fdset, &l->fd_r)) {
+      if (!read_one (l))
+        return FALSE;
+    }
+  }
+
+  if (l->tx_buf_read < l->tx_buf_write) {
+    if (gst_poll_fd_has_error (l->fdset, &l->fd_w) ||
+        gst_poll_fd_has_closed (l->fdset, &l->fd_r)) {
+      GST_ERROR ("write fd %d closed/errored", l->fd_w.fd);
+      return FALSE;
+    }
+    if (gst_poll_fd_can_write (l->fdset, &l->fd_w)) {
+      if (!write_one (l))
+        return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+/* kills the scanners that spent too long on one plugin file. Returns FALSE
+ * when @l was killed */
+static gboolean
+check_timeouts (GstPluginLoader * l)
+{
+  GstPluginLoader *pool = l->pool;
+  GstClockTime now;
+  gboolean res = TRUE;
+  guint i;
+
+  if (!GST_CLOCK_TIME_IS_VALID (pool->timeout))
+    return TRUE;
+
+  now = gst_util_get_timestamp ();
+
+  for (i = 0; i < pool->n_workers; i++) {
+    GstPluginLoader *w = pool->workers[i];
+    PendingPluginEntry *entry;
+
+    if (!w->child_running || w->pending_plugins == NULL ||
+        now - w->head_time < pool->timeout)
+      continue;
+
+    entry = (PendingPluginEntry *) w->pending_plugins->data;
+    GST_ERROR ("Plugin file %s did not load within %" GST_TIME_FORMAT
+        ", killing plugin scanner", entry->filename,
+        GST_TIME_ARGS (pool->timeout));
+#ifndef G_OS_WIN32
+    kill (w->child_pid, SIGKILL);
+#endif
+    plugin_loader_cleanup_child (w);
+    if (w == l)
+      res = FALSE;
+  }
+  return res;
+}
+
 static gboolean
 exchange_packets (GstPluginLoader * l)
 {
+  GstPluginLoader *pool = l->pool;
   gint res;
+  guint i;
 
   /* Wait for activity on our FDs */
   do {
@@ -925,30 +1165,23 @@ exchange_packets (GstPluginLoader * l)
     GST_LOG ("Poll res = %d. %d bytes pending for write", res,
         l->tx_buf_write - l->tx_buf_read);
 
-    if (!l->rx_done) {
-      if (gst_poll_fd_has_error (l->fdset, &l->fd_r) ||
-          gst_poll_fd_has_closed (l->fdset, &l->fd_r)) {
-        GST_LOG ("read fd %d closed/errored", l->fd_r.fd);
-        goto fail_and_cleanup;
-      }
+    if (!exchange_one (l))
+      goto fail_and_cleanup;
 
-      if (gst_poll_fd_can_read (l->fdset, &l->fd_r)) {
-        if (!read_one (l))
-          goto fail_and_cleanup;
-      }
-    }
+    /* the other scanners of the pool share the fdset, collect their replies
+     * too. Failed ones are restarted by the caller of the loader. */
+    for (i = 0; i < pool->n_workers; i++) {
+      GstPluginLoader *w = pool->workers[i];
 
-    if (l->tx_buf_read < l->tx_buf_write) {
-      if (gst_poll_fd_has_error (l->fdset, &l->fd_w) ||
-          gst_poll_fd_has_closed (l->fdset, &l->fd_r)) {
-        GST_ERROR ("write fd %d closed/errored", l->fd_w.fd);
-        goto fail_and_cleanup;
-      }
-      if (gst_poll_fd_can_write (l->fdset, &l->fd_w)) {
-        if (!write_one (l))
-          goto fail_and_cleanup;
-      }
+      if (w == l || !w->child_running)
+        continue;
+
+      if (!exchange_one (w))
+        plugin_loader_cleanup_child (w);
     }
+
+    if (!check_timeouts (l))
+      return FALSE;
   } while (l->tx_buf_read < l->tx_buf_write);
 
   return TRUE;
@@ -29,6 +29,11 @@
  * All instances of one type will share the list of presets. The list is created
  * on demand, if presets are not used, the list is not created.
  *
+ * The default implementation keeps the property values of a preset
+ * deserialized once it has been loaded, so that switching between presets
+ * only sets the properties. The preset files are checked for changes made by
+ * other processes before they are used and reloaded when needed.
+ *
  * The interface comes with a default implementation that serves most plugins.
  * Wrapper plugins will override most methods to implement support for the
  * native preset format of those wrapped plugins.
@@ -87,6 +92,9 @@
 
 #include "gstpreset.h"
 
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <time.h>
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -106,12 +114,21 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
 static GQuark preset_user_path_quark = 0;
 static GQuark preset_system_path_quark = 0;
 static GQuark preset_quark = 0;
+static GQuark preset_cache_quark = 0;
+
+/* protects the cached keyfiles and the PresetCache of all types, the cached
+ * keyfile of a type can be replaced when the preset files change on disk */
+static GStaticRecMutex preset_lock = G_STATIC_REC_MUTEX_INIT;
+
+#define PRESET_LOCK()   g_static_rec_mutex_lock (&preset_lock)
+#define PRESET_UNLOCK() g_static_rec_mutex_unlock (&preset_lock)
 
 /*static GQuark property_list_quark = 0;*/
 
 /* default iface implementation */
 
-static gboolean gst_preset_default_save_presets_file (GstPreset * preset);
+static gboolean gst_preset_default_save_presets_file (GstPreset * preset,
+    GKeyFile * presets);
 
 /*
  * preset_get_paths:
@@ -317,17 +334,159 @@ preset_merge (GKeyFile * system, GKeyFile * user)
   g_strfreev (groups);
 }
 
-/* reads the user and system presets files and merges them together. This
- * function caches the GKeyFile on the element type. If there is no existing
- * preset file, a new in-memory GKeyFile will be created. */
+/* identifies the version of a preset file on disk. The mtime only has a
+ * granularity of one second, a file that was modified in the same second as
+ * we looked at it can be modified again without changing the stamp, so such a
+ * stamp is marked as racy and never matches. */
+typedef struct
+{
+  time_t mtime;
+  off_t size;
+  ino_t inode;
+  gboolean racy;
+} PresetStamp;
+
+/* a property value of a preset, deserialized from the keyfile */
+typedef struct
+{
+  GParamSpec *property;
+  GValue value;
+} PresetValue;
+
+/* the deserialized values of a preset, refcounted so that they can be used
+ * after another thread dropped them from the cache */
+typedef struct
+{
+  gint refcount;
+  GArray *array;
+} PresetValues;
+
+/* per type state next to the cached keyfile, protected by the preset lock */
+typedef struct
+{
+  /* the preset files the cached keyfile was loaded from */
+  PresetStamp user;
+  PresetStamp system;
+  /* the cached keyfile has changes that are not on disk yet, it is not
+   * reloaded until they are saved */
+  gboolean dirty;
+  /* preset name -> PresetValues */
+  GHashTable *values;
+} PresetCache;
+
+static void
+preset_stamp (const gchar * path, PresetStamp * stamp)
+{
+  struct stat statbuf;
+
+  if (g_stat (path, &statbuf) < 0) {
+    stamp->mtime = 0;
+    stamp->size = 0;
+    stamp->inode = 0;
+    stamp->racy = FALSE;
+  } else {
+    stamp->mtime = statbuf.st_mtime;
+    stamp->size = statbuf.st_size;
+    stamp->inode = statbuf.st_ino;
+    stamp->racy = statbuf.st_mtime >= time (NULL);
+  }
+}
+
+static gboolean
+preset_stamp_changed (const gchar * path, const PresetStamp * stamp)
+{
+  PresetStamp now;
+
+  if (stamp->racy)
+    return TRUE;
+
+  preset_stamp (path, &now);
+
+  return now.mtime != stamp->mtime || now.size != stamp->size ||
+      now.inode != stamp->inode;
+}
+
+static PresetValues *
+preset_values_ref (PresetValues * values)
+{
+  g_atomic_int_inc (&values->refcount);
+
+  return values;
+}
+
+static void
+preset_values_unref (PresetValues * values)
+{
+  guint i;
+
+  if (!g_atomic_int_dec_and_test (&values->refcount))
+    return;
+
+  for (i = 0; i < values->array->len; i++)
+    g_value_unset (&g_array_index (values->array, PresetValue, i).value);
+  g_array_free (values->array, TRUE);
+  g_slice_free (PresetValues, values);
+}
+
+/* with PRESET_LOCK. The cache is never freed. */
+static PresetCache *
+preset_get_cache (GstPreset * preset)
+{
+  PresetCache *cache;
+  GType type = G_TYPE_FROM_INSTANCE (preset);
+
+  if (!(cache = g_type_get_qdata (type, preset_cache_quark))) {
+    cache = g_new0 (PresetCache, 1);
+    cache->values = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+        (GDestroyNotify) preset_values_unref);
+    g_type_set_qdata (type, preset_cache_quark, cache);
+  }
+  return cache;
+}
+
+/* with PRESET_LOCK, drops the deserialized values, call this whenever the
+ * keyfile changed */
+static void
+preset_cache_invalidate (GstPreset * preset)
+{
+  g_hash_table_remove_all (preset_get_cache (preset)->values);
+}
+
+/* with PRESET_LOCK, reads the user and system presets files and merges them
+ * together. This function caches the GKeyFile on the element type. If there
+ * is no existing preset file, a new in-memory GKeyFile will be created. The
+ * cached GKeyFile is dropped and read again when one of the files was changed
+ * on disk and it has no unsaved changes, so it must not be used after
+ * releasing the lock. */
 static GKeyFile *
 preset_get_keyfile (GstPreset * preset)
 {
   GKeyFile *presets;
   GType type = G_TYPE_FROM_INSTANCE (preset);
+  PresetCache *cache;
 
   /* first see if the have a cached version for the type */
-  if (!(presets = g_type_get_qdata (type, preset_quark))) {
+  if ((presets = g_type_get_qdata (type, preset_quark))) {
+    const gchar *preset_user_path, *preset_system_path;
+    gboolean changed;
+
+    preset_get_paths (preset, &preset_user_path, &preset_system_path);
+
+    cache = preset_get_cache (preset);
+    changed = !cache->dirty &&
+        (preset_stamp_changed (preset_user_path, &cache->user) ||
+        preset_stamp_changed (preset_system_path, &cache->system));
+
+    if (changed) {
+      GST_INFO_OBJECT (preset, "preset files changed, reloading");
+      g_type_set_qdata (type, preset_quark, NULL);
+      g_key_file_free (presets);
+      presets = NULL;
+      preset_cache_invalidate (preset);
+    }
+  }
+
+  if (!presets) {
     const gchar *preset_user_path, *preset_system_path;
     gchar *str_version_user = NULL, *str_version_system = NULL;
     gboolean updated_from_system = FALSE;
@@ -335,6 +494,12 @@ preset_get_keyfile (GstPreset * preset)
 
     preset_get_paths (preset, &preset_user_path, &preset_system_path);
 
+    /* stamp the files before reading them, so that we reload when they are
+     * changed while we read them */
+    cache = preset_get_cache (preset);
+    preset_stamp (preset_user_path, &cache->user);
+    preset_stamp (preset_system_path, &cache->system);
+
     /* try to load the user and system presets, we do this to get the versions
      * of both files. */
     in_user = preset_open_and_parse_header (preset, preset_user_path,
@@ -378,7 +543,7 @@ preset_get_keyfile (GstPreset * preset)
     g_type_set_qdata (type, preset_quark, (gpointer) presets);
 
     if (updated_from_system) {
-      gst_preset_default_save_presets_file (preset);
+      gst_preset_default_save_presets_file (preset, presets);
     }
   }
   return presets;
@@ -392,6 +557,8 @@ gst_preset_default_get_preset_names (GstPreset * preset)
   gsize i, num_groups;
   gchar **groups;
 
+  PRESET_LOCK ();
+
   /* get the presets from the type */
   if (!(presets = preset_get_keyfile (preset)))
     goto no_presets;
@@ -416,17 +583,20 @@ gst_preset_default_get_preset_names (GstPreset * preset)
   g_qsort_with_data (groups, num_groups, sizeof (gchar *),
       (GCompareDataFunc) strcmp, NULL);
 
+  PRESET_UNLOCK ();
   return groups;
 
   /* ERRORS */
 no_presets:
   {
     GST_WARNING_OBJECT (preset, "Could not load presets");
+    PRESET_UNLOCK ();
     return NULL;
   }
 no_groups:
   {
     GST_WARNING_OBJECT (preset, "Could not find preset groups");
+    PRESET_UNLOCK ();
     return NULL;
   }
 }
@@ -474,12 +644,15 @@ no_properties:
   }
 }
 
-/* load the presets of @name for the instance @preset. Returns %FALSE if something
- * failed. */
-static gboolean
-gst_preset_default_load_preset (GstPreset * preset, const gchar * name)
+/* with PRESET_LOCK, deserializes the property values of preset @name from the
+ * keyfile. Returns %NULL if there is no such preset, unref the result after
+ * usage. */
+static PresetValues *
+preset_get_values (GstPreset * preset, const gchar * name)
 {
   GKeyFile *presets;
+  PresetValues *values;
+  GArray *array;
   gchar **props;
   guint i;
   GObjectClass *gclass;
@@ -488,23 +661,27 @@ gst_preset_default_load_preset (GstPreset * preset, const gchar * name)
   if (!(presets = preset_get_keyfile (preset)))
     goto no_presets;
 
+  /* see if we deserialized this preset before */
+  if ((values = g_hash_table_lookup (preset_get_cache (preset)->values, name)))
+    return preset_values_ref (values);
+
   /* get the preset name */
   if (!g_key_file_has_group (presets, name))
     goto no_group;
 
-  GST_DEBUG_OBJECT (preset, "loading preset : '%s'", name);
-
   /* get the properties that we can configure in this element */
   if (!(props = gst_preset_get_property_names (preset)))
     goto no_properties;
 
   gclass = G_OBJECT_CLASS (GST_ELEMENT_GET_CLASS (preset));
 
+  array = g_array_new (FALSE, TRUE, sizeof (PresetValue));
+
   /* for each of the property names, find the preset parameter and try to
-   * configure the property with its value */
+   * deserialize its value for the property */
   for (i = 0; props[i]; i++) {
     gchar *str;
-    GValue gvalue = { 0, };
+    PresetValue value = { NULL, {0,} };
     GParamSpec *property;
 
     /* check if we have a settings for this element property */
@@ -514,8 +691,7 @@ gst_preset_default_load_preset (GstPreset * preset, const gchar * name)
       continue;
     }
 
-    GST_DEBUG_OBJECT (preset, "setting value '%s' for property '%s'", str,
-        props[i]);
+    GST_DEBUG_OBJECT (preset, "value '%s' for property '%s'", str, props[i]);
 
     /* FIXME, change for childproxy to get the property and element.  */
     if (!(property = g_object_class_find_property (gclass, props[i]))) {
@@ -526,63 +702,105 @@ gst_preset_default_load_preset (GstPreset * preset, const gchar * name)
       continue;
     }
 
-    /* try to deserialize the property value from the keyfile and set it as
-     * the object property */
-    g_value_init (&gvalue, property->value_type);
-    if (gst_value_deserialize (&gvalue, str)) {
-      /* FIXME, change for childproxy support */
-      g_object_set_property (G_OBJECT (preset), props[i], &gvalue);
+    /* try to deserialize the property value from the keyfile */
+    g_value_init (&value.value, property->value_type);
+    if (gst_value_deserialize (&value.value, str)) {
+      value.property = property;
+      g_array_append_val (array, value);
     } else {
       GST_WARNING_OBJECT (preset,
           "deserialization of value '%s' for property '%s' failed", str,
           props[i]);
+      g_value_unset (&value.value);
     }
-    g_value_unset (&gvalue);
     g_free (str);
   }
   g_strfreev (props);
 
-  return TRUE;
+  values = g_slice_new (PresetValues);
+  values->refcount = 1;
+  values->array = array;
+
+  g_hash_table_insert (preset_get_cache (preset)->values, g_strdup (name),
+      preset_values_ref (values));
+
+  return values;
 
   /* ERRORS */
 no_presets:
   {
     GST_WARNING_OBJECT (preset, "no presets");
-    return FALSE;
+    return NULL;
   }
 no_group:
   {
     GST_WARNING_OBJECT (preset, "no preset named '%s'", name);
-    return FALSE;
+    return NULL;
   }
 no_properties:
   {
     GST_INFO_OBJECT (preset, "no properties");
+    return NULL;
+  }
+}
+
+/* load the presets of @name for the instance @preset. Returns %FALSE if something
+ * failed. */
+static gboolean
+gst_preset_default_load_preset (GstPreset * preset, const gchar * name)
+{
+  PresetValues *values;
+  guint i;
+
+  PRESET_LOCK ();
+  values = preset_get_values (preset, name);
+  PRESET_UNLOCK ();
+  if (!values)
     return FALSE;
+
+  GST_DEBUG_OBJECT (preset, "loading preset : '%s'", name);
+
+  /* configure the properties with the deserialized values, notifying them
+   * once all of them are set */
+  g_object_freeze_notify (G_OBJECT (preset));
+  for (i = 0; i < values->array->len; i++) {
+    PresetValue *value = &g_array_index (values->array, PresetValue, i);
+
+    /* FIXME, change for childproxy support */
+    g_object_set_property (G_OBJECT (preset), value->property->name,
+        &value->value);
   }
+  g_object_thaw_notify (G_OBJECT (preset));
+  preset_values_unref (values);
+
+  return TRUE;
 }
 
-/* save the presets file. A copy of the existing presets file is stored in a
+/* with PRESET_LOCK, save @presets, the cached keyfile that was just changed,
+ * to the presets file. A copy of the existing presets file is stored in a
  * .bak file */
 static gboolean
-gst_preset_default_save_presets_file (GstPreset * preset)
+gst_preset_default_save_presets_file (GstPreset * preset, GKeyFile * presets)
 {
-  GKeyFile *presets;
+  PresetCache *cache;
   const gchar *preset_path;
   GError *error = NULL;
   gchar *bak_file_name;
   gboolean backup = TRUE;
+  gboolean res;
   gchar *data;
   gsize data_size;
 
   preset_get_paths (preset, &preset_path, NULL);
 
-  /* get the presets from the type */
-  if (!(presets = preset_get_keyfile (preset)))
-    goto no_presets;
-
   GST_DEBUG_OBJECT (preset, "saving preset file: '%s'", preset_path);
 
+  /* the keyfile was changed, the deserialized values are stale now and the
+   * keyfile must not be reloaded before the changes are on disk */
+  cache = preset_get_cache (preset);
+  cache->dirty = TRUE;
+  preset_cache_invalidate (preset);
+
   /* create backup if possible */
   bak_file_name = g_strdup_printf ("%s.bak", preset_path);
   if (g_file_test (bak_file_name, G_FILE_TEST_EXISTS)) {
@@ -609,22 +827,21 @@ gst_preset_default_save_presets_file (GstPreset * preset)
     goto convert_failed;
 
   /* write presets */
-  if (!g_file_set_contents (preset_path, data, data_size, &error))
+  res = g_file_set_contents (preset_path, data, data_size, &error);
+
+  if (!res)
     goto write_failed;
 
+  /* the cached keyfile is what is on disk now, don't reload it unless the
+   * file can still change within the same second */
+  preset_stamp (preset_path, &cache->user);
+  cache->dirty = FALSE;
+
   g_free (data);
 
   return TRUE;
 
   /* ERRORS */
-no_presets:
-  {
-    GST_WARNING_OBJECT (preset,
-        "no presets, trying to unlink possibly existing preset file: '%s'",
-        preset_path);
-    g_unlink (preset_path);
-    return FALSE;
-  }
 convert_failed:
   {
     GST_WARNING_OBJECT (preset, "can not get the keyfile contents: %s",
@@ -648,12 +865,15 @@ static gboolean
 gst_preset_default_save_preset (GstPreset * preset, const gchar * name)
 {
   GKeyFile *presets;
+  gboolean res;
   gchar **props;
   guint i;
   GObjectClass *gclass;
 
   GST_INFO_OBJECT (preset, "saving new preset: %s", name);
 
+  PRESET_LOCK ();
+
   /* get the presets from the type */
   if (!(presets = preset_get_keyfile (preset)))
     goto no_presets;
@@ -696,17 +916,22 @@ gst_preset_default_save_preset (GstPreset * preset, const gchar * name)
   g_strfreev (props);
 
   /* save updated version */
-  return gst_preset_default_save_presets_file (preset);
+  res = gst_preset_default_save_presets_file (preset, presets);
+  PRESET_UNLOCK ();
+
+  return res;
 
   /* ERRORS */
 no_presets:
   {
     GST_WARNING_OBJECT (preset, "no presets");
+    PRESET_UNLOCK ();
     return FALSE;
   }
 no_properties:
   {
     GST_INFO_OBJECT (preset, "no properties");
+    PRESET_UNLOCK ();
     return FALSE;
   }
 }
@@ -718,10 +943,13 @@ gst_preset_default_rename_preset (GstPreset * preset, const gchar * old_name,
     const gchar * new_name)
 {
   GKeyFile *presets;
+  gboolean res;
   gchar *str;
   gchar **keys;
   gsize i, num_keys;
 
+  PRESET_LOCK ();
+
   /* get the presets from the type */
   if (!(presets = preset_get_keyfile (preset)))
     goto no_presets;
@@ -754,17 +982,22 @@ gst_preset_default_rename_preset (GstPreset * preset, const gchar * old_name,
   g_key_file_remove_group (presets, old_name, NULL);
 
   /* save updated version */
-  return gst_preset_default_save_presets_file (preset);
+  res = gst_preset_default_save_presets_file (preset, presets);
+  PRESET_UNLOCK ();
+
+  return res;
 
   /* ERRORS */
 no_presets:
   {
     GST_WARNING_OBJECT (preset, "no presets");
+    PRESET_UNLOCK ();
     return FALSE;
   }
 no_group:
   {
     GST_WARNING_OBJECT (preset, "no preset named %s", old_name);
+    PRESET_UNLOCK ();
     return FALSE;
   }
 }
@@ -774,6 +1007,9 @@ static gboolean
 gst_preset_default_delete_preset (GstPreset * preset, const gchar * name)
 {
   GKeyFile *presets;
+  gboolean res;
+
+  PRESET_LOCK ();
 
   /* get the presets from the type */
   if (!(presets = preset_get_keyfile (preset)))
@@ -787,17 +1023,22 @@ gst_preset_default_delete_preset (GstPreset * preset, const gchar * name)
   g_key_file_remove_group (presets, name, NULL);
 
   /* save updated version */
-  return gst_preset_default_save_presets_file (preset);
+  res = gst_preset_default_save_presets_file (preset, presets);
+  PRESET_UNLOCK ();
+
+  return res;
 
   /* ERRORS */
 no_presets:
   {
     GST_WARNING_OBJECT (preset, "no presets");
+    PRESET_UNLOCK ();
     return FALSE;
   }
 no_group:
   {
     GST_WARNING_OBJECT (preset, "no preset named %s", name);
+    PRESET_UNLOCK ();
     return FALSE;
   }
 }
@@ -807,8 +1048,11 @@ gst_preset_default_set_meta (GstPreset * preset, const gchar * name,
     const gchar * tag, const gchar * value)
 {
   GKeyFile *presets;
+  gboolean res;
   gchar *key;
 
+  PRESET_LOCK ();
+
   /* get the presets from the type */
   if (!(presets = preset_get_keyfile (preset)))
     goto no_presets;
@@ -822,12 +1066,16 @@ gst_preset_default_set_meta (GstPreset * preset, const gchar * name,
   g_free (key);
 
   /* save updated keyfile */
-  return gst_preset_default_save_presets_file (preset);
+  res = gst_preset_default_save_presets_file (preset, presets);
+  PRESET_UNLOCK ();
+
+  return res;
 
   /* ERRORS */
 no_presets:
   {
     GST_WARNING_OBJECT (preset, "no presets");
+    PRESET_UNLOCK ();
     return FALSE;
   }
 }
@@ -840,6 +1088,8 @@ gst_preset_default_get_meta (GstPreset * preset, const gchar * name,
   GKeyFile *presets;
   gchar *key;
 
+  PRESET_LOCK ();
+
   /* get the presets from the type */
   if (!(presets = preset_get_keyfile (preset)))
     goto no_presets;
@@ -848,6 +1098,7 @@ gst_preset_default_get_meta (GstPreset * preset, const gchar * name,
   *value = g_key_file_get_value (presets, name, key, NULL);
   g_free (key);
 
+  PRESET_UNLOCK ();
   return TRUE;
 
   /* ERRORS */
@@ -855,6 +1106,7 @@ no_presets:
   {
     GST_WARNING_OBJECT (preset, "no presets");
     *value = NULL;
+    PRESET_UNLOCK ();
     return FALSE;
   }
 }
@@ -1065,6 +1317,7 @@ gst_preset_base_init (gpointer g_class)
 
     /* create quarks for use with g_type_{g,s}et_qdata() */
     preset_quark = g_quark_from_static_string ("GstPreset::presets");
+    preset_cache_quark = g_quark_from_static_string ("GstPreset::cache");
     preset_user_path_quark =
         g_quark_from_static_string ("GstPreset::user_path");
     preset_system_path_quark =
@@ -159,6 +159,12 @@ struct _GstRegistryPrivate
 static GStaticMutex _gst_registry_mutex = G_STATIC_MUTEX_INIT;
 static GstRegistry *_gst_registry_default = NULL;
 
+/* registry cache files that stay mapped until gst_deinit() because the
+ * features loaded from them reference their strings in place. The pages are
+ * shared with every other process that mapped the same cache. */
+G_LOCK_DEFINE_STATIC (mappings_lock);
+static GSList *_gst_registry_mappings = NULL;
+
 /* defaults */
 #define DEFAULT_FORK TRUE
 
@@ -1304,6 +1310,58 @@ _priv_gst_registry_cleanup (void)
   /* unref outside of the lock because we can. */
   if (registry)
     gst_object_unref (registry);
+
+  /* only release the mappings now that the features pointing into them are
+   * gone */
+  G_LOCK (mappings_lock);
+  while (_gst_registry_mappings) {
+    GMappedFile *mapped = _gst_registry_mappings->data;
+
+#if GLIB_CHECK_VERSION(2,22,0)
+    g_mapped_file_unref (mapped);
+#else
+    g_mapped_file_free (mapped);
+#endif
+    _gst_registry_mappings = g_slist_delete_link (_gst_registry_mappings,
+        _gst_registry_mappings);
+  }
+  G_UNLOCK (mappings_lock);
+}
+
+/* takes ownership of @mapped */
+void
+_priv_gst_registry_keep_mapping (GMappedFile * mapped)
+{
+  G_LOCK (mappings_lock);
+  _gst_registry_mappings = g_slist_prepend (_gst_registry_mappings, mapped);
+  G_UNLOCK (mappings_lock);
+}
+
+/* checks if @mem points into one of the kept registry cache mappings, in
+ * which case it must not be freed */
+gboolean
+_priv_gst_registry_is_mapped (gconstpointer mem)
+{
+  GSList *walk;
+  gboolean res = FALSE;
+
+  if (mem == NULL || _gst_registry_mappings == NULL)
+    return FALSE;
+
+  G_LOCK (mappings_lock);
+  for (walk = _gst_registry_mappings; walk; walk = g_slist_next (walk)) {
+    GMappedFile *mapped = walk->data;
+    const gchar *start = g_mapped_file_get_contents (mapped);
+
+    if ((const gchar *) mem >= start &&
+        (const gchar *) mem < start + g_mapped_file_get_length (mapped)) {
+      res = TRUE;
+      break;
+    }
+  }
+  G_UNLOCK (mappings_lock);
+
+  return res;
 }
 
 /**
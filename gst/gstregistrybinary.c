@@ -23,14 +23,9 @@
  */
 
 /* FIXME:
- * - keep registry binary blob and reference strings
- *   - don't free/unmmap contents when leaving gst_registry_binary_read_cache()
- *     - free at gst_deinit() / _priv_gst_registry_cleanup() ?
- *   - GstPlugin:
- *     - GST_PLUGIN_FLAG_CONST
- *   - GstPluginFeature, GstIndexFactory, GstElementFactory
- *     - needs Flags (GST_PLUGIN_FEATURE_FLAG_CONST)
- *     - can we turn loaded into flag?
+ * - reference more strings from the mapped registry blob
+ *   - feature names, uri protocols and typefind extensions are still copied
+ *     because they are freed with g_strfreev() and friends
  * - why do we collect a list of binary chunks and not write immediately
  *   - because we need to process subchunks, before we can set e.g. nr_of_items
  *     in parent chunk
@@ -570,6 +565,18 @@ gst_registry_binary_read_cache (GstRegistry * registry, const char *location)
     goto done;
   }
 
+#ifndef G_OS_WIN32
+  /* keep the mapping around so that the plugins and features can reference
+   * its strings instead of copying them. The pages of the mapping are shared
+   * with all other processes using the same cache. Writing a new cache
+   * renames a new file over this one so the mapped contents stay valid. */
+  if (mapped) {
+    _priv_gst_registry_keep_mapping (mapped);
+    mapped = NULL;
+    contents = NULL;
+  }
+#endif
+
   /* check if there are plugins in the file */
   if (G_UNLIKELY (!(((gsize) in + sizeof (GstRegistryChunkPluginElement)) <
               (gsize) contents + size))) {
@@ -601,7 +608,6 @@ done:
   GST_INFO ("loaded %s in %lf seconds", location, seconds);
 
   res = TRUE;
-  /* TODO: once we re-use the pointers to registry contents, return here */
 
 Error:
   if (err)
@@ -84,6 +84,20 @@ _strnlen (const gchar * str, gint maxlen)
   inptr += _len + 1; \
 }G_STMT_END
 
+/* references the string in place when it lives in a registry cache that
+ * stays mapped, copies it otherwise. Free with
+ * _priv_gst_registry_free_string() */
+#define unpack_string_mapped(inptr, outptr, endptr, error_label)  G_STMT_START{\
+  gint _len = _strnlen (inptr, (endptr-inptr)); \
+  if (_len == -1) \
+    goto error_label; \
+  if (_priv_gst_registry_is_mapped (inptr)) \
+    outptr = (gchar *)inptr; \
+  else \
+    outptr = g_memdup ((gconstpointer)inptr, _len + 1); \
+  inptr += _len + 1; \
+}G_STMT_END
+
 #define unpack_string_nocopy(inptr, outptr, endptr, error_label)  G_STMT_START{\
   gint _len = _strnlen (inptr, (endptr-inptr)); \
   if (_len == -1) \
@@ -497,7 +511,7 @@ gst_registry_chunks_load_pad_template (GstElementFactory * factory, gchar ** in,
 
   /* unpack pad template strings */
   unpack_const_string (*in, template->name_template, end, fail);
-  unpack_string (*in, template->static_caps.string, end, fail);
+  unpack_string_mapped (*in, template->static_caps.string, end, fail);
 
   __gst_element_factory_add_static_pad_template (factory, template);
   GST_DEBUG ("Added pad_template %s", template->name_template);
@@ -573,10 +587,10 @@ gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
     pf = (GstRegistryChunkPluginFeature *) ef;
 
     /* unpack element factory strings */
-    unpack_string (*in, factory->details.longname, end, fail);
-    unpack_string (*in, factory->details.klass, end, fail);
-    unpack_string (*in, factory->details.description, end, fail);
-    unpack_string (*in, factory->details.author, end, fail);
+    unpack_string_mapped (*in, factory->details.longname, end, fail);
+    unpack_string_mapped (*in, factory->details.klass, end, fail);
+    unpack_string_mapped (*in, factory->details.description, end, fail);
+    unpack_string_mapped (*in, factory->details.author, end, fail);
     n = ef->npadtemplates;
     GST_DEBUG ("Element factory : '%s' with npadtemplates=%d",
         factory->details.longname, n);
@@ -651,7 +665,7 @@ gst_registry_chunks_load_feature (GstRegistry * registry, gchar ** in,
     unpack_element (*in, pf, GstRegistryChunkPluginFeature, end, fail);
 
     /* unpack index factory strings */
-    unpack_string (*in, factory->longdesc, end, fail);
+    unpack_string_mapped (*in, factory->longdesc, end, fail);
   } else {
     GST_WARNING ("unhandled factory type : %s", G_OBJECT_TYPE_NAME (feature));
     goto fail;
@@ -765,15 +779,14 @@ _priv_gst_registry_chunks_load_plugin (GstRegistry * registry, gchar ** in,
 
   plugin = g_object_newv (GST_TYPE_PLUGIN, 0, NULL);
 
-  /* TODO: also set GST_PLUGIN_FLAG_CONST */
   plugin->flags |= GST_PLUGIN_FLAG_CACHED;
   plugin->file_mtime = pe->file_mtime;
   plugin->file_size = pe->file_size;
 
   /* unpack plugin element strings */
   unpack_const_string (*in, plugin->desc.name, end, fail);
-  unpack_string (*in, plugin->desc.description, end, fail);
-  unpack_string (*in, plugin->filename, end, fail);
+  unpack_string_mapped (*in, plugin->desc.description, end, fail);
+  unpack_string_mapped (*in, plugin->filename, end, fail);
   unpack_const_string (*in, plugin->desc.version, end, fail);
   unpack_const_string (*in, plugin->desc.license, end, fail);
   unpack_const_string (*in, plugin->desc.source, end, fail);
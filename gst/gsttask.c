@@ -49,6 +49,11 @@
  * the function it will acquire the provided lock. The provided lock is released
  * when the task pauses or stops.
  *
+ * A cooperative task, configured with gst_task_set_cooperative(), does not have
+ * to block its thread while waiting for data. Its function calls
+ * gst_task_suspend() and returns, after which the thread and the lock are
+ * released until another thread calls gst_task_resume(). Since 0.10.31.
+ *
  * Stopping a task with gst_task_stop() will not immediately make sure the task is
  * not running anymore. Use gst_task_join() to make sure the task is completely
  * stopped and the thread is stopped.
@@ -101,6 +106,18 @@ struct _GstTaskPrivate
   /* remember the pool and id that is currently running. */
   gpointer id;
   GstTaskPool *pool_id;
+
+  /* cooperative scheduling, see gst_task_suspend() */
+  gboolean cooperative;
+  /* the task function asked to give up the thread after this iteration */
+  gboolean suspend;
+  /* gst_task_resume() was called during this iteration */
+  gboolean resume;
+  /* the thread was given up, the task is started but has no thread */
+  gboolean suspended;
+  /* the thread the enter_thread callback was called for, the task stays
+   * entered while it is suspended until it is resumed in another thread */
+  GThread *entered;
 };
 
 static void gst_task_finalize (GObject * object);
@@ -213,8 +230,9 @@ static void
 gst_task_func (GstTask * task)
 {
   GStaticRecMutex *lock;
-  GThread *tself;
+  GThread *tself, *entered;
   GstTaskPrivate *priv;
+  gboolean suspending = FALSE;
 
   priv = task->priv;
 
@@ -226,6 +244,7 @@ gst_task_func (GstTask * task)
    * mark our state running so that nobody can mess with
    * the mutex. */
   GST_OBJECT_LOCK (task);
+restart:
   if (task->state == GST_TASK_STOPPED)
     goto exit;
   lock = GST_TASK_GET_LOCK (task);
@@ -235,11 +254,20 @@ gst_task_func (GstTask * task)
   /* only update the priority when it was changed */
   if (priv->prio_set)
     g_thread_set_priority (tself, priv->priority);
+  /* a resumed task did not leave the thread it was suspended in */
+  entered = priv->entered;
+  priv->entered = tself;
   GST_OBJECT_UNLOCK (task);
 
-  /* fire the enter_thread callback when we need to */
-  if (priv->thr_callbacks.enter_thread)
-    priv->thr_callbacks.enter_thread (task, tself, priv->thr_user_data);
+  if (entered != tself) {
+    /* a resumed task that got another thread from the pool leaves the
+     * previous one first */
+    if (entered && priv->thr_callbacks.leave_thread)
+      priv->thr_callbacks.leave_thread (task, entered, priv->thr_user_data);
+    /* fire the enter_thread callback when we need to */
+    if (priv->thr_callbacks.enter_thread)
+      priv->thr_callbacks.enter_thread (task, tself, priv->thr_user_data);
+  }
 
   /* locking order is TASK_LOCK, LOCK */
   g_static_rec_mutex_lock (lock);
@@ -266,11 +294,21 @@ gst_task_func (GstTask * task)
       if (G_UNLIKELY (task->state == GST_TASK_STOPPED))
         goto done;
     }
+    priv->resume = FALSE;
     GST_OBJECT_UNLOCK (task);
 
     task->func (task->data);
 
     GST_OBJECT_LOCK (task);
+    if (G_UNLIKELY (priv->suspend)) {
+      priv->suspend = FALSE;
+      /* give the thread back unless we were resumed in the meantime */
+      if (task->state == GST_TASK_STARTED && !priv->resume) {
+        GST_DEBUG_OBJECT (task, "suspending task %p", task);
+        priv->suspended = suspending = TRUE;
+        break;
+      }
+    }
   }
 done:
   GST_OBJECT_UNLOCK (task);
@@ -279,14 +317,34 @@ done:
   GST_OBJECT_LOCK (task);
   task->abidata.ABI.thread = NULL;
 
+  /* resumed while we were giving up the thread, resume_task() did not
+   * schedule a new one so we simply continue here */
+  if (suspending && !priv->suspended && task->state != GST_TASK_STOPPED) {
+    GST_DEBUG_OBJECT (task, "task %p resumed while suspending", task);
+    suspending = FALSE;
+    goto restart;
+  }
+
 exit:
-  if (priv->thr_callbacks.leave_thread) {
+  if (suspending) {
+    /* the thread goes back to the pool but the task is not left, the
+     * callbacks are only called again when it is resumed in another thread */
+    if (!priv->thr_callbacks.leave_thread)
+      g_thread_set_priority (tself, G_THREAD_PRIORITY_NORMAL);
+  } else if (priv->thr_callbacks.leave_thread) {
+    /* when we did not get to run, the task might still be entered in the
+     * thread it was suspended in */
+    entered = priv->entered;
+    priv->entered = NULL;
     /* fire the leave_thread callback when we need to. We need to do this before
      * we signal the task and with the task lock released. */
-    GST_OBJECT_UNLOCK (task);
-    priv->thr_callbacks.leave_thread (task, tself, priv->thr_user_data);
-    GST_OBJECT_LOCK (task);
+    if (entered) {
+      GST_OBJECT_UNLOCK (task);
+      priv->thr_callbacks.leave_thread (task, entered, priv->thr_user_data);
+      GST_OBJECT_LOCK (task);
+    }
   } else {
+    priv->entered = NULL;
     /* restore normal priority when releasing back into the pool, we will not
      * touch the priority when a custom callback has been installed. */
     g_thread_set_priority (tself, G_THREAD_PRIORITY_NORMAL);
@@ -299,7 +357,12 @@ exit:
    * before releasing the lock as we can be sure that a ref is held by the
    * caller of the join(). */
   task->running = FALSE;
-  GST_TASK_SIGNAL (task);
+  if (suspending) {
+    /* a join() and a resume() can both be waiting for us */
+    g_cond_broadcast (GST_TASK_GET_COND (task));
+  } else {
+    GST_TASK_SIGNAL (task);
+  }
   GST_OBJECT_UNLOCK (task);
 
   GST_DEBUG ("Exit task %p, thread %p", task, g_thread_self ());
@@ -590,6 +653,15 @@ start_task (GstTask * task)
 
   priv = task->priv;
 
+  /* a suspended task left its previous thread, release it */
+  if (priv->pool_id) {
+    if (priv->id)
+      gst_task_pool_join (priv->pool_id, priv->id);
+    gst_object_unref (priv->pool_id);
+    priv->pool_id = NULL;
+    priv->id = NULL;
+  }
+
   /* new task, We ref before so that it remains alive while
    * the thread is running. */
   gst_object_ref (task);
@@ -613,6 +685,28 @@ start_task (GstTask * task)
 }
 
 
+/* give a suspended task a thread again.
+ * This function must be called with the task LOCK. */
+static gboolean
+resume_task (GstTask * task)
+{
+  GstTaskPrivate *priv = task->priv;
+
+  priv->suspended = FALSE;
+  if (task->state == GST_TASK_STOPPED)
+    return TRUE;
+
+  /* the previous thread is still on its way out, it sees that we cleared the
+   * suspended flag and runs the function again. We don't wait for it here
+   * because the caller usually holds the lock the task function takes. */
+  if (G_UNLIKELY (task->running))
+    return TRUE;
+
+  GST_DEBUG_OBJECT (task, "resuming task %p", task);
+
+  return start_task (task);
+}
+
 /**
  * gst_task_set_state:
  * @task: a #GstTask
@@ -662,7 +756,14 @@ gst_task_set_state (GstTask * task, GstTaskState state)
         break;
       case GST_TASK_STARTED:
         /* if we were started, we'll go to the new state after the next
-         * iteration. */
+         * iteration. A suspended task needs a thread for that, unless it
+         * is stopped. */
+        if (G_UNLIKELY (task->priv->suspended)) {
+          if (state == GST_TASK_STOPPED)
+            task->priv->suspended = FALSE;
+          else
+            res = resume_task (task);
+        }
         break;
     }
   }
@@ -754,7 +855,7 @@ gst_task_pause (GstTask * task)
 gboolean
 gst_task_join (GstTask * task)
 {
-  GThread *tself;
+  GThread *tself, *entered;
   GstTaskPrivate *priv;
   gpointer id;
   GstTaskPool *pool = NULL;
@@ -773,6 +874,8 @@ gst_task_join (GstTask * task)
   if (G_UNLIKELY (tself == task->abidata.ABI.thread))
     goto joining_self;
   task->state = GST_TASK_STOPPED;
+  /* a suspended task has no thread to stop */
+  priv->suspended = FALSE;
   /* signal the state change for when it was blocked in PAUSED. */
   GST_TASK_SIGNAL (task);
   /* we set the running flag when pushing the task on the thread pool.
@@ -787,8 +890,14 @@ gst_task_join (GstTask * task)
   id = priv->id;
   priv->pool_id = NULL;
   priv->id = NULL;
+  /* a task stopped while suspended has no thread that leaves */
+  entered = priv->entered;
+  priv->entered = NULL;
   GST_OBJECT_UNLOCK (task);
 
+  if (entered && priv->thr_callbacks.leave_thread)
+    priv->thr_callbacks.leave_thread (task, entered, priv->thr_user_data);
+
   if (pool) {
     if (id)
       gst_task_pool_join (pool, id);
@@ -811,3 +920,107 @@ joining_self:
     return FALSE;
   }
 }
+
+/**
+ * gst_task_set_cooperative:
+ * @task: a #GstTask
+ * @cooperative: %TRUE to let the task function give up its thread
+ *
+ * Allows the function of @task to give up the streaming thread with
+ * gst_task_suspend() instead of blocking on it. A suspended task does not
+ * occupy a thread of its #GstTaskPool until it is resumed with
+ * gst_task_resume(), so a small pool can run many tasks that mostly wait.
+ *
+ * The enter_thread and leave_thread callbacks set with
+ * gst_task_set_thread_callbacks() are not called when the task suspends. When
+ * the task is resumed in another thread of the pool, leave_thread is called
+ * for the thread it was suspended in and enter_thread for the new thread,
+ * from the new thread.
+ *
+ * This can be configured when the #GST_STREAM_STATUS_TYPE_CREATE message is
+ * posted for @task, together with gst_task_set_pool().
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+void
+gst_task_set_cooperative (GstTask * task, gboolean cooperative)
+{
+  g_return_if_fail (GST_IS_TASK (task));
+
+  GST_OBJECT_LOCK (task);
+  task->priv->cooperative = cooperative;
+  GST_OBJECT_UNLOCK (task);
+}
+
+/**
+ * gst_task_suspend:
+ * @task: a #GstTask
+ *
+ * Called from the function of @task when it would have to block until some
+ * other thread makes progress, for example when a queue is empty. When this
+ * function returns %TRUE, the task function should return right away; @task
+ * then gives its thread back to the pool, releases its lock and stays in the
+ * %GST_TASK_STARTED state until gst_task_resume() is called.
+ *
+ * When @task is not cooperative, this function returns %FALSE and the task
+ * function has to wait as usual.
+ *
+ * Returns: %TRUE when @task will be suspended after the current iteration.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+gboolean
+gst_task_suspend (GstTask * task)
+{
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_TASK (task), FALSE);
+
+  GST_OBJECT_LOCK (task);
+  res = task->priv->cooperative &&
+      task->abidata.ABI.thread == g_thread_self ();
+  if (res)
+    task->priv->suspend = TRUE;
+  GST_OBJECT_UNLOCK (task);
+
+  return res;
+}
+
+/**
+ * gst_task_resume:
+ * @task: a #GstTask
+ *
+ * Schedules the function of a task that was suspended with gst_task_suspend()
+ * on a thread of its pool again. When @task is currently running its function,
+ * a pending suspend of this iteration is cancelled so that no wakeup is lost.
+ *
+ * This function should be called whenever the condition a cooperative task
+ * waits for might have changed. It does nothing for a task that is not
+ * suspended.
+ *
+ * Returns: %TRUE if the task could be resumed.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+gboolean
+gst_task_resume (GstTask * task)
+{
+  gboolean res = TRUE;
+
+  g_return_val_if_fail (GST_IS_TASK (task), FALSE);
+
+  GST_OBJECT_LOCK (task);
+  if (task->priv->suspended)
+    res = resume_task (task);
+  else if (task->running)
+    task->priv->resume = TRUE;
+  GST_OBJECT_UNLOCK (task);
+
+  return res;
+}
@@ -200,6 +200,10 @@ gboolean        gst_task_pause          (GstTask *task);
 
 gboolean        gst_task_join           (GstTask *task);
 
+void            gst_task_set_cooperative (GstTask *task, gboolean cooperative);
+gboolean        gst_task_suspend        (GstTask *task);
+gboolean        gst_task_resume         (GstTask *task);
+
 G_END_DECLS
 
 #endif /* __GST_TASK_H__ */
@@ -488,67 +488,173 @@ gst_uri_construct (const gchar * protocol, const gchar * location)
   return retval;
 }
 
+static gint
+sort_by_rank (GstPluginFeature * first, GstPluginFeature * second)
+{
+  return gst_plugin_feature_get_rank (second) -
+      gst_plugin_feature_get_rank (first);
+}
+
+/* Index of the element factories of the default registry by URI type and
+ * protocol. It is rebuilt when the feature list cookie of the registry
+ * changes, so that a lookup is a hash table lookup. Protocols are compared
+ * case insensitively and protocols that are not in the index have no
+ * handler, so unknown protocols are answered without scanning the registry
+ * either. */
 typedef struct
 {
-  GstURIType type;
-  const gchar *protocol;
+  GstRegistry *registry;
+  guint32 cookie;
+  /* protocol -> GList of reffed factories, sorted by rank */
+  GHashTable *protocols[GST_URI_SINK + 1];
+} URIIndex;
+
+static GStaticMutex uri_index_lock = G_STATIC_MUTEX_INIT;
+static URIIndex uri_index = { NULL, };
+
+static guint
+protocol_hash (gconstpointer key)
+{
+  const gchar *p = key;
+  guint h = 5381;
+
+  for (; *p != '\0'; p++)
+    h = (h << 5) + h + g_ascii_tolower (*p);
+
+  return h;
 }
-SearchEntry;
 
 static gboolean
-search_by_entry (GstPluginFeature * feature, gpointer search_entry)
+protocol_equal (gconstpointer a, gconstpointer b)
 {
-  gchar **protocols;
-  GstElementFactory *factory;
-  SearchEntry *entry = (SearchEntry *) search_entry;
+  return g_ascii_strcasecmp (a, b) == 0;
+}
 
-  if (!GST_IS_ELEMENT_FACTORY (feature))
-    return FALSE;
-  factory = GST_ELEMENT_FACTORY_CAST (feature);
+static void
+uri_index_clear (void)
+{
+  gint i;
 
-  if (factory->uri_type != entry->type)
-    return FALSE;
+  for (i = GST_URI_SRC; i <= GST_URI_SINK; i++) {
+    if (uri_index.protocols[i]) {
+      g_hash_table_destroy (uri_index.protocols[i]);
+      uri_index.protocols[i] = NULL;
+    }
+  }
+  uri_index.registry = NULL;
+}
 
-  protocols = gst_element_factory_get_uri_protocols (factory);
+/* with uri_index_lock */
+static void
+uri_index_update (void)
+{
+  GstRegistry *registry;
+  GHashTable *found[GST_URI_SINK + 1];
+  GList *features, *walk;
+  guint32 cookie;
+  gint i;
+
+  registry = gst_registry_get_default ();
+  cookie = gst_registry_get_feature_list_cookie (registry);
+
+  if (G_LIKELY (uri_index.registry == registry && uri_index.cookie == cookie))
+    return;
+
+  GST_DEBUG ("building URI protocol index");
+
+  /* collect the factories per protocol in registry order first */
+  for (i = GST_URI_SRC; i <= GST_URI_SINK; i++)
+    found[i] = g_hash_table_new (protocol_hash, protocol_equal);
+
+  features = gst_registry_get_feature_list (registry,
+      GST_TYPE_ELEMENT_FACTORY);
+  for (walk = features; walk; walk = walk->next) {
+    GstElementFactory *factory = GST_ELEMENT_FACTORY_CAST (walk->data);
+    gchar **protocols;
+
+    if (!GST_URI_TYPE_IS_VALID (factory->uri_type))
+      continue;
+
+    protocols = gst_element_factory_get_uri_protocols (factory);
+    if (protocols == NULL) {
+      g_warning ("Factory '%s' implements GstUriHandler interface but "
+          "returned no supported protocols!",
+          gst_plugin_feature_get_name (GST_PLUGIN_FEATURE_CAST (factory)));
+      continue;
+    }
 
-  if (protocols == NULL) {
-    g_warning ("Factory '%s' implements GstUriHandler interface but returned "
-        "no supported protocols!", gst_plugin_feature_get_name (feature));
-    return FALSE;
+    for (; *protocols != NULL; protocols++) {
+      GList *list = g_hash_table_lookup (found[factory->uri_type], *protocols);
+
+      if (g_list_find (list, factory))
+        continue;
+      list = g_list_prepend (list, gst_object_ref (factory));
+      g_hash_table_insert (found[factory->uri_type], *protocols, list);
+    }
   }
 
-  while (*protocols != NULL) {
-    if (g_ascii_strcasecmp (*protocols, entry->protocol) == 0)
-      return TRUE;
-    protocols++;
+  uri_index_clear ();
+  for (i = GST_URI_SRC; i <= GST_URI_SINK; i++) {
+    GHashTableIter iter;
+    gpointer key, value;
+
+    uri_index.protocols[i] = g_hash_table_new_full (protocol_hash,
+        protocol_equal, g_free, (GDestroyNotify) gst_plugin_feature_list_free);
+
+    /* g_list_sort is stable so factories of the same rank stay in registry
+     * order */
+    g_hash_table_iter_init (&iter, found[i]);
+    while (g_hash_table_iter_next (&iter, &key, &value)) {
+      GList *list = g_list_reverse ((GList *) value);
+
+      g_hash_table_insert (uri_index.protocols[i], g_strdup (key),
+          g_list_sort (list, (GCompareFunc) sort_by_rank));
+    }
+    g_hash_table_destroy (found[i]);
   }
-  return FALSE;
+  /* the protocol strings belong to the factories, free them last */
+  gst_plugin_feature_list_free (features);
+
+  uri_index.registry = registry;
+  uri_index.cookie = cookie;
 }
 
-static gint
-sort_by_rank (GstPluginFeature * first, GstPluginFeature * second)
+/* with uri_index_lock */
+static GList *
+uri_index_lookup (const GstURIType type, const gchar * protocol)
 {
-  return gst_plugin_feature_get_rank (second) -
-      gst_plugin_feature_get_rank (first);
+  if (!GST_URI_TYPE_IS_VALID (type))
+    return NULL;
+
+  uri_index_update ();
+  return g_hash_table_lookup (uri_index.protocols[type], protocol);
 }
 
+/* returns a reffed and rank sorted copy of the factories for @protocol */
 static GList *
 get_element_factories_from_uri_protocol (const GstURIType type,
     const gchar * protocol)
 {
   GList *possibilities;
-  SearchEntry entry;
 
   g_return_val_if_fail (protocol, NULL);
 
-  entry.type = type;
-  entry.protocol = protocol;
-  possibilities = gst_registry_feature_filter (gst_registry_get_default (),
-      search_by_entry, FALSE, &entry);
+  g_static_mutex_lock (&uri_index_lock);
+  possibilities = gst_plugin_feature_list_copy (uri_index_lookup (type,
+          protocol));
+  g_static_mutex_unlock (&uri_index_lock);
 
   return possibilities;
 }
 
+void
+_priv_gst_uri_cleanup (void)
+{
+  g_static_mutex_lock (&uri_index_lock);
+  uri_index_clear ();
+  g_static_mutex_unlock (&uri_index_lock);
+}
+
 /**
  * gst_uri_protocol_is_supported:
  * @type: Whether to check for a source or a sink
@@ -565,17 +671,15 @@ get_element_factories_from_uri_protocol (const GstURIType type,
 gboolean
 gst_uri_protocol_is_supported (const GstURIType type, const gchar * protocol)
 {
-  GList *possibilities;
+  gboolean res;
 
   g_return_val_if_fail (protocol, FALSE);
 
-  possibilities = get_element_factories_from_uri_protocol (type, protocol);
+  g_static_mutex_lock (&uri_index_lock);
+  res = uri_index_lookup (type, protocol) != NULL;
+  g_static_mutex_unlock (&uri_index_lock);
 
-  if (possibilities) {
-    g_list_free (possibilities);
-    return TRUE;
-  } else
-    return FALSE;
+  return res;
 }
 
 /**
@@ -609,7 +713,6 @@ gst_element_make_from_uri (const GstURIType type, const gchar * uri,
     return NULL;
   }
 
-  possibilities = g_list_sort (possibilities, (GCompareFunc) sort_by_rank);
   walk = possibilities;
   while (walk) {
     if ((ret =
@@ -197,6 +197,15 @@ enum
 #define DEFAULT_NUM_BUFFERS     -1
 #define DEFAULT_TYPEFIND        FALSE
 #define DEFAULT_DO_TIMESTAMP    FALSE
+#define DEFAULT_SMOOTH_TIMESTAMPS FALSE
+
+/* coefficients of the second order delay-locked loop that smoothes the
+ * timestamps of do-timestamp, for a loop bandwidth of about 1/125 of the
+ * buffer rate. A measurement that is further than SMOOTH_RESYNC away from the
+ * prediction restarts the loop. */
+#define SMOOTH_B                0.0707
+#define SMOOTH_C                0.0025
+#define SMOOTH_RESYNC           (200.0 * GST_MSECOND)
 
 enum
 {
@@ -204,7 +213,8 @@ enum
   PROP_BLOCKSIZE,
   PROP_NUM_BUFFERS,
   PROP_TYPEFIND,
-  PROP_DO_TIMESTAMP
+  PROP_DO_TIMESTAMP,
+  PROP_SMOOTH_TIMESTAMPS
 };
 
 #define GST_BASE_SRC_GET_PRIVATE(obj)  \
@@ -235,6 +245,18 @@ struct _GstBaseSrcPrivate
 
   gboolean do_timestamp;
 
+  /* delay-locked loop that smoothes the running times used for do-timestamp,
+   * with LOCK */
+  gboolean smooth_timestamps;
+  guint dll_count;
+  gdouble dll_t0;
+  gdouble dll_t1;
+  gdouble dll_period;
+
+  /* buffers of the last create_list call that still need to be pushed,
+   * with LIVE_LOCK */
+  GQueue batch;
+
   /* stream sequence number */
   guint32 seqnum;
 
@@ -362,6 +384,19 @@ gst_base_src_class_init (GstBaseSrcClass * klass)
       g_param_spec_boolean ("do-timestamp", "Do timestamp",
           "Apply current stream time to buffers", DEFAULT_DO_TIMESTAMP,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstBaseSrc:smooth-timestamps
+   *
+   * Smooth the timestamps applied with do-timestamp so that scheduling jitter
+   * of the streaming thread does not end up in the timestamps.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_SMOOTH_TIMESTAMPS,
+      g_param_spec_boolean ("smooth-timestamps", "Smooth timestamps",
+          "Smooth the timestamps applied with do-timestamp",
+          DEFAULT_SMOOTH_TIMESTAMPS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_base_src_change_state);
@@ -436,6 +471,8 @@ gst_base_src_init (GstBaseSrc * basesrc, gpointer g_class)
   gst_base_src_set_format (basesrc, GST_FORMAT_BYTES);
   basesrc->data.ABI.typefind = DEFAULT_TYPEFIND;
   basesrc->priv->do_timestamp = DEFAULT_DO_TIMESTAMP;
+  basesrc->priv->smooth_timestamps = DEFAULT_SMOOTH_TIMESTAMPS;
+  g_queue_init (&basesrc->priv->batch);
 
   GST_OBJECT_FLAG_UNSET (basesrc, GST_BASE_SRC_STARTED);
 
@@ -461,6 +498,9 @@ gst_base_src_finalize (GObject * object)
     g_list_free (basesrc->priv->pending_tags);
   }
 
+  g_queue_foreach (&basesrc->priv->batch, (GFunc) gst_buffer_unref, NULL);
+  g_queue_clear (&basesrc->priv->batch);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -717,6 +757,55 @@ gst_base_src_get_do_timestamp (GstBaseSrc * src)
   return res;
 }
 
+/**
+ * gst_base_src_set_smooth_timestamps:
+ * @src: the source
+ * @smooth: enable or disable timestamp smoothing
+ *
+ * Configure @src to smooth the timestamps it applies to outgoing buffers when
+ * do-timestamp is enabled. The running time measured when the subclass
+ * returns a buffer then goes through a delay-locked loop that follows the
+ * actual rate of the source, so that the scheduling jitter of the streaming
+ * thread does not end up in the timestamps. The durations of the buffers are
+ * used as the nominal rate when they are set.
+ *
+ * Since: 0.10.31
+ */
+void
+gst_base_src_set_smooth_timestamps (GstBaseSrc * src, gboolean smooth)
+{
+  g_return_if_fail (GST_IS_BASE_SRC (src));
+
+  GST_OBJECT_LOCK (src);
+  src->priv->smooth_timestamps = smooth;
+  src->priv->dll_count = 0;
+  GST_OBJECT_UNLOCK (src);
+}
+
+/**
+ * gst_base_src_get_smooth_timestamps:
+ * @src: the source
+ *
+ * Query if @src smoothes the timestamps it applies to outgoing buffers.
+ *
+ * Returns: %TRUE if the timestamps applied with do-timestamp are smoothed.
+ *
+ * Since: 0.10.31
+ */
+gboolean
+gst_base_src_get_smooth_timestamps (GstBaseSrc * src)
+{
+  gboolean res;
+
+  g_return_val_if_fail (GST_IS_BASE_SRC (src), FALSE);
+
+  GST_OBJECT_LOCK (src);
+  res = src->priv->smooth_timestamps;
+  GST_OBJECT_UNLOCK (src);
+
+  return res;
+}
+
 /**
  * gst_base_src_new_seamless_segment:
  * @src: The source
@@ -1786,6 +1875,9 @@ gst_base_src_set_property (GObject * object, guint prop_id,
     case PROP_DO_TIMESTAMP:
       gst_base_src_set_do_timestamp (src, g_value_get_boolean (value));
       break;
+    case PROP_SMOOTH_TIMESTAMPS:
+      gst_base_src_set_smooth_timestamps (src, g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1813,6 +1905,9 @@ gst_base_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_DO_TIMESTAMP:
       g_value_set_boolean (value, gst_base_src_get_do_timestamp (src));
       break;
+    case PROP_SMOOTH_TIMESTAMPS:
+      g_value_set_boolean (value, gst_base_src_get_smooth_timestamps (src));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1841,6 +1936,165 @@ gst_base_src_wait (GstBaseSrc * basesrc, GstClock * clock, GstClockTime time)
   return ret;
 }
 
+/* smooth the running @time at which a buffer was measured, @period is the
+ * nominal time since the previous measurement or GST_CLOCK_TIME_NONE.
+ * with LOCK */
+static GstClockTime
+gst_base_src_smooth_timestamp (GstBaseSrc * src, GstClockTime time,
+    GstClockTime period)
+{
+  GstBaseSrcPrivate *priv = src->priv;
+  gdouble e;
+
+  if (!priv->smooth_timestamps)
+    return time;
+
+  if (priv->dll_count > 0 && priv->dll_period > 0.0) {
+    e = (gdouble) time - priv->dll_t1;
+    if (e > -SMOOTH_RESYNC && e < SMOOTH_RESYNC) {
+      priv->dll_t0 = priv->dll_t1;
+      priv->dll_t1 += SMOOTH_B * e + priv->dll_period;
+      priv->dll_period += SMOOTH_C * e;
+      priv->dll_count++;
+
+      GST_LOG_OBJECT (src, "smoothed %" GST_TIME_FORMAT " by %.0f ns",
+          GST_TIME_ARGS (time), priv->dll_t0 - (gdouble) time);
+
+      return priv->dll_t0 > 0.0 ? (GstClockTime) priv->dll_t0 : 0;
+    }
+    GST_DEBUG_OBJECT (src, "timestamp off by %.0f ns, resync", e);
+    priv->dll_count = 0;
+  }
+
+  if (priv->dll_count == 0) {
+    /* (re)start with the nominal period when it is known */
+    priv->dll_period = GST_CLOCK_TIME_IS_VALID (period) ? (gdouble) period : 0.0;
+  } else {
+    /* no nominal period, take the first interval as an estimate */
+    priv->dll_period = (gdouble) time - priv->dll_t0;
+  }
+  priv->dll_t0 = time;
+  priv->dll_t1 = (gdouble) time + priv->dll_period;
+  priv->dll_count++;
+
+  return time;
+}
+
+/* timestamp the buffers of a new batch that have no timestamp. The last
+ * buffer gets the current running time like a single buffer would, the
+ * other ones are placed before it according to their durations.
+ * with LIVE_LOCK */
+static void
+gst_base_src_timestamp_batch (GstBaseSrc * src)
+{
+  GstClock *clock;
+  GstClockTime now, total = 0, ts;
+  GList *walk;
+
+  GST_OBJECT_LOCK (src);
+  if (!src->priv->do_timestamp || (clock = GST_ELEMENT_CLOCK (src)) == NULL) {
+    GST_OBJECT_UNLOCK (src);
+    return;
+  }
+
+  for (walk = src->priv->batch.head; walk; walk = g_list_next (walk)) {
+    GstClockTime duration = GST_BUFFER_DURATION (walk->data);
+
+    if (GST_CLOCK_TIME_IS_VALID (duration))
+      total += duration;
+  }
+
+  now = gst_clock_get_time (clock) - GST_ELEMENT_CAST (src)->base_time;
+  ts = gst_base_src_smooth_timestamp (src, now,
+      total > 0 ? total : GST_CLOCK_TIME_NONE);
+  GST_OBJECT_UNLOCK (src);
+
+  for (walk = src->priv->batch.tail; walk; walk = g_list_previous (walk)) {
+    GstBuffer *buf = walk->data;
+
+    if (walk != src->priv->batch.tail) {
+      GstClockTime duration = GST_BUFFER_DURATION (buf);
+
+      if (GST_CLOCK_TIME_IS_VALID (duration))
+        ts = ts > duration ? ts - duration : 0;
+    }
+    if (!GST_BUFFER_TIMESTAMP_IS_VALID (buf)) {
+      buf = gst_buffer_make_metadata_writable (buf);
+      GST_BUFFER_TIMESTAMP (buf) = ts;
+      walk->data = buf;
+    }
+  }
+
+  GST_LOG_OBJECT (src, "timestamped batch of %u buffers ending at %"
+      GST_TIME_FORMAT, g_queue_get_length (&src->priv->batch),
+      GST_TIME_ARGS (ts));
+}
+
+/* with LIVE_LOCK */
+static void
+gst_base_src_clear_batch (GstBaseSrc * src)
+{
+  GstBuffer *buf;
+
+  while ((buf = g_queue_pop_head (&src->priv->batch)))
+    gst_buffer_unref (buf);
+}
+
+/* let the subclass create a buffer. In push mode, a subclass with a
+ * create_list function can produce several buffers at once, they are then
+ * handed out one by one.
+ * with STREAM_LOCK and LIVE_LOCK */
+static GstFlowReturn
+gst_base_src_create (GstBaseSrc * src, guint64 offset, guint length,
+    GstBuffer ** buf)
+{
+  GstBaseSrcClass *bclass;
+  GstBufferList *list = NULL;
+  GstBufferListIterator *it;
+  GstBuffer *buffer;
+  GstFlowReturn ret;
+
+  bclass = GST_BASE_SRC_GET_CLASS (src);
+
+  if (G_LIKELY (g_queue_is_empty (&src->priv->batch))) {
+    if (bclass->create_list == NULL ||
+        GST_PAD_ACTIVATE_MODE (src->srcpad) != GST_ACTIVATE_PUSH) {
+      if (G_UNLIKELY (!bclass->create))
+        return GST_FLOW_ERROR;
+      return bclass->create (src, offset, length, buf);
+    }
+
+    ret = bclass->create_list (src, offset, length, &list);
+    if (G_UNLIKELY (ret != GST_FLOW_OK))
+      return ret;
+
+    it = gst_buffer_list_iterate (list);
+    while (gst_buffer_list_iterator_next_group (it)) {
+      while ((buffer = gst_buffer_list_iterator_next (it)))
+        g_queue_push_tail (&src->priv->batch, gst_buffer_ref (buffer));
+    }
+    gst_buffer_list_iterator_free (it);
+    gst_buffer_list_unref (list);
+
+    if (G_UNLIKELY (g_queue_is_empty (&src->priv->batch)))
+      goto empty_list;
+
+    gst_base_src_timestamp_batch (src);
+  }
+
+  *buf = g_queue_pop_head (&src->priv->batch);
+
+  return GST_FLOW_OK;
+
+  /* ERRORS */
+empty_list:
+  {
+    GST_ELEMENT_ERROR (src, STREAM, FAILED,
+        (_("Internal data flow error.")), ("element returned empty list"));
+    return GST_FLOW_ERROR;
+  }
+}
+
 /* perform synchronisation on a buffer.
  * with STREAM_LOCK.
  */
@@ -1936,7 +2190,8 @@ gst_base_src_do_sync (GstBaseSrc * basesrc, GstBuffer * buffer)
 
     if (!GST_CLOCK_TIME_IS_VALID (timestamp)) {
       if (do_timestamp)
-        timestamp = running_time;
+        timestamp = gst_base_src_smooth_timestamp (basesrc, running_time,
+            GST_BUFFER_DURATION (buffer));
       else
         timestamp = 0;
 
@@ -1954,10 +2209,12 @@ gst_base_src_do_sync (GstBaseSrc * basesrc, GstBuffer * buffer)
     if (do_timestamp && !GST_CLOCK_TIME_IS_VALID (timestamp)) {
       now = gst_clock_get_time (clock);
 
-      GST_BUFFER_TIMESTAMP (buffer) = now - base_time;
+      GST_BUFFER_TIMESTAMP (buffer) =
+          gst_base_src_smooth_timestamp (basesrc, now - base_time,
+          GST_BUFFER_DURATION (buffer));
 
       GST_LOG_OBJECT (basesrc, "created timestamp: %" GST_TIME_FORMAT,
-          GST_TIME_ARGS (now - base_time));
+          GST_TIME_ARGS (GST_BUFFER_TIMESTAMP (buffer)));
     }
   }
 
@@ -2097,7 +2354,7 @@ again:
   if (G_UNLIKELY (!GST_OBJECT_FLAG_IS_SET (src, GST_BASE_SRC_STARTED)))
     goto not_started;
 
-  if (G_UNLIKELY (!bclass->create))
+  if (G_UNLIKELY (!bclass->create && !bclass->create_list))
     goto no_function;
 
   if (G_UNLIKELY (!gst_base_src_update_length (src, offset, &length)))
@@ -2120,7 +2377,7 @@ again:
       "calling create offset %" G_GUINT64_FORMAT " length %u, time %"
       G_GINT64_FORMAT, offset, length, src->segment.time);
 
-  ret = bclass->create (src, offset, length, buf);
+  ret = gst_base_src_create (src, offset, length, buf);
 
   /* The create function could be unlocked because we have a pending EOS. It's
    * possible that we have a valid buffer from create that we need to
@@ -2819,6 +3076,9 @@ gst_base_src_set_flushing (GstBaseSrc * basesrc,
     /* clear pending EOS if any */
     g_atomic_int_set (&basesrc->priv->pending_eos, FALSE);
 
+    /* drop what is left of the last batch */
+    gst_base_src_clear_batch (basesrc);
+
     /* step 1, now that we have the LIVE lock, clear our unlock request */
     if (bclass->unlock_stop)
       bclass->unlock_stop (basesrc);
@@ -2876,6 +3136,9 @@ gst_base_src_set_playing (GstBaseSrc * basesrc, gboolean live_play)
 
     /* for live sources we restart the timestamp correction */
     basesrc->priv->latency = -1;
+    GST_OBJECT_LOCK (basesrc);
+    basesrc->priv->dll_count = 0;
+    GST_OBJECT_UNLOCK (basesrc);
     /* have to restart the task in case it stopped because of the unlock when
      * we went to PAUSED. Only do this if we operating in push mode. */
     GST_OBJECT_LOCK (basesrc->srcpad);
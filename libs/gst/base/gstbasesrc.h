@@ -161,6 +161,12 @@ struct _GstBaseSrc {
  *   undesirable.
  * @fixate: Called during negotiation if caps need fixating. Implement instead of
  *   setting a fixate function on the source pad.
+ * @create_list: Ask the subclass to create several buffers at once in push
+ *   mode, for live sources that capture data in batches. The buffers of the
+ *   list are pushed one by one. With do-timestamp, the last buffer is
+ *   timestamped with the current running time and the buffers before it
+ *   according to their durations. Implementations should also implement
+ *   @create when they support pull mode. Since: 0.10.31
  *
  * Subclasses can override any of the available virtual methods or not, as
  * needed. At the minimum, the @create method should be overridden to produce
@@ -233,8 +239,12 @@ struct _GstBaseSrcClass {
   gboolean      (*prepare_seek_segment) (GstBaseSrc *src, GstEvent *seek,
                                          GstSegment *segment);
 
+  /* ask the subclass to create several buffers at once */
+  GstFlowReturn (*create_list)  (GstBaseSrc *src, guint64 offset, guint size,
+                                 GstBufferList **list);
+
   /*< private >*/
-  gpointer       _gst_reserved[GST_PADDING_LARGE - 6];
+  gpointer       _gst_reserved[GST_PADDING_LARGE - 7];
 };
 
 GType gst_base_src_get_type (void);
@@ -256,6 +266,9 @@ gulong          gst_base_src_get_blocksize    (GstBaseSrc *src);
 void            gst_base_src_set_do_timestamp (GstBaseSrc *src, gboolean timestamp);
 gboolean        gst_base_src_get_do_timestamp (GstBaseSrc *src);
 
+void            gst_base_src_set_smooth_timestamps (GstBaseSrc *src, gboolean smooth);
+gboolean        gst_base_src_get_smooth_timestamps (GstBaseSrc *src);
+
 gboolean        gst_base_src_new_seamless_segment (GstBaseSrc *src, gint64 start, gint64 stop, gint64 position);
 G_END_DECLS
 
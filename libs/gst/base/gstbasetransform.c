@@ -196,6 +196,20 @@
  * </itemizedlist>
  * </para>
  * </refsect2>
+ * <refsect2>
+ * <title>Frame-parallel processing</title>
+ * <para>
+ * Sub-classes whose transform methods don't keep state between buffers can
+ * call gst_base_transform_set_max_threads() to transform several buffers
+ * concurrently in a thread pool. Output buffers are allocated and QoS is
+ * checked on the streaming thread, only the transform and transform_ip methods
+ * run in the thread pool. The results are pushed in order as soon as they are
+ * ready, by the pool thread that finished the oldest pending buffer or by the
+ * streaming thread, so downstream elements can be called from a pool thread.
+ * Serialized events and caps changes wait until the pending buffers are
+ * pushed.
+ * </para>
+ * </refsect2>
  */
 
 #ifdef HAVE_CONFIG_H
@@ -222,6 +236,12 @@ enum
 
 #define DEFAULT_PROP_QOS	FALSE
 
+/* graded QoS lowers the quality level for every QoS event that reports a
+ * late buffer, it is raised again after this many QoS events in a row that
+ * report a proportion below QUALITY_RAISE_PROPORTION */
+#define QUALITY_RAISE_EVENTS		8
+#define QUALITY_RAISE_PROPORTION	0.8
+
 enum
 {
   PROP_0,
@@ -239,10 +259,17 @@ struct _GstBaseTransformPrivate
   GstClockTime earliest_time;
   /* previous buffer had a discont */
   gboolean discont;
+  /* graded QoS, the current level and the number of QoS events in a row
+   * that allow a higher level */
+  guint quality_levels;
+  guint quality;
+  guint quality_good;
 
   GstActivateMode pad_mode;
 
   gboolean gap_aware;
+  /* buffers without caps keep the caps of the previous buffer downstream */
+  gboolean implicit_caps;
 
   /* caps used for allocating buffers */
   gboolean proxy_alloc;
@@ -258,8 +285,45 @@ struct _GstBaseTransformPrivate
   /* QoS stats */
   guint64 processed;
   guint64 dropped;
+
+  /* frame-parallel processing, jobs are queued by the streaming thread and
+   * pushed in order by the streaming thread or by the worker that finished the
+   * job at the head. The queue, job completion and the fields below are
+   * protected with jobs_lock */
+  guint max_threads;
+  GThreadPool *pool;
+  GQueue jobs;
+  GMutex *jobs_lock;
+  GCond *jobs_cond;
+  /* a thread is pushing jobs, nobody else may */
+  gboolean jobs_pushing;
+  /* the streaming thread is draining, workers don't push */
+  gboolean jobs_draining;
+  /* first error of a push not yet returned upstream */
+  GstFlowReturn jobs_ret;
+  /* duration of the last queued buffer, for the latency */
+  GstClockTime jobs_duration;
+  /* buffers pushed and position reached by the workers, added to processed
+   * and the segment by the streaming thread */
+  guint64 jobs_processed;
+  GstClockTime jobs_last_stop;
+  /* mark the next pushed output buffer discont */
+  gboolean output_discont;
 };
 
+/* an input buffer that is transformed in the thread pool */
+typedef struct
+{
+  GstBuffer *inbuf;
+  GstBuffer *outbuf;
+  GstClockTime last_stop;
+  gboolean discont;
+
+  /* with jobs_lock */
+  gboolean done;
+  GstFlowReturn ret;
+} GstBaseTransformJob;
+
 static GstElementClass *parent_class = NULL;
 
 static void gst_base_transform_class_init (GstBaseTransformClass * klass);
@@ -324,6 +388,9 @@ static gboolean gst_base_transform_acceptcaps (GstPad * pad, GstCaps * caps);
 static gboolean gst_base_transform_acceptcaps_default (GstBaseTransform * trans,
     GstPadDirection direction, GstCaps * caps);
 static gboolean gst_base_transform_setcaps (GstPad * pad, GstCaps * caps);
+static gboolean gst_base_transform_src_query (GstPad * pad, GstQuery * query);
+static GstFlowReturn gst_base_transform_finish_jobs (GstBaseTransform * trans,
+    gboolean drain, gboolean discard);
 static GstFlowReturn gst_base_transform_buffer_alloc (GstPad * pad,
     guint64 offset, guint size, GstCaps * caps, GstBuffer ** buf);
 
@@ -339,6 +406,11 @@ gst_base_transform_finalize (GObject * object)
   gst_caps_replace (&trans->priv->sink_suggest, NULL);
   g_mutex_free (trans->transform_lock);
 
+  if (trans->priv->pool)
+    g_thread_pool_free (trans->priv->pool, FALSE, TRUE);
+  g_mutex_free (trans->priv->jobs_lock);
+  g_cond_free (trans->priv->jobs_cond);
+
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
@@ -414,6 +486,8 @@ gst_base_transform_init (GstBaseTransform * trans,
       GST_DEBUG_FUNCPTR (gst_base_transform_acceptcaps));
   gst_pad_set_event_function (trans->srcpad,
       GST_DEBUG_FUNCPTR (gst_base_transform_src_event));
+  gst_pad_set_query_function (trans->srcpad,
+      GST_DEBUG_FUNCPTR (gst_base_transform_src_query));
   gst_pad_set_checkgetrange_function (trans->srcpad,
       GST_DEBUG_FUNCPTR (gst_base_transform_check_get_range));
   gst_pad_set_getrange_function (trans->srcpad,
@@ -429,6 +503,7 @@ gst_base_transform_init (GstBaseTransform * trans,
   trans->cache_caps2 = NULL;
   trans->priv->pad_mode = GST_ACTIVATE_NONE;
   trans->priv->gap_aware = FALSE;
+  trans->priv->implicit_caps = FALSE;
 
   trans->passthrough = FALSE;
   if (bclass->transform == NULL) {
@@ -444,6 +519,18 @@ gst_base_transform_init (GstBaseTransform * trans,
 
   trans->priv->processed = 0;
   trans->priv->dropped = 0;
+
+  trans->priv->quality_levels = 1;
+  trans->priv->quality = 0;
+  trans->priv->quality_good = 0;
+
+  trans->priv->max_threads = 1;
+  g_queue_init (&trans->priv->jobs);
+  trans->priv->jobs_lock = g_mutex_new ();
+  trans->priv->jobs_cond = g_cond_new ();
+  trans->priv->jobs_ret = GST_FLOW_OK;
+  trans->priv->jobs_duration = GST_CLOCK_TIME_NONE;
+  trans->priv->jobs_last_stop = GST_CLOCK_TIME_NONE;
 }
 
 /* given @caps on the src or sink pad (given by @direction)
@@ -678,12 +765,22 @@ gst_base_transform_configure_caps (GstBaseTransform * trans, GstCaps * in,
 {
   gboolean ret = TRUE;
   GstBaseTransformClass *klass;
+  GstFlowReturn flow;
 
   klass = GST_BASE_TRANSFORM_GET_CLASS (trans);
 
   GST_DEBUG_OBJECT (trans, "in caps:  %" GST_PTR_FORMAT, in);
   GST_DEBUG_OBJECT (trans, "out caps: %" GST_PTR_FORMAT, out);
 
+  /* buffers in the thread pool are transformed and pushed with the old
+   * configuration. A failed push is returned for the next buffer. */
+  flow = gst_base_transform_finish_jobs (trans, TRUE, FALSE);
+  if (G_UNLIKELY (flow != GST_FLOW_OK)) {
+    g_mutex_lock (trans->priv->jobs_lock);
+    trans->priv->jobs_ret = flow;
+    g_mutex_unlock (trans->priv->jobs_lock);
+  }
+
   /* clear the cache */
   gst_caps_replace (&trans->cache_caps1, NULL);
   gst_caps_replace (&trans->cache_caps2, NULL);
@@ -1183,6 +1280,22 @@ failed_configure:
   }
 }
 
+/* checks if the peer of our srcpad is configured with @caps. The caps of the
+ * peer only change when we push buffers so a pointer compare is enough. */
+static gboolean
+gst_base_transform_peer_has_caps (GstBaseTransform * trans, GstCaps * caps)
+{
+  GstPad *peer;
+  gboolean res;
+
+  GST_OBJECT_LOCK (trans->srcpad);
+  peer = GST_PAD_PEER (trans->srcpad);
+  res = caps != NULL && peer != NULL && GST_PAD_CAPS (peer) == caps;
+  GST_OBJECT_UNLOCK (trans->srcpad);
+
+  return res;
+}
+
 /* Allocate a buffer using gst_pad_alloc_buffer
  *
  * This function can do renegotiation on the source pad
@@ -1432,6 +1545,13 @@ gst_base_transform_prepare_output_buffer (GstBaseTransform * trans,
    * the ones on the srcpad and set the srcpad caps to the buffer caps */
   setcaps = !newcaps || ((newcaps != outcaps)
       && (!gst_caps_is_equal (newcaps, outcaps)));
+  /* a buffer without caps is fine when the peer is already configured with
+   * the output caps and the subclass allows implicit caps */
+  if (setcaps && !newcaps && trans->priv->implicit_caps
+      && gst_base_transform_peer_has_caps (trans, outcaps)) {
+    GST_LOG_OBJECT (trans, "peer has caps, leaving buffer caps unset");
+    setcaps = FALSE;
+  }
   /* we need to modify the metadata when the element is not gap aware,
    * passthrough is not used and the gap flag is set */
   copymeta |= !trans->priv->gap_aware && !trans->passthrough
@@ -1777,6 +1897,12 @@ gst_base_transform_sink_event (GstPad * pad, GstEvent * event)
   trans = GST_BASE_TRANSFORM (gst_pad_get_parent (pad));
   bclass = GST_BASE_TRANSFORM_GET_CLASS (trans);
 
+  /* serialized events go after the buffers still in the thread pool, after a
+   * flush those buffers are dropped */
+  if (GST_EVENT_IS_SERIALIZED (event))
+    gst_base_transform_finish_jobs (trans, TRUE,
+        GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP);
+
   if (bclass->event)
     forward = bclass->event (trans, event);
 
@@ -1804,8 +1930,11 @@ gst_base_transform_sink_eventfunc (GstBaseTransform * trans, GstEvent * event)
       trans->priv->proportion = 1.0;
       trans->priv->earliest_time = -1;
       trans->priv->discont = FALSE;
+      trans->priv->output_discont = FALSE;
       trans->priv->processed = 0;
       trans->priv->dropped = 0;
+      trans->priv->quality = trans->priv->quality_levels - 1;
+      trans->priv->quality_good = 0;
       GST_OBJECT_UNLOCK (trans);
       /* we need new segment info after the flush. */
       trans->have_newsegment = FALSE;
@@ -1872,6 +2001,60 @@ gst_base_transform_src_event (GstPad * pad, GstEvent * event)
   return ret;
 }
 
+static gboolean
+gst_base_transform_src_query (GstPad * pad, GstQuery * query)
+{
+  GstBaseTransform *trans;
+  GstBaseTransformPrivate *priv;
+  gboolean ret;
+
+  trans = GST_BASE_TRANSFORM (gst_pad_get_parent (pad));
+  if (G_UNLIKELY (trans == NULL))
+    return FALSE;
+
+  priv = trans->priv;
+
+  switch (GST_QUERY_TYPE (query)) {
+    case GST_QUERY_LATENCY:
+    {
+      GstClockTime min, max, extra = 0;
+      gboolean live;
+
+      ret = gst_pad_peer_query (trans->sinkpad, query);
+      if (!ret)
+        break;
+
+      /* with the thread pool, a buffer waits for up to max_threads - 1
+       * buffers before it that are still being transformed */
+      g_mutex_lock (priv->jobs_lock);
+      if (priv->max_threads > 1 && !trans->passthrough &&
+          GST_CLOCK_TIME_IS_VALID (priv->jobs_duration))
+        extra = (priv->max_threads - 1) * priv->jobs_duration;
+      g_mutex_unlock (priv->jobs_lock);
+
+      if (extra > 0) {
+        gst_query_parse_latency (query, &live, &min, &max);
+
+        GST_DEBUG_OBJECT (trans, "adding %" GST_TIME_FORMAT " of latency for "
+            "%u threads", GST_TIME_ARGS (extra), priv->max_threads);
+
+        min += extra;
+        if (GST_CLOCK_TIME_IS_VALID (max))
+          max += extra;
+        gst_query_set_latency (query, live, min, max);
+      }
+      break;
+    }
+    default:
+      ret = gst_pad_query_default (pad, query);
+      break;
+  }
+
+  gst_object_unref (trans);
+
+  return ret;
+}
+
 static gboolean
 gst_base_transform_src_eventfunc (GstBaseTransform * trans, GstEvent * event)
 {
@@ -1901,18 +2084,69 @@ gst_base_transform_src_eventfunc (GstBaseTransform * trans, GstEvent * event)
   return ret;
 }
 
+/* perform the configured transform of @inbuf into @outbuf, this is called
+ * from the thread pool for frame-parallel processing */
+static GstFlowReturn
+gst_base_transform_transform_buffer (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer * outbuf)
+{
+  GstBaseTransformClass *bclass;
+  GstFlowReturn ret = GST_FLOW_OK;
+  gboolean want_in_place;
+
+  bclass = GST_BASE_TRANSFORM_GET_CLASS (trans);
+
+  /* now perform the needed transform */
+  if (trans->passthrough) {
+    /* In passthrough mode, give transform_ip a look at the
+     * buffer, without making it writable, or just push the
+     * data through */
+    if (bclass->transform_ip) {
+      GST_DEBUG_OBJECT (trans, "doing passthrough transform");
+      ret = bclass->transform_ip (trans, outbuf);
+    } else {
+      GST_DEBUG_OBJECT (trans, "element is in passthrough");
+    }
+  } else {
+    want_in_place = (bclass->transform_ip != NULL) && trans->always_in_place;
+
+    if (want_in_place) {
+      GST_DEBUG_OBJECT (trans, "doing inplace transform");
+
+      if (inbuf != outbuf) {
+        /* different buffers, copy the input to the output first, we then do an
+         * in-place transform on the output buffer. */
+        memcpy (GST_BUFFER_DATA (outbuf), GST_BUFFER_DATA (inbuf),
+            GST_BUFFER_SIZE (inbuf));
+      }
+      ret = bclass->transform_ip (trans, outbuf);
+    } else {
+      GST_DEBUG_OBJECT (trans, "doing non-inplace transform");
+
+      if (bclass->transform)
+        ret = bclass->transform (trans, inbuf, outbuf);
+      else
+        ret = GST_FLOW_NOT_SUPPORTED;
+    }
+  }
+
+  return ret;
+}
+
 /* perform a transform on @inbuf and put the result in @outbuf.
  *
  * This function is common to the push and pull-based operations.
  *
- * This function takes ownership of @inbuf */
+ * This function takes ownership of @inbuf. When @transform is FALSE, only the
+ * output buffer is prepared and, when it is not NULL, the caller keeps the
+ * ownership of @inbuf and has to transform it. */
 static GstFlowReturn
 gst_base_transform_handle_buffer (GstBaseTransform * trans, GstBuffer * inbuf,
-    GstBuffer ** outbuf)
+    GstBuffer ** outbuf, gboolean transform)
 {
   GstBaseTransformClass *bclass;
   GstFlowReturn ret = GST_FLOW_OK;
-  gboolean want_in_place, reconfigure;
+  gboolean reconfigure;
   GstClockTime running_time;
   GstClockTime timestamp;
   GstCaps *incaps;
@@ -1976,9 +2210,11 @@ gst_base_transform_handle_buffer (GstBaseTransform * trans, GstBuffer * inbuf,
     earliest_time = trans->priv->earliest_time;
     proportion = trans->priv->proportion;
     /* check for QoS, don't perform conversion for buffers
-     * that are known to be late. */
+     * that are known to be late. With graded QoS, buffers are only dropped
+     * once the lowest quality level is reached. */
     need_skip = trans->priv->qos_enabled &&
-        earliest_time != -1 && running_time <= earliest_time;
+        earliest_time != -1 && running_time <= earliest_time &&
+        trans->priv->quality == 0;
     GST_OBJECT_UNLOCK (trans);
 
     if (need_skip) {
@@ -2024,39 +2260,11 @@ no_qos:
   if (G_UNLIKELY (ret != GST_FLOW_OK))
     goto no_buffer;
 
-  /* now perform the needed transform */
-  if (trans->passthrough) {
-    /* In passthrough mode, give transform_ip a look at the
-     * buffer, without making it writable, or just push the
-     * data through */
-    if (bclass->transform_ip) {
-      GST_DEBUG_OBJECT (trans, "doing passthrough transform");
-      ret = bclass->transform_ip (trans, *outbuf);
-    } else {
-      GST_DEBUG_OBJECT (trans, "element is in passthrough");
-    }
-  } else {
-    want_in_place = (bclass->transform_ip != NULL) && trans->always_in_place;
-
-    if (want_in_place) {
-      GST_DEBUG_OBJECT (trans, "doing inplace transform");
-
-      if (inbuf != *outbuf) {
-        /* different buffers, copy the input to the output first, we then do an
-         * in-place transform on the output buffer. */
-        memcpy (GST_BUFFER_DATA (*outbuf), GST_BUFFER_DATA (inbuf),
-            GST_BUFFER_SIZE (inbuf));
-      }
-      ret = bclass->transform_ip (trans, *outbuf);
-    } else {
-      GST_DEBUG_OBJECT (trans, "doing non-inplace transform");
+  /* the caller transforms the buffer in the thread pool */
+  if (!transform)
+    return GST_FLOW_OK;
 
-      if (bclass->transform)
-        ret = bclass->transform (trans, inbuf, *outbuf);
-      else
-        ret = GST_FLOW_NOT_SUPPORTED;
-    }
-  }
+  ret = gst_base_transform_transform_buffer (trans, inbuf, *outbuf);
 
 skip:
   /* only unref input buffer if we allocated a new outbuf buffer */
@@ -2120,7 +2328,7 @@ gst_base_transform_getrange (GstPad * pad, guint64 offset,
     klass->before_transform (trans, inbuf);
 
   GST_BASE_TRANSFORM_LOCK (trans);
-  ret = gst_base_transform_handle_buffer (trans, inbuf, buffer);
+  ret = gst_base_transform_handle_buffer (trans, inbuf, buffer, TRUE);
   GST_BASE_TRANSFORM_UNLOCK (trans);
 
 done:
@@ -2137,6 +2345,223 @@ pull_error:
   }
 }
 
+/* account for @processed pushed buffers that reached @last_stop, only on the
+ * streaming thread */
+static void
+gst_base_transform_update_position (GstBaseTransform * trans,
+    GstClockTime last_stop, guint64 processed)
+{
+  /* Remember last stop position */
+  if ((last_stop != GST_CLOCK_TIME_NONE) &&
+      (trans->segment.format == GST_FORMAT_TIME))
+    gst_segment_set_last_stop (&trans->segment, GST_FORMAT_TIME, last_stop);
+
+  trans->priv->processed += processed;
+}
+
+/* push @outbuf, the result of a transform that returned @ret, downstream.
+ * @discont is the flag that marks the next pushed buffer discont. */
+static GstFlowReturn
+gst_base_transform_push_output (GstBaseTransform * trans, GstBuffer * outbuf,
+    GstFlowReturn ret, gboolean * discont)
+{
+  /* outbuf can be NULL, this means a dropped buffer, if we have a buffer but
+   * GST_BASE_TRANSFORM_FLOW_DROPPED we will not push either. */
+  if (outbuf != NULL) {
+    if ((ret == GST_FLOW_OK)) {
+      /* apply DISCONT flag if the buffer is not yet marked as such */
+      if (*discont) {
+        if (!GST_BUFFER_IS_DISCONT (outbuf)) {
+          outbuf = gst_buffer_make_metadata_writable (outbuf);
+          GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+        }
+        *discont = FALSE;
+      }
+      ret = gst_pad_push (trans->srcpad, outbuf);
+    } else {
+      gst_buffer_unref (outbuf);
+    }
+  }
+
+  /* convert internal flow to OK and mark discont for the next buffer. */
+  if (ret == GST_BASE_TRANSFORM_FLOW_DROPPED) {
+    *discont = TRUE;
+    ret = GST_FLOW_OK;
+  }
+
+  return ret;
+}
+
+static void gst_base_transform_output_jobs (GstBaseTransform * trans,
+    gboolean discard);
+
+/* called from the thread pool */
+static void
+gst_base_transform_job_func (GstBaseTransformJob * job,
+    GstBaseTransform * trans)
+{
+  GstBaseTransformPrivate *priv = trans->priv;
+  GstBaseTransformJob *head;
+  GstFlowReturn ret;
+
+  ret = gst_base_transform_transform_buffer (trans, job->inbuf, job->outbuf);
+
+  if (job->outbuf != job->inbuf)
+    gst_buffer_unref (job->inbuf);
+  job->inbuf = NULL;
+
+  g_mutex_lock (priv->jobs_lock);
+  job->ret = ret;
+  job->done = TRUE;
+  g_cond_broadcast (priv->jobs_cond);
+
+  /* push what is ready right away instead of waiting for the next input
+   * buffer, unless somebody else is already pushing */
+  head = g_queue_peek_head (&priv->jobs);
+  if (head && head->done && !priv->jobs_pushing && !priv->jobs_draining)
+    gst_base_transform_output_jobs (trans, FALSE);
+  g_mutex_unlock (priv->jobs_lock);
+}
+
+/* with jobs_lock, push the transformed jobs at the head of the queue in
+ * order until the head is not transformed yet. With @discard, or after a push
+ * failed, the buffers are dropped instead of pushed. */
+static void
+gst_base_transform_output_jobs (GstBaseTransform * trans, gboolean discard)
+{
+  GstBaseTransformPrivate *priv = trans->priv;
+  GstBaseTransformJob *job;
+  GstFlowReturn ret;
+
+  priv->jobs_pushing = TRUE;
+  while ((job = g_queue_peek_head (&priv->jobs)) && job->done) {
+    g_queue_pop_head (&priv->jobs);
+
+    if (discard || priv->jobs_ret != GST_FLOW_OK) {
+      g_mutex_unlock (priv->jobs_lock);
+      if (job->outbuf)
+        gst_buffer_unref (job->outbuf);
+      g_mutex_lock (priv->jobs_lock);
+    } else {
+      /* the streaming thread updates the position and QoS stats */
+      if (job->ret == GST_FLOW_OK) {
+        priv->jobs_processed++;
+        if (job->last_stop != GST_CLOCK_TIME_NONE)
+          priv->jobs_last_stop = job->last_stop;
+      }
+      g_mutex_unlock (priv->jobs_lock);
+      if (job->discont)
+        priv->output_discont = TRUE;
+      ret = gst_base_transform_push_output (trans, job->outbuf, job->ret,
+          &priv->output_discont);
+      g_mutex_lock (priv->jobs_lock);
+      if (ret != GST_FLOW_OK && priv->jobs_ret == GST_FLOW_OK)
+        priv->jobs_ret = ret;
+    }
+    g_slice_free (GstBaseTransformJob, job);
+  }
+  priv->jobs_pushing = FALSE;
+  g_cond_broadcast (priv->jobs_cond);
+}
+
+/* called from the streaming thread, push the transformed jobs in order. When
+ * @drain is FALSE, this only waits until less than max_threads jobs are
+ * pending, otherwise the queue is emptied. With @discard, the buffers are
+ * dropped instead of pushed. Returns the result of the pushes, also of those
+ * done by the workers since the last call. */
+static GstFlowReturn
+gst_base_transform_finish_jobs (GstBaseTransform * trans, gboolean drain,
+    gboolean discard)
+{
+  GstBaseTransformPrivate *priv = trans->priv;
+  GstBaseTransformJob *job;
+  GstFlowReturn ret;
+
+  /* never went parallel */
+  if (G_LIKELY (priv->pool == NULL))
+    return GST_FLOW_OK;
+
+  g_mutex_lock (priv->jobs_lock);
+  /* workers push nothing anymore, but one could still be pushing */
+  priv->jobs_draining = drain;
+  while (TRUE) {
+    while (priv->jobs_pushing)
+      g_cond_wait (priv->jobs_cond, priv->jobs_lock);
+
+    if (!(job = g_queue_peek_head (&priv->jobs)))
+      break;
+
+    if (!job->done) {
+      if (!drain && g_queue_get_length (&priv->jobs) < priv->max_threads)
+        break;
+      g_cond_wait (priv->jobs_cond, priv->jobs_lock);
+      continue;
+    }
+    gst_base_transform_output_jobs (trans, discard);
+  }
+  priv->jobs_draining = FALSE;
+
+  if (!discard)
+    gst_base_transform_update_position (trans, priv->jobs_last_stop,
+        priv->jobs_processed);
+  priv->jobs_processed = 0;
+  priv->jobs_last_stop = GST_CLOCK_TIME_NONE;
+
+  /* the error is returned once, after a flush there is nothing to report */
+  ret = discard ? GST_FLOW_OK : priv->jobs_ret;
+  priv->jobs_ret = GST_FLOW_OK;
+  g_mutex_unlock (priv->jobs_lock);
+
+  return ret;
+}
+
+/* prepare the output buffer for @buffer on the streaming thread and transform
+ * it in the thread pool, then push the transformed buffers in order */
+static GstFlowReturn
+gst_base_transform_chain_parallel (GstBaseTransform * trans,
+    GstBuffer * buffer, GstClockTime last_stop)
+{
+  GstBaseTransformPrivate *priv = trans->priv;
+  GstBaseTransformJob *job;
+  GstFlowReturn ret;
+  GstBuffer *outbuf = NULL;
+
+  GST_BASE_TRANSFORM_LOCK (trans);
+  ret = gst_base_transform_handle_buffer (trans, buffer, &outbuf, FALSE);
+  GST_BASE_TRANSFORM_UNLOCK (trans);
+
+  if (G_UNLIKELY (ret != GST_FLOW_OK || outbuf == NULL)) {
+    /* not transformed, skipped by QoS or failed. A skipped buffer marks the
+     * next submitted buffer discont. */
+    if (outbuf)
+      gst_buffer_unref (outbuf);
+    if (ret == GST_BASE_TRANSFORM_FLOW_DROPPED) {
+      priv->discont = TRUE;
+      ret = GST_FLOW_OK;
+    }
+    if (ret != GST_FLOW_OK)
+      return ret;
+  } else {
+    job = g_slice_new0 (GstBaseTransformJob);
+    job->inbuf = buffer;
+    job->outbuf = outbuf;
+    job->last_stop = last_stop;
+    /* the discont flag belongs to this buffer, not the next pushed one */
+    job->discont = priv->discont;
+    priv->discont = FALSE;
+
+    GST_LOG_OBJECT (trans, "transforming buffer %p in the thread pool", buffer);
+
+    g_mutex_lock (priv->jobs_lock);
+    g_queue_push_tail (&priv->jobs, job);
+    priv->jobs_duration = GST_BUFFER_DURATION (buffer);
+    g_mutex_unlock (priv->jobs_lock);
+    g_thread_pool_push (priv->pool, job, NULL);
+  }
+
+  return gst_base_transform_finish_jobs (trans, FALSE, FALSE);
+}
+
 static GstFlowReturn
 gst_base_transform_chain (GstPad * pad, GstBuffer * buffer)
 {
@@ -2164,42 +2589,27 @@ gst_base_transform_chain (GstPad * pad, GstBuffer * buffer)
   if (klass->before_transform)
     klass->before_transform (trans, buffer);
 
+  if (trans->priv->max_threads > 1 && !trans->passthrough)
+    return gst_base_transform_chain_parallel (trans, buffer, last_stop);
+
+  /* push what is left from the thread pool first, the element can switch to
+   * passthrough at any time */
+  ret = gst_base_transform_finish_jobs (trans, TRUE, FALSE);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    gst_buffer_unref (buffer);
+    return ret;
+  }
+
   /* protect transform method and concurrent buffer alloc */
   GST_BASE_TRANSFORM_LOCK (trans);
-  ret = gst_base_transform_handle_buffer (trans, buffer, &outbuf);
+  ret = gst_base_transform_handle_buffer (trans, buffer, &outbuf, TRUE);
   GST_BASE_TRANSFORM_UNLOCK (trans);
 
-  /* outbuf can be NULL, this means a dropped buffer, if we have a buffer but
-   * GST_BASE_TRANSFORM_FLOW_DROPPED we will not push either. */
-  if (outbuf != NULL) {
-    if ((ret == GST_FLOW_OK)) {
-      /* Remember last stop position */
-      if ((last_stop != GST_CLOCK_TIME_NONE) &&
-          (trans->segment.format == GST_FORMAT_TIME))
-        gst_segment_set_last_stop (&trans->segment, GST_FORMAT_TIME, last_stop);
-
-      /* apply DISCONT flag if the buffer is not yet marked as such */
-      if (trans->priv->discont) {
-        if (!GST_BUFFER_IS_DISCONT (outbuf)) {
-          outbuf = gst_buffer_make_metadata_writable (outbuf);
-          GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
-        }
-        trans->priv->discont = FALSE;
-      }
-      trans->priv->processed++;
-      ret = gst_pad_push (trans->srcpad, outbuf);
-    } else {
-      gst_buffer_unref (outbuf);
-    }
-  }
-
-  /* convert internal flow to OK and mark discont for the next buffer. */
-  if (ret == GST_BASE_TRANSFORM_FLOW_DROPPED) {
-    trans->priv->discont = TRUE;
-    ret = GST_FLOW_OK;
-  }
+  if (outbuf != NULL && ret == GST_FLOW_OK)
+    gst_base_transform_update_position (trans, last_stop, 1);
 
-  return ret;
+  return gst_base_transform_push_output (trans, outbuf, ret,
+      &trans->priv->discont);
 }
 
 static void
@@ -2266,15 +2676,19 @@ gst_base_transform_activate (GstBaseTransform * trans, gboolean active)
     trans->priv->proportion = 1.0;
     trans->priv->earliest_time = -1;
     trans->priv->discont = FALSE;
+    trans->priv->output_discont = FALSE;
     gst_caps_replace (&trans->priv->sink_suggest, NULL);
     trans->priv->processed = 0;
     trans->priv->dropped = 0;
+    trans->priv->quality = trans->priv->quality_levels - 1;
+    trans->priv->quality_good = 0;
 
     GST_OBJECT_UNLOCK (trans);
   } else {
     /* We must make sure streaming has finished before resetting things
      * and calling the ::stop vfunc */
     GST_PAD_STREAM_LOCK (trans->sinkpad);
+    gst_base_transform_finish_jobs (trans, TRUE, TRUE);
     GST_PAD_STREAM_UNLOCK (trans->sinkpad);
 
     trans->have_same_caps = FALSE;
@@ -2458,6 +2872,40 @@ gst_base_transform_is_in_place (GstBaseTransform * trans)
   return result;
 }
 
+/* with LOCK */
+static void
+gst_base_transform_update_quality (GstBaseTransform * trans,
+    gdouble proportion, GstClockTimeDiff diff)
+{
+  GstBaseTransformPrivate *priv = trans->priv;
+  guint quality = priv->quality;
+
+  if (!priv->qos_enabled || priv->quality_levels < 2)
+    return;
+
+  if (diff > 0) {
+    /* late, lower the quality right away */
+    priv->quality_good = 0;
+    if (quality > 0)
+      quality--;
+  } else if (proportion < QUALITY_RAISE_PROPORTION) {
+    /* enough headroom, raise the quality slowly */
+    if (++priv->quality_good >= QUALITY_RAISE_EVENTS) {
+      priv->quality_good = 0;
+      if (quality < priv->quality_levels - 1)
+        quality++;
+    }
+  } else {
+    priv->quality_good = 0;
+  }
+
+  if (quality != priv->quality) {
+    GST_CAT_DEBUG_OBJECT (GST_CAT_QOS, trans, "quality level %u -> %u",
+        priv->quality, quality);
+    priv->quality = quality;
+  }
+}
+
 /**
  * gst_base_transform_update_qos:
  * @trans: a #GstBaseTransform
@@ -2488,6 +2936,7 @@ gst_base_transform_update_qos (GstBaseTransform * trans,
   GST_OBJECT_LOCK (trans);
   trans->priv->proportion = proportion;
   trans->priv->earliest_time = timestamp + diff;
+  gst_base_transform_update_quality (trans, proportion, diff);
   GST_OBJECT_UNLOCK (trans);
 }
 
@@ -2540,6 +2989,69 @@ gst_base_transform_is_qos_enabled (GstBaseTransform * trans)
   return result;
 }
 
+/**
+ * gst_base_transform_set_quality_levels:
+ * @trans: a #GstBaseTransform
+ * @levels: the number of quality levels the subclass supports
+ *
+ * Enables graded QoS for subclasses that can trade processing quality for
+ * speed, for example by skipping refinement passes or by using fewer filter
+ * taps. Level @levels - 1 is the full quality, level 0 the cheapest one.
+ *
+ * When QoS is enabled, the level is lowered for every QoS event that reports
+ * a late buffer and raised again slowly when downstream has enough headroom.
+ * Late buffers are only dropped once level 0 is reached. Subclasses
+ * retrieve the level to use for a buffer with gst_base_transform_get_quality()
+ * in their transform methods.
+ *
+ * The default is 1 level, late buffers are dropped right away.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+void
+gst_base_transform_set_quality_levels (GstBaseTransform * trans, guint levels)
+{
+  g_return_if_fail (GST_IS_BASE_TRANSFORM (trans));
+  g_return_if_fail (levels > 0);
+
+  GST_OBJECT_LOCK (trans);
+  trans->priv->quality_levels = levels;
+  trans->priv->quality = levels - 1;
+  trans->priv->quality_good = 0;
+  GST_CAT_DEBUG_OBJECT (GST_CAT_QOS, trans, "quality levels %u", levels);
+  GST_OBJECT_UNLOCK (trans);
+}
+
+/**
+ * gst_base_transform_get_quality:
+ * @trans: a #GstBaseTransform
+ *
+ * Get the quality level the subclass should process the next buffer with,
+ * see gst_base_transform_set_quality_levels().
+ *
+ * Returns: the current quality level, between 0 and the number of levels
+ * minus one.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+guint
+gst_base_transform_get_quality (GstBaseTransform * trans)
+{
+  guint result;
+
+  g_return_val_if_fail (GST_IS_BASE_TRANSFORM (trans), 0);
+
+  GST_OBJECT_LOCK (trans);
+  result = trans->priv->quality;
+  GST_OBJECT_UNLOCK (trans);
+
+  return result;
+}
+
 /**
  * gst_base_transform_set_gap_aware:
  * @trans: a #GstBaseTransform
@@ -2567,6 +3079,112 @@ gst_base_transform_set_gap_aware (GstBaseTransform * trans, gboolean gap_aware)
   GST_OBJECT_UNLOCK (trans);
 }
 
+/**
+ * gst_base_transform_set_implicit_caps:
+ * @trans: a #GstBaseTransform
+ * @implicit_caps: New state
+ *
+ * If @implicit_caps is %FALSE (the default), the caps of the source pad are
+ * set on every output buffer that has no caps, which requires making the
+ * buffer metadata writable and can cause a copy of the buffer structure when
+ * the buffer is shared.
+ *
+ * If set to %TRUE, output buffers without caps are pushed as they are once
+ * the peer of the source pad has been configured with the caps of the
+ * source pad, as a buffer without caps keeps the caps of the previous buffer
+ * downstream. Downstream elements and applications then only see the caps
+ * on the buffers pushed before the peer was configured.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+void
+gst_base_transform_set_implicit_caps (GstBaseTransform * trans,
+    gboolean implicit_caps)
+{
+  g_return_if_fail (GST_IS_BASE_TRANSFORM (trans));
+
+  GST_OBJECT_LOCK (trans);
+  trans->priv->implicit_caps = implicit_caps;
+  GST_DEBUG_OBJECT (trans, "set implicit caps %d", trans->priv->implicit_caps);
+  GST_OBJECT_UNLOCK (trans);
+}
+
+/**
+ * gst_base_transform_set_max_threads:
+ * @trans: a #GstBaseTransform
+ * @max_threads: the maximum number of buffers transformed at the same time
+ *
+ * Sets the number of buffers that @trans transforms concurrently. With a
+ * value bigger than 1, the output buffers are still prepared on the streaming
+ * thread, but the transform and transform_ip methods are called from a thread
+ * pool for up to @max_threads buffers at the same time. The transformed
+ * buffers are pushed in order as soon as they are ready, from the streaming
+ * thread or from the thread pool. Serialized events wait until all pending
+ * buffers were pushed. The latency reported by @trans grows by the duration
+ * of @max_threads - 1 buffers.
+ *
+ * This is only used in push mode and when not in passthrough. Subclasses
+ * should only enable this when their transform methods don't keep state
+ * between buffers and can run concurrently. The transform methods are called
+ * without the transform lock in this mode.
+ *
+ * The default is 1, buffers are transformed on the streaming thread.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+void
+gst_base_transform_set_max_threads (GstBaseTransform * trans,
+    guint max_threads)
+{
+  GstBaseTransformPrivate *priv;
+
+  g_return_if_fail (GST_IS_BASE_TRANSFORM (trans));
+  g_return_if_fail (max_threads > 0);
+
+  priv = trans->priv;
+
+  /* push out what is pending with the previous setting */
+  GST_PAD_STREAM_LOCK (trans->sinkpad);
+  gst_base_transform_finish_jobs (trans, TRUE, FALSE);
+
+  if (max_threads > 1) {
+    if (priv->pool == NULL)
+      priv->pool = g_thread_pool_new ((GFunc) gst_base_transform_job_func,
+          trans, max_threads, FALSE, NULL);
+    else
+      g_thread_pool_set_max_threads (priv->pool, max_threads, NULL);
+  }
+  priv->max_threads = priv->pool ? max_threads : 1;
+
+  GST_DEBUG_OBJECT (trans, "set max threads %u", priv->max_threads);
+  GST_PAD_STREAM_UNLOCK (trans->sinkpad);
+}
+
+/**
+ * gst_base_transform_get_max_threads:
+ * @trans: a #GstBaseTransform
+ *
+ * Get the number of buffers that @trans transforms concurrently, see
+ * gst_base_transform_set_max_threads().
+ *
+ * Returns: the maximum number of buffers transformed at the same time.
+ *
+ * MT safe.
+ *
+ * Since: 0.10.31
+ */
+guint
+gst_base_transform_get_max_threads (GstBaseTransform * trans)
+{
+  g_return_val_if_fail (GST_IS_BASE_TRANSFORM (trans), 1);
+
+  return trans->priv->max_threads;
+}
+
 /**
  * gst_base_transform_suggest:
  * @trans: a #GstBaseTransform
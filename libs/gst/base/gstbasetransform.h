@@ -266,8 +266,18 @@ void		gst_base_transform_set_qos_enabled  (GstBaseTransform *trans,
 		                                     gboolean enabled);
 gboolean	gst_base_transform_is_qos_enabled   (GstBaseTransform *trans);
 
+void            gst_base_transform_set_quality_levels (GstBaseTransform *trans,
+                                                     guint levels);
+guint           gst_base_transform_get_quality      (GstBaseTransform *trans);
+
 void            gst_base_transform_set_gap_aware    (GstBaseTransform *trans,
                                                      gboolean gap_aware);
+void            gst_base_transform_set_implicit_caps (GstBaseTransform *trans,
+                                                     gboolean implicit_caps);
+
+void            gst_base_transform_set_max_threads  (GstBaseTransform *trans,
+                                                     guint max_threads);
+guint           gst_base_transform_get_max_threads  (GstBaseTransform *trans);
 
 void		gst_base_transform_suggest          (GstBaseTransform *trans,
 	                                             GstCaps *caps, guint size);
@@ -24,6 +24,11 @@
  *
  * The element does not modify data as such, but can enforce limitations on the
  * data format.
+ *
+ * Buffers without caps get the negotiated caps attached. Applications that do
+ * not need the caps on every buffer can set #GstCapsFilter:implicit-caps,
+ * buffers are then passed on untouched once downstream has been configured
+ * with the caps.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -36,9 +41,12 @@
 enum
 {
   PROP_0,
-  PROP_FILTER_CAPS
+  PROP_FILTER_CAPS,
+  PROP_IMPLICIT_CAPS
 };
 
+#define DEFAULT_IMPLICIT_CAPS FALSE
+
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -110,6 +118,20 @@ gst_capsfilter_class_init (GstCapsFilterClass * klass)
               "Setting this property takes a reference to the supplied GstCaps "
               "object."), GST_TYPE_CAPS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstCapsFilter:implicit-caps
+   *
+   * Pass buffers without caps on untouched once downstream has been
+   * configured with the caps, instead of attaching the caps to every buffer.
+   * Only enable this when nothing downstream reads the caps of every buffer.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_IMPLICIT_CAPS,
+      g_param_spec_boolean ("implicit-caps", "Implicit caps",
+          "Don't attach the caps to buffers without caps once downstream has "
+          "them", DEFAULT_IMPLICIT_CAPS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   trans_class = GST_BASE_TRANSFORM_CLASS (klass);
   trans_class->transform_caps =
@@ -125,7 +147,9 @@ gst_capsfilter_init (GstCapsFilter * filter, GstCapsFilterClass * g_class)
 {
   GstBaseTransform *trans = GST_BASE_TRANSFORM (filter);
   gst_base_transform_set_gap_aware (trans, TRUE);
+  gst_base_transform_set_implicit_caps (trans, DEFAULT_IMPLICIT_CAPS);
   filter->filter_caps = gst_caps_new_any ();
+  filter->implicit_caps = DEFAULT_IMPLICIT_CAPS;
 }
 
 static gboolean
@@ -211,6 +235,13 @@ gst_capsfilter_set_property (GObject * object, guint prop_id,
 
       break;
     }
+    case PROP_IMPLICIT_CAPS:
+      GST_OBJECT_LOCK (capsfilter);
+      capsfilter->implicit_caps = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (capsfilter);
+      gst_base_transform_set_implicit_caps (GST_BASE_TRANSFORM (object),
+          g_value_get_boolean (value));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -229,6 +260,11 @@ gst_capsfilter_get_property (GObject * object, guint prop_id, GValue * value,
       gst_value_set_caps (value, capsfilter->filter_caps);
       GST_OBJECT_UNLOCK (capsfilter);
       break;
+    case PROP_IMPLICIT_CAPS:
+      GST_OBJECT_LOCK (capsfilter);
+      g_value_set_boolean (value, capsfilter->implicit_caps);
+      GST_OBJECT_UNLOCK (capsfilter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -346,15 +382,17 @@ gst_capsfilter_prepare_buf (GstBaseTransform * trans, GstBuffer * input,
     /* Buffer has no caps. See if the output pad only supports fixed caps */
     GstCaps *out_caps;
 
-    out_caps = GST_PAD_CAPS (trans->srcpad);
-
-    if (out_caps != NULL) {
-      gst_caps_ref (out_caps);
-    } else {
-      out_caps = gst_pad_get_allowed_caps (trans->srcpad);
-      g_return_val_if_fail (out_caps != NULL, GST_FLOW_ERROR);
+    if (GST_PAD_CAPS (trans->srcpad) != NULL) {
+      /* already negotiated, basetransform gives the buffer the pad caps
+       * unless implicit caps are enabled and downstream has them */
+      GST_LOG_OBJECT (trans, "Have output caps, using input buffer");
+      *buf = gst_buffer_ref (input);
+      return GST_FLOW_OK;
     }
 
+    out_caps = gst_pad_get_allowed_caps (trans->srcpad);
+    g_return_val_if_fail (out_caps != NULL, GST_FLOW_ERROR);
+
     out_caps = gst_caps_make_writable (out_caps);
     gst_caps_do_simplify (out_caps);
 
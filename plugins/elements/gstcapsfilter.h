@@ -53,6 +53,7 @@ struct _GstCapsFilter {
   GstBaseTransform trans;
 
   GstCaps *filter_caps;
+  gboolean implicit_caps;
 };
 
 struct _GstCapsFilterClass {
@@ -24,12 +24,32 @@
  * @see_also: #GstFakeSrc
  *
  * Dummy sink that swallows everything.
+ *
+ * With #GstFakeSink:collect-stats enabled, fakesink measures the buffers it
+ * renders without emitting any signals: the buffer and byte rate, the
+ * distribution of the time between buffer arrivals and its jitter, the
+ * latency between the running time of a buffer and the moment it is rendered
+ * and its lateness compared to the moment it should have been rendered. The
+ * distributions are kept in log-linear histograms that resolve values to
+ * within 6.25%. The results are available as a #GstStructure in the
+ * #GstFakeSink:stats property and are posted as an element message named
+ * <classname>&quot;GstFakeSinkStats&quot;</classname> with the same structure
+ * when EOS is reached.
+ *
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch -m fakesrc data=ring num-buffers=100000 ! fakesink collect-stats=true
+ * ]| Print the statistics message posted on EOS.
+ * </refsect2>
  */
 
 #ifdef HAVE_CONFIG_H
 #  include "config.h"
 #endif
 
+#include <string.h>
+
 #include "gstfakesink.h"
 #include <gst/gstmarshal.h>
 
@@ -60,6 +80,7 @@ enum
 #define DEFAULT_CAN_ACTIVATE_PUSH TRUE
 #define DEFAULT_CAN_ACTIVATE_PULL FALSE
 #define DEFAULT_NUM_BUFFERS -1
+#define DEFAULT_COLLECT_STATS FALSE
 
 enum
 {
@@ -71,7 +92,39 @@ enum
   PROP_LAST_MESSAGE,
   PROP_CAN_ACTIVATE_PUSH,
   PROP_CAN_ACTIVATE_PULL,
-  PROP_NUM_BUFFERS
+  PROP_NUM_BUFFERS,
+  PROP_COLLECT_STATS,
+  PROP_STATS
+};
+
+/* log-linear histogram: values below 16 get a bucket of their own, every
+ * following power of two is split in 16 buckets, so that any value is known
+ * to within 6.25% with a fixed amount of memory */
+#define HIST_SUB_BITS     4
+#define HIST_SUB_BUCKETS  (1 << HIST_SUB_BITS)
+#define HIST_BUCKETS      ((64 - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+typedef struct
+{
+  guint64 count;
+  guint64 min;
+  guint64 max;
+  gdouble sum;
+  guint64 buckets[HIST_BUCKETS];
+} GstFakeSinkHistogram;
+
+struct _GstFakeSinkStats
+{
+  guint64 buffers;
+  guint64 bytes;
+  GstClockTime first_arrival;
+  GstClockTime last_arrival;
+  GstClockTime last_interval;
+  gdouble jitter;
+
+  GstFakeSinkHistogram interval;
+  GstFakeSinkHistogram latency;
+  GstFakeSinkHistogram lateness;
 };
 
 #define GST_TYPE_FAKE_SINK_STATE_ERROR (gst_fake_sink_state_error_get_type())
@@ -218,6 +271,35 @@ gst_fake_sink_class_init (GstFakeSinkClass * klass)
       g_param_spec_int ("num-buffers", "num-buffers",
           "Number of buffers to accept going EOS", -1, G_MAXINT,
           DEFAULT_NUM_BUFFERS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSink:collect-stats
+   *
+   * Collect rate, arrival jitter, latency and lateness statistics for every
+   * rendered buffer and post them in an element message on EOS.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_COLLECT_STATS,
+      g_param_spec_boolean ("collect-stats", "Collect stats",
+          "Collect statistics about the rendered buffers",
+          DEFAULT_COLLECT_STATS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSink:stats
+   *
+   * The statistics collected so far when #GstFakeSink:collect-stats is
+   * enabled. All times are in nanoseconds. The structure contains the
+   * #guint64 fields buffers, bytes, duration (between the first and the last
+   * buffer) and jitter (smoothed variation of the arrival interval), the
+   * #gdouble fields rate and byte-rate, and for each of the interval, latency
+   * and lateness distributions the #guint64 fields -count, -min, -mean, -p50,
+   * -p90, -p99, -p999 and -max, prefixed with the name of the distribution.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_STATS,
+      g_param_spec_boxed ("stats", "Statistics",
+          "Statistics about the rendered buffers", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 
   /**
    * GstFakeSink::handoff:
@@ -266,6 +348,8 @@ gst_fake_sink_init (GstFakeSink * fakesink, GstFakeSinkClass * g_class)
   fakesink->state_error = DEFAULT_STATE_ERROR;
   fakesink->signal_handoffs = DEFAULT_SIGNAL_HANDOFFS;
   fakesink->num_buffers = DEFAULT_NUM_BUFFERS;
+  fakesink->collect_stats = DEFAULT_COLLECT_STATS;
+  fakesink->stats = NULL;
   g_static_rec_mutex_init (&fakesink->notify_lock);
 
   gst_base_sink_set_sync (GST_BASE_SINK (fakesink), DEFAULT_SYNC);
@@ -277,10 +361,240 @@ gst_fake_sink_finalize (GObject * obj)
   GstFakeSink *sink = GST_FAKE_SINK (obj);
 
   g_static_rec_mutex_free (&sink->notify_lock);
+  g_free (sink->stats);
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
 
+static guint
+gst_fake_sink_histogram_index (guint64 value)
+{
+  guint msb = 0;
+  guint64 v = value;
+
+  if (value < HIST_SUB_BUCKETS)
+    return value;
+
+  if (v >> 32) {
+    msb += 32;
+    v >>= 32;
+  }
+  if (v >> 16) {
+    msb += 16;
+    v >>= 16;
+  }
+  if (v >> 8) {
+    msb += 8;
+    v >>= 8;
+  }
+  if (v >> 4) {
+    msb += 4;
+    v >>= 4;
+  }
+  if (v >> 2) {
+    msb += 2;
+    v >>= 2;
+  }
+  if (v >> 1)
+    msb += 1;
+
+  /* the band is the power of two, the sub bucket the bits after the msb */
+  return (msb - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS +
+      ((value >> (msb - HIST_SUB_BITS)) & (HIST_SUB_BUCKETS - 1));
+}
+
+/* middle of the range of values covered by bucket @index */
+static guint64
+gst_fake_sink_histogram_bucket_value (guint index)
+{
+  guint band = index >> HIST_SUB_BITS;
+  guint64 sub = index & (HIST_SUB_BUCKETS - 1);
+
+  if (band == 0)
+    return sub;
+
+  return ((HIST_SUB_BUCKETS + sub) << (band - 1)) +
+      (G_GUINT64_CONSTANT (1) << (band - 1)) / 2;
+}
+
+static void
+gst_fake_sink_histogram_add (GstFakeSinkHistogram * hist, guint64 value)
+{
+  if (hist->count == 0 || value < hist->min)
+    hist->min = value;
+  if (hist->count == 0 || value > hist->max)
+    hist->max = value;
+  hist->count++;
+  hist->sum += value;
+  hist->buckets[gst_fake_sink_histogram_index (value)]++;
+}
+
+static guint64
+gst_fake_sink_histogram_percentile (GstFakeSinkHistogram * hist,
+    gdouble fraction)
+{
+  guint64 target, seen = 0;
+  guint i;
+
+  if (hist->count == 0)
+    return 0;
+
+  target = MAX (1, (guint64) (fraction * hist->count + 0.5));
+  for (i = 0; i < HIST_BUCKETS; i++) {
+    seen += hist->buckets[i];
+    if (seen >= target)
+      return CLAMP (gst_fake_sink_histogram_bucket_value (i), hist->min,
+          hist->max);
+  }
+  return hist->max;
+}
+
+static void
+gst_fake_sink_histogram_add_fields (GstFakeSinkHistogram * hist,
+    GstStructure * s, const gchar * prefix)
+{
+  static const struct
+  {
+    const gchar *name;
+    gdouble fraction;
+  } percentiles[] = {
+    {"p50", 0.5}, {"p90", 0.9}, {"p99", 0.99}, {"p999", 0.999}
+  };
+  gchar *name;
+  guint i;
+
+#define SET_FIELD(suffix,val) G_STMT_START {                    \
+  name = g_strdup_printf ("%s-%s", prefix, suffix);             \
+  gst_structure_set (s, name, G_TYPE_UINT64, (guint64) (val), NULL); \
+  g_free (name);                                                \
+} G_STMT_END
+
+  SET_FIELD ("count", hist->count);
+  SET_FIELD ("min", hist->min);
+  SET_FIELD ("mean", hist->count ? hist->sum / hist->count : 0);
+  for (i = 0; i < G_N_ELEMENTS (percentiles); i++)
+    SET_FIELD (percentiles[i].name,
+        gst_fake_sink_histogram_percentile (hist, percentiles[i].fraction));
+  SET_FIELD ("max", hist->max);
+
+#undef SET_FIELD
+}
+
+/* with LOCK */
+static GstStructure *
+gst_fake_sink_stats_to_structure (GstFakeSink * sink)
+{
+  GstFakeSinkStats *stats = sink->stats;
+  GstStructure *s;
+  GstClockTime duration = 0;
+  gdouble rate = 0.0, byte_rate = 0.0;
+
+  s = gst_structure_empty_new ("GstFakeSinkStats");
+  if (stats == NULL)
+    return s;
+
+  if (stats->buffers > 1) {
+    duration = stats->last_arrival - stats->first_arrival;
+    if (duration > 0) {
+      rate = (gdouble) (stats->buffers - 1) * GST_SECOND / duration;
+      byte_rate = (gdouble) stats->bytes * GST_SECOND / duration;
+    }
+  }
+
+  gst_structure_set (s,
+      "buffers", G_TYPE_UINT64, stats->buffers,
+      "bytes", G_TYPE_UINT64, stats->bytes,
+      "duration", G_TYPE_UINT64, (guint64) duration,
+      "rate", G_TYPE_DOUBLE, rate,
+      "byte-rate", G_TYPE_DOUBLE, byte_rate,
+      "jitter", G_TYPE_UINT64, (guint64) stats->jitter, NULL);
+
+  gst_fake_sink_histogram_add_fields (&stats->interval, s, "interval");
+  gst_fake_sink_histogram_add_fields (&stats->latency, s, "latency");
+  gst_fake_sink_histogram_add_fields (&stats->lateness, s, "lateness");
+
+  return s;
+}
+
+static void
+gst_fake_sink_reset_stats (GstFakeSink * sink)
+{
+  GST_OBJECT_LOCK (sink);
+  if (sink->stats) {
+    memset (sink->stats, 0, sizeof (GstFakeSinkStats));
+    sink->stats->last_interval = GST_CLOCK_TIME_NONE;
+  }
+  GST_OBJECT_UNLOCK (sink);
+}
+
+static void
+gst_fake_sink_update_stats (GstFakeSink * sink, GstBuffer * buf)
+{
+  GstBaseSink *bsink = GST_BASE_SINK_CAST (sink);
+  GstFakeSinkStats *stats;
+  GstClockTime now, timestamp, latency;
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  GstClockTime render_time = GST_CLOCK_TIME_NONE;
+  GstClock *clock;
+
+  now = gst_util_get_timestamp ();
+
+  timestamp = GST_BUFFER_TIMESTAMP (buf);
+  if (GST_CLOCK_TIME_IS_VALID (timestamp)
+      && bsink->segment.format == GST_FORMAT_TIME)
+    running_time = gst_segment_to_running_time (&bsink->segment,
+        GST_FORMAT_TIME, timestamp);
+
+  /* the running time at which we render the buffer */
+  if (GST_CLOCK_TIME_IS_VALID (running_time)
+      && (clock = gst_element_get_clock (GST_ELEMENT_CAST (sink)))) {
+    GstClockTime clock_time, base_time;
+
+    clock_time = gst_clock_get_time (clock);
+    base_time = gst_element_get_base_time (GST_ELEMENT_CAST (sink));
+    if (clock_time >= base_time)
+      render_time = clock_time - base_time;
+    gst_object_unref (clock);
+  }
+  latency = gst_base_sink_get_latency (bsink);
+
+  GST_OBJECT_LOCK (sink);
+  if (G_UNLIKELY (sink->stats == NULL)) {
+    sink->stats = g_new0 (GstFakeSinkStats, 1);
+    sink->stats->last_interval = GST_CLOCK_TIME_NONE;
+  }
+  stats = sink->stats;
+
+  if (stats->buffers == 0) {
+    stats->first_arrival = now;
+  } else {
+    GstClockTime interval = now - stats->last_arrival;
+
+    gst_fake_sink_histogram_add (&stats->interval, interval);
+    /* smoothed like the RTP interarrival jitter of RFC 3550 */
+    if (GST_CLOCK_TIME_IS_VALID (stats->last_interval)) {
+      GstClockTimeDiff diff = GST_CLOCK_DIFF (stats->last_interval, interval);
+
+      stats->jitter += (ABS (diff) - stats->jitter) / 16.0;
+    }
+    stats->last_interval = interval;
+  }
+  stats->last_arrival = now;
+  stats->buffers++;
+  stats->bytes += GST_BUFFER_SIZE (buf);
+
+  if (GST_CLOCK_TIME_IS_VALID (render_time)) {
+    /* time since the buffer was captured and time since it should have been
+     * rendered, early buffers count as 0 */
+    gst_fake_sink_histogram_add (&stats->latency,
+        render_time > running_time ? render_time - running_time : 0);
+    running_time += latency;
+    gst_fake_sink_histogram_add (&stats->lateness,
+        render_time > running_time ? render_time - running_time : 0);
+  }
+  GST_OBJECT_UNLOCK (sink);
+}
+
 static void
 gst_fake_sink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -311,6 +625,9 @@ gst_fake_sink_set_property (GObject * object, guint prop_id,
     case PROP_NUM_BUFFERS:
       sink->num_buffers = g_value_get_int (value);
       break;
+    case PROP_COLLECT_STATS:
+      sink->collect_stats = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -352,6 +669,14 @@ gst_fake_sink_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_NUM_BUFFERS:
       g_value_set_int (value, sink->num_buffers);
       break;
+    case PROP_COLLECT_STATS:
+      g_value_set_boolean (value, sink->collect_stats);
+      break;
+    case PROP_STATS:
+      GST_OBJECT_LOCK (sink);
+      g_value_take_boxed (value, gst_fake_sink_stats_to_structure (sink));
+      GST_OBJECT_UNLOCK (sink);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -398,6 +723,17 @@ gst_fake_sink_event (GstBaseSink * bsink, GstEvent * event)
     gst_fake_sink_notify_last_message (sink);
   }
 
+  if (sink->collect_stats && GST_EVENT_TYPE (event) == GST_EVENT_EOS) {
+    GstStructure *s;
+
+    GST_OBJECT_LOCK (sink);
+    s = gst_fake_sink_stats_to_structure (sink);
+    GST_OBJECT_UNLOCK (sink);
+
+    gst_element_post_message (GST_ELEMENT_CAST (sink),
+        gst_message_new_element (GST_OBJECT_CAST (sink), s));
+  }
+
   if (GST_BASE_SINK_CLASS (parent_class)->event) {
     return GST_BASE_SINK_CLASS (parent_class)->event (bsink, event);
   } else {
@@ -448,6 +784,9 @@ gst_fake_sink_render (GstBaseSink * bsink, GstBuffer * buf)
   if (sink->num_buffers_left != -1)
     sink->num_buffers_left--;
 
+  if (sink->collect_stats)
+    gst_fake_sink_update_stats (sink, buf);
+
   if (!sink->silent) {
     gchar ts_str[64], dur_str[64];
 
@@ -513,6 +852,7 @@ gst_fake_sink_change_state (GstElement * element, GstStateChange transition)
       if (fakesink->state_error == FAKE_SINK_STATE_ERROR_READY_PAUSED)
         goto error;
       fakesink->num_buffers_left = fakesink->num_buffers;
+      gst_fake_sink_reset_stats (fakesink);
       break;
     case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
       if (fakesink->state_error == FAKE_SINK_STATE_ERROR_PAUSED_PLAYING)
@@ -66,6 +66,7 @@ typedef enum {
 
 typedef struct _GstFakeSink GstFakeSink;
 typedef struct _GstFakeSinkClass GstFakeSinkClass;
+typedef struct _GstFakeSinkStats GstFakeSinkStats;
 
 /**
  * GstFakeSink:
@@ -83,6 +84,9 @@ struct _GstFakeSink {
   gint                  num_buffers;
   gint                  num_buffers_left;
   GStaticRecMutex       notify_lock;
+
+  gboolean              collect_stats;
+  GstFakeSinkStats     *stats;
 };
 
 struct _GstFakeSinkClass {
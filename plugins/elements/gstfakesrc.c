@@ -37,6 +37,22 @@
  * sends an EOS.
  * </refsect2>
  *
+ * To benchmark downstream elements without fakesrc itself becoming the
+ * bottleneck, set #GstFakeSrc:data to ring. The buffers are then generated
+ * once, with the configured size and fill type, into a ring of
+ * #GstFakeSrc:ring-size buffers that is pushed over and over again. A buffer
+ * that is still in use downstream when its turn comes is pushed as a
+ * sub-buffer sharing the same data. #GstFakeSrc:buffer-rate gives the buffers
+ * deterministic timestamps and durations, and in live mode
+ * #GstFakeSrc:jitter randomly delays the moment they are pushed to simulate
+ * capture jitter.
+ * <refsect2>
+ * <title>Example launch line</title>
+ * |[
+ * gst-launch fakesrc data=ring sizetype=fixed sizemax=1024 num-buffers=1000000 ! fakesink
+ * ]| Push a million buffers of 1024 bytes as fast as possible.
+ * </refsect2>
+ *
  * Last reviewed on 2008-06-20 (0.10.21)
  */
 
@@ -88,6 +104,9 @@ enum
 #define DEFAULT_CAN_ACTIVATE_PULL TRUE
 #define DEFAULT_CAN_ACTIVATE_PUSH TRUE
 #define DEFAULT_FORMAT          GST_FORMAT_BYTES
+#define DEFAULT_RING_SIZE       16
+#define DEFAULT_BUFFER_RATE     0
+#define DEFAULT_JITTER          0
 
 enum
 {
@@ -111,6 +130,9 @@ enum
   PROP_CAN_ACTIVATE_PUSH,
   PROP_IS_LIVE,
   PROP_FORMAT,
+  PROP_RING_SIZE,
+  PROP_BUFFER_RATE,
+  PROP_JITTER,
   PROP_LAST,
 };
 
@@ -148,6 +170,7 @@ gst_fake_src_data_get_type (void)
   static const GEnumValue fakesrc_data[] = {
     {FAKE_SRC_DATA_ALLOCATE, "Allocate data", "allocate"},
     {FAKE_SRC_DATA_SUBBUFFER, "Subbuffer data", "subbuffer"},
+    {FAKE_SRC_DATA_RING, "Recycle a ring of pre-generated buffers", "ring"},
     {0, NULL, NULL},
   };
 
@@ -362,6 +385,47 @@ gst_fake_src_class_init (GstFakeSrcClass * klass)
       g_param_spec_enum ("format", "Format",
           "The format of the segment events", GST_TYPE_FORMAT,
           DEFAULT_FORMAT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSrc:ring-size
+   *
+   * Number of buffers pre-generated when #GstFakeSrc:data is ring. A new
+   * value is used the next time the ring is generated, when the element is
+   * started again.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_RING_SIZE,
+      g_param_spec_uint ("ring-size", "Ring size",
+          "Number of pre-generated buffers to recycle with data=ring", 1,
+          G_MAXUINT, DEFAULT_RING_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSrc:buffer-rate
+   *
+   * Timestamp buffers at a fixed number of buffers per second, independently
+   * of their size. Takes precedence over #GstFakeSrc:datarate.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_BUFFER_RATE,
+      g_param_spec_int ("buffer-rate", "Buffer rate",
+          "Timestamps buffers with number of buffers per second (0 = none)",
+          0, G_MAXINT, DEFAULT_BUFFER_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFakeSrc:jitter
+   *
+   * Maximum random delay in nanoseconds added to the time at which buffers are
+   * pushed when synchronising to the clock. The timestamps themselves are not
+   * changed. The random sequence is the same for every run.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_JITTER,
+      g_param_spec_uint64 ("jitter", "Jitter",
+          "Maximum random delay in nanoseconds when syncing to the clock", 0,
+          G_MAXUINT64, DEFAULT_JITTER,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   /**
    * GstFakeSrc::handoff:
@@ -405,6 +469,13 @@ gst_fake_src_init (GstFakeSrc * fakesrc, GstFakeSrcClass * g_class)
   fakesrc->datarate = DEFAULT_DATARATE;
   fakesrc->sync = DEFAULT_SYNC;
   fakesrc->format = DEFAULT_FORMAT;
+  fakesrc->ring_size = DEFAULT_RING_SIZE;
+  fakesrc->ring = NULL;
+  fakesrc->ring_len = 0;
+  fakesrc->ring_pos = 0;
+  fakesrc->buffer_rate = DEFAULT_BUFFER_RATE;
+  fakesrc->jitter = DEFAULT_JITTER;
+  fakesrc->rand = NULL;
 }
 
 static void
@@ -541,6 +612,15 @@ gst_fake_src_set_property (GObject * object, guint prop_id,
     case PROP_FORMAT:
       src->format = g_value_get_enum (value);
       break;
+    case PROP_RING_SIZE:
+      src->ring_size = g_value_get_uint (value);
+      break;
+    case PROP_BUFFER_RATE:
+      src->buffer_rate = g_value_get_int (value);
+      break;
+    case PROP_JITTER:
+      src->jitter = g_value_get_uint64 (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -616,6 +696,15 @@ gst_fake_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_FORMAT:
       g_value_set_enum (value, src->format);
       break;
+    case PROP_RING_SIZE:
+      g_value_set_uint (value, src->ring_size);
+      break;
+    case PROP_BUFFER_RATE:
+      g_value_set_int (value, src->buffer_rate);
+      break;
+    case PROP_JITTER:
+      g_value_set_uint64 (value, src->jitter);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -747,6 +836,9 @@ gst_fake_src_create_buffer (GstFakeSrc * src)
       }
       gst_fake_src_prepare_buffer (src, buf);
       break;
+    case FAKE_SRC_DATA_RING:
+      buf = gst_fake_src_alloc_buffer (src, size);
+      break;
     default:
       g_warning ("fakesrc: dunno how to allocate buffers !");
       buf = gst_buffer_new ();
@@ -759,6 +851,64 @@ gst_fake_src_create_buffer (GstFakeSrc * src)
   return buf;
 }
 
+static void
+gst_fake_src_free_ring (GstFakeSrc * src)
+{
+  guint i;
+
+  if (src->ring == NULL)
+    return;
+
+  for (i = 0; i < src->ring_len; i++) {
+    if (src->ring[i])
+      gst_buffer_unref (src->ring[i]);
+  }
+  g_free (src->ring);
+  src->ring = NULL;
+  src->ring_len = 0;
+}
+
+static void
+gst_fake_src_fill_ring (GstFakeSrc * src)
+{
+  guint i;
+
+  /* ring-size can change while we run, the ring keeps its own length */
+  src->ring_len = src->ring_size;
+  src->ring = g_new0 (GstBuffer *, src->ring_len);
+  for (i = 0; i < src->ring_len; i++)
+    src->ring[i] = gst_fake_src_create_buffer (src);
+  src->ring_pos = 0;
+
+  GST_DEBUG_OBJECT (src, "generated ring of %u buffers", src->ring_len);
+}
+
+static GstBuffer *
+gst_fake_src_get_ring_buffer (GstFakeSrc * src)
+{
+  GstBuffer *buf;
+
+  if (G_UNLIKELY (src->ring == NULL))
+    gst_fake_src_fill_ring (src);
+
+  buf = src->ring[src->ring_pos];
+  src->ring_pos = (src->ring_pos + 1) % src->ring_len;
+
+  /* when only the ring holds the buffer, nobody downstream can see us changing
+   * its metadata and we can push it again as is */
+  if (G_LIKELY (GST_MINI_OBJECT_REFCOUNT_VALUE (buf) == 1)) {
+    GST_BUFFER_FLAGS (buf) = 0;
+    buf = gst_buffer_ref (buf);
+  } else {
+    /* still in use downstream, push the same data with new metadata */
+    buf = gst_buffer_create_sub (buf, 0, GST_BUFFER_SIZE (buf));
+  }
+  GST_BUFFER_DURATION (buf) = GST_CLOCK_TIME_NONE;
+  GST_BUFFER_OFFSET_END (buf) = GST_BUFFER_OFFSET_NONE;
+
+  return buf;
+}
+
 static void
 gst_fake_src_get_times (GstBaseSrc * basesrc, GstBuffer * buffer,
     GstClockTime * start, GstClockTime * end)
@@ -779,6 +929,16 @@ gst_fake_src_get_times (GstBaseSrc * basesrc, GstBuffer * buffer,
         *end = timestamp + duration;
       }
       *start = timestamp;
+
+      /* push late by a random amount to simulate a jittery capture */
+      if (src->jitter > 0) {
+        GstClockTime delay;
+
+        delay = (GstClockTime) g_rand_double_range (src->rand, 0, src->jitter);
+        *start += delay;
+        if (GST_CLOCK_TIME_IS_VALID (*end))
+          *end += delay;
+      }
     }
   } else {
     *start = -1;
@@ -796,10 +956,20 @@ gst_fake_src_create (GstBaseSrc * basesrc, guint64 offset, guint length,
 
   src = GST_FAKE_SRC (basesrc);
 
-  buf = gst_fake_src_create_buffer (src);
+  if (src->data == FAKE_SRC_DATA_RING)
+    buf = gst_fake_src_get_ring_buffer (src);
+  else
+    buf = gst_fake_src_create_buffer (src);
   GST_BUFFER_OFFSET (buf) = src->buffer_count++;
 
-  if (src->datarate > 0) {
+  if (src->buffer_rate > 0) {
+    time = gst_util_uint64_scale_int (GST_BUFFER_OFFSET (buf), GST_SECOND,
+        src->buffer_rate);
+
+    GST_BUFFER_DURATION (buf) =
+        gst_util_uint64_scale_int (GST_BUFFER_OFFSET (buf) + 1, GST_SECOND,
+        src->buffer_rate) - time;
+  } else if (src->datarate > 0) {
     time = (src->bytes_sent * GST_SECOND) / src->datarate;
 
     GST_BUFFER_DURATION (buf) =
@@ -878,6 +1048,9 @@ gst_fake_src_start (GstBaseSrc * basesrc)
   src->pattern_byte = 0x00;
   src->bytes_sent = 0;
 
+  /* same seed every time so that runs can be compared */
+  src->rand = g_rand_new_with_seed (0);
+
   gst_base_src_set_format (basesrc, src->format);
 
   return TRUE;
@@ -899,6 +1072,12 @@ gst_fake_src_stop (GstBaseSrc * basesrc)
   src->last_message = NULL;
   GST_OBJECT_UNLOCK (src);
 
+  gst_fake_src_free_ring (src);
+  if (src->rand) {
+    g_rand_free (src->rand);
+    src->rand = NULL;
+  }
+
   return TRUE;
 }
 
@@ -57,12 +57,14 @@ typedef enum {
  * GstFakeSrcDataType:
  * @FAKE_SRC_DATA_ALLOCATE: allocate buffers
  * @FAKE_SRC_DATA_SUBBUFFER: subbuffer each buffer
+ * @FAKE_SRC_DATA_RING: recycle a ring of pre-generated buffers (Since: 0.10.31)
  *
  * The different ways buffers are allocated.
  */
 typedef enum {
   FAKE_SRC_DATA_ALLOCATE = 1,
-  FAKE_SRC_DATA_SUBBUFFER
+  FAKE_SRC_DATA_SUBBUFFER,
+  FAKE_SRC_DATA_RING
 } GstFakeSrcDataType;
 
 /**
@@ -152,6 +154,16 @@ struct _GstFakeSrc {
   guint64        bytes_sent;
 
   gchar		*last_message;
+
+  /* pre-generated buffers for FAKE_SRC_DATA_RING */
+  guint          ring_size;
+  GstBuffer    **ring;
+  guint          ring_len;
+  guint          ring_pos;
+
+  gint           buffer_rate;
+  guint64        jitter;
+  GRand         *rand;
 };
 
 struct _GstFakeSrcClass {
@@ -30,6 +30,18 @@
  * socket. For file descriptors where this does not make sense (files, ...) the
  * #GstBaseSink:sync property can be used to disable synchronisation.
  *
+ * When writing into a pipe, the #GstFdSink:vmsplice property makes fdsink
+ * hand out page aligned buffers to upstream elements and pass their pages to
+ * the pipe with vmsplice() instead of copying them with write(). Upstream
+ * elements that fill buffers obtained with gst_pad_alloc_buffer(), such as
+ * #GstFdSrc with #GstFdSrc:use-buffer-alloc enabled, then relay data without
+ * a userspace copy. The pages are recycled once the reader has read them from
+ * the pipe. Other buffers, and systems without vmsplice(), fall back to
+ * write().
+ *
+ * Buffer lists are written with writev() where available, so that buffers in
+ * a group (for example a header and its payload) are not merged first.
+ *
  * Last reviewed on 2006-04-28 (0.10.6)
  */
 
@@ -66,9 +78,30 @@
 #endif
 #include <errno.h>
 #include <string.h>
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#endif
+#if defined (HAVE_SYS_UIO_H) || defined (HAVE_VMSPLICE)
+#include <sys/uio.h>
+#endif
+#ifdef HAVE_VMSPLICE
+#include <sys/ioctl.h>
+#endif
 
 #include "gstfdsink.h"
 
+#if defined (HAVE_VMSPLICE) && defined (HAVE_MMAP)
+#define USE_VMSPLICE 1
+/* number of unused mappings kept for reuse */
+#define MAX_POOLED_PAGES 16
+#endif
+
+#if defined (HAVE_WRITEV) && defined (HAVE_SYS_UIO_H)
+#define USE_WRITEV 1
+/* number of buffers written with one writev() call */
+#define MAX_VECS 64
+#endif
+
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
     GST_PAD_ALWAYS,
@@ -85,10 +118,13 @@ enum
   LAST_SIGNAL
 };
 
+#define DEFAULT_VMSPLICE        FALSE
+
 enum
 {
   ARG_0,
-  ARG_FD
+  ARG_FD,
+  ARG_VMSPLICE
 };
 
 static void gst_fd_sink_uri_handler_init (gpointer g_iface,
@@ -121,11 +157,17 @@ static void gst_fd_sink_dispose (GObject * obj);
 static gboolean gst_fd_sink_query (GstPad * pad, GstQuery * query);
 static GstFlowReturn gst_fd_sink_render (GstBaseSink * sink,
     GstBuffer * buffer);
+#ifdef USE_WRITEV
+static GstFlowReturn gst_fd_sink_render_list (GstBaseSink * sink,
+    GstBufferList * list);
+#endif
 static gboolean gst_fd_sink_start (GstBaseSink * basesink);
 static gboolean gst_fd_sink_stop (GstBaseSink * basesink);
 static gboolean gst_fd_sink_unlock (GstBaseSink * basesink);
 static gboolean gst_fd_sink_unlock_stop (GstBaseSink * basesink);
 static gboolean gst_fd_sink_event (GstBaseSink * sink, GstEvent * event);
+static GstFlowReturn gst_fd_sink_buffer_alloc (GstBaseSink * sink,
+    guint64 offset, guint size, GstCaps * caps, GstBuffer ** buf);
 
 static gboolean gst_fd_sink_do_seek (GstFdSink * fdsink, guint64 new_offset);
 
@@ -156,15 +198,33 @@ gst_fd_sink_class_init (GstFdSinkClass * klass)
   gobject_class->dispose = gst_fd_sink_dispose;
 
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_fd_sink_render);
+#ifdef USE_WRITEV
+  gstbasesink_class->render_list = GST_DEBUG_FUNCPTR (gst_fd_sink_render_list);
+#endif
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_fd_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_fd_sink_stop);
   gstbasesink_class->unlock = GST_DEBUG_FUNCPTR (gst_fd_sink_unlock);
   gstbasesink_class->unlock_stop = GST_DEBUG_FUNCPTR (gst_fd_sink_unlock_stop);
   gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_fd_sink_event);
+  gstbasesink_class->buffer_alloc =
+      GST_DEBUG_FUNCPTR (gst_fd_sink_buffer_alloc);
 
   g_object_class_install_property (gobject_class, ARG_FD,
       g_param_spec_int ("fd", "fd", "An open file descriptor to write to",
           0, G_MAXINT, 1, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFdSink:vmsplice
+   *
+   * When the file descriptor is a pipe, provide page aligned buffers to
+   * upstream and write them into the pipe with vmsplice() instead of
+   * copying them. Has no effect on systems without vmsplice().
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, ARG_VMSPLICE,
+      g_param_spec_boolean ("vmsplice", "vmsplice",
+          "Write page aligned buffers into pipes without copying",
+          DEFAULT_VMSPLICE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -179,6 +239,11 @@ gst_fd_sink_init (GstFdSink * fdsink, GstFdSinkClass * klass)
   fdsink->uri = g_strdup_printf ("fd://%d", fdsink->fd);
   fdsink->bytes_written = 0;
   fdsink->current_pos = 0;
+  fdsink->vmsplice = DEFAULT_VMSPLICE;
+  fdsink->is_pipe = FALSE;
+#ifdef USE_VMSPLICE
+  fdsink->pagesize = getpagesize ();
+#endif
 
   gst_base_sink_set_sync (GST_BASE_SINK (fdsink), FALSE);
 }
@@ -227,6 +292,192 @@ gst_fd_sink_query (GstPad * pad, GstQuery * query)
   }
 }
 
+#ifdef USE_VMSPLICE
+/* vmsplice() makes the pipe reference our pages instead of copying them, so
+ * the pages must not be written again until the reader has read them from the
+ * pipe. Unmapping them is safe at any time, the pipe keeps its own reference
+ * to the pages and a new mapping gets fresh ones.
+ *
+ * The first page of a mapping holds a GstFdSinkPages header, the buffer data
+ * starts on the second page. When a buffer is freed its mapping goes back
+ * to the pool of the sink and is only handed out again once the pipe has
+ * drained past the bytes that were spliced from it. */
+typedef struct
+{
+  GstFdSinkPagePool *pool;
+  gsize mapsize;
+  /* value of bytes_written after the pages were spliced, 0 if they never
+   * were */
+  guint64 end;
+} GstFdSinkPages;
+
+struct _GstFdSinkPagePool
+{
+  gint refcount;
+  GMutex *lock;
+  GQueue free;
+  /* set when the sink stopped, mappings are then unmapped when freed */
+  gboolean closed;
+};
+
+static GstFdSinkPagePool *
+gst_fd_sink_page_pool_new (void)
+{
+  GstFdSinkPagePool *pool;
+
+  pool = g_slice_new0 (GstFdSinkPagePool);
+  pool->refcount = 1;
+  pool->lock = g_mutex_new ();
+  g_queue_init (&pool->free);
+
+  return pool;
+}
+
+static void
+gst_fd_sink_page_pool_unref (GstFdSinkPagePool * pool)
+{
+  if (!g_atomic_int_dec_and_test (&pool->refcount))
+    return;
+
+  g_mutex_free (pool->lock);
+  g_slice_free (GstFdSinkPagePool, pool);
+}
+
+static void
+gst_fd_sink_pages_unmap (GstFdSinkPages * pages)
+{
+  GstFdSinkPagePool *pool = pages->pool;
+
+  munmap (pages, pages->mapsize);
+  gst_fd_sink_page_pool_unref (pool);
+}
+
+/* unmaps all pooled mappings, the ones still used by buffers are unmapped
+ * when the buffers are freed */
+static void
+gst_fd_sink_page_pool_close (GstFdSinkPagePool * pool)
+{
+  GstFdSinkPages *pages;
+
+  g_mutex_lock (pool->lock);
+  pool->closed = TRUE;
+  while ((pages = g_queue_pop_head (&pool->free)))
+    gst_fd_sink_pages_unmap (pages);
+  g_mutex_unlock (pool->lock);
+
+  gst_fd_sink_page_pool_unref (pool);
+}
+
+static void
+gst_fd_sink_free_pages (gpointer mem)
+{
+  GstFdSinkPages *pages = mem;
+  GstFdSinkPagePool *pool = pages->pool;
+
+  g_mutex_lock (pool->lock);
+  if (!pool->closed && pool->free.length < MAX_POOLED_PAGES) {
+    g_queue_push_tail (&pool->free, pages);
+    pages = NULL;
+  }
+  g_mutex_unlock (pool->lock);
+
+  if (pages)
+    gst_fd_sink_pages_unmap (pages);
+}
+
+/* takes a pooled mapping of @mapsize bytes whose pages the reader has read
+ * already */
+static GstFdSinkPages *
+gst_fd_sink_page_pool_acquire (GstFdSink * fdsink, gsize mapsize)
+{
+  GstFdSinkPagePool *pool = fdsink->pool;
+  GstFdSinkPages *pages = NULL;
+  guint64 consumed;
+  GList *walk;
+  gint queued;
+
+  /* everything we wrote minus what is still in the pipe has been read */
+  if (ioctl (fdsink->fd, FIONREAD, &queued) < 0 || queued < 0)
+    return NULL;
+  consumed = fdsink->bytes_written - MIN ((guint64) queued,
+      fdsink->bytes_written);
+
+  g_mutex_lock (pool->lock);
+  for (walk = pool->free.head; walk; walk = walk->next) {
+    GstFdSinkPages *p = walk->data;
+
+    if (p->mapsize == mapsize && p->end <= consumed) {
+      g_queue_delete_link (&pool->free, walk);
+      pages = p;
+      break;
+    }
+  }
+  g_mutex_unlock (pool->lock);
+
+  return pages;
+}
+#endif
+
+static GstFlowReturn
+gst_fd_sink_buffer_alloc (GstBaseSink * sink, guint64 offset, guint size,
+    GstCaps * caps, GstBuffer ** buf)
+{
+#ifdef USE_VMSPLICE
+  GstFdSink *fdsink = GST_FD_SINK (sink);
+  GstBuffer *buffer;
+  GstFdSinkPages *pages;
+  gsize mapsize;
+
+  if (!fdsink->vmsplice || !fdsink->is_pipe || !fdsink->pool || size == 0)
+    goto fallback;
+
+  mapsize = fdsink->pagesize +
+      ((size + fdsink->pagesize - 1) / fdsink->pagesize) * fdsink->pagesize;
+
+  pages = gst_fd_sink_page_pool_acquire (fdsink, mapsize);
+  if (pages == NULL) {
+    pages = mmap (NULL, mapsize, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (G_UNLIKELY (pages == MAP_FAILED))
+      goto mmap_failed;
+
+    g_atomic_int_inc (&fdsink->pool->refcount);
+    pages->pool = fdsink->pool;
+    pages->mapsize = mapsize;
+  }
+  pages->end = 0;
+
+  buffer = gst_buffer_new ();
+  GST_BUFFER_MALLOCDATA (buffer) = (guint8 *) pages;
+  GST_BUFFER_FREE_FUNC (buffer) = gst_fd_sink_free_pages;
+  GST_BUFFER_DATA (buffer) = (guint8 *) pages + fdsink->pagesize;
+  GST_BUFFER_SIZE (buffer) = size;
+  GST_BUFFER_OFFSET (buffer) = offset;
+  if (caps)
+    gst_buffer_set_caps (buffer, caps);
+
+  GST_LOG_OBJECT (fdsink, "allocated %u bytes in %" G_GSIZE_FORMAT
+      " mapped bytes", size, mapsize);
+
+  *buf = buffer;
+
+  return GST_FLOW_OK;
+
+mmap_failed:
+  {
+    GST_WARNING_OBJECT (fdsink, "mmap of %" G_GSIZE_FORMAT " bytes failed: %s",
+        mapsize, g_strerror (errno));
+    goto fallback;
+  }
+fallback:
+#endif
+  {
+    /* let the core allocate a normal buffer */
+    *buf = NULL;
+    return GST_FLOW_OK;
+  }
+}
+
 static GstFlowReturn
 gst_fd_sink_render (GstBaseSink * sink, GstBuffer * buffer)
 {
@@ -234,6 +485,9 @@ gst_fd_sink_render (GstBaseSink * sink, GstBuffer * buffer)
   guint8 *data;
   guint size;
   gint written;
+#ifdef USE_VMSPLICE
+  gboolean use_vmsplice;
+#endif
 
 #ifndef HAVE_WIN32
   gint retval;
@@ -246,6 +500,13 @@ gst_fd_sink_render (GstBaseSink * sink, GstBuffer * buffer)
   data = GST_BUFFER_DATA (buffer);
   size = GST_BUFFER_SIZE (buffer);
 
+#ifdef USE_VMSPLICE
+  /* only our own mappings are safe to splice, any other memory could be
+   * reused by the allocator while the pipe still references it */
+  use_vmsplice = fdsink->vmsplice && fdsink->is_pipe &&
+      GST_BUFFER_FREE_FUNC (buffer) == gst_fd_sink_free_pages;
+#endif
+
 again:
 #ifndef HAVE_WIN32
   do {
@@ -265,7 +526,25 @@ again:
   GST_DEBUG_OBJECT (fdsink, "writing %d bytes to file descriptor %d", size,
       fdsink->fd);
 
-  written = write (fdsink->fd, data, size);
+#ifdef USE_VMSPLICE
+  if (use_vmsplice) {
+    struct iovec iov;
+
+    iov.iov_base = data;
+    iov.iov_len = size;
+
+    written = vmsplice (fdsink->fd, &iov, 1, 0);
+
+    if (G_UNLIKELY (written < 0 && (errno == ENOSYS || errno == EINVAL))) {
+      GST_WARNING_OBJECT (fdsink, "vmsplice failed: %s, falling back to write",
+          g_strerror (errno));
+      fdsink->is_pipe = FALSE;
+      use_vmsplice = FALSE;
+      goto again;
+    }
+  } else
+#endif
+    written = write (fdsink->fd, data, size);
 
   /* check for errors */
   if (G_UNLIKELY (written < 0)) {
@@ -283,6 +562,15 @@ again:
   fdsink->bytes_written += written;
   fdsink->current_pos += written;
 
+#ifdef USE_VMSPLICE
+  /* the pages may be reused once the reader got past this point. Record it
+   * right away, the pipe references the pages even when the remainder is
+   * written with write() or fails */
+  if (use_vmsplice)
+    ((GstFdSinkPages *) GST_BUFFER_MALLOCDATA (buffer))->end =
+        fdsink->bytes_written;
+#endif
+
   GST_DEBUG_OBJECT (fdsink, "wrote %d bytes, %d left", written, size);
 
   /* short write, select and try to write the remainder */
@@ -322,6 +610,158 @@ write_error:
   }
 }
 
+#ifdef USE_WRITEV
+static GstFlowReturn
+gst_fd_sink_writev (GstFdSink * fdsink, struct iovec *vecs, gint n_vecs,
+    guint size)
+{
+  gssize written;
+
+#ifndef HAVE_WIN32
+  gint retval;
+#endif
+
+again:
+#ifndef HAVE_WIN32
+  do {
+    GST_DEBUG_OBJECT (fdsink, "going into select, have %d bytes to write",
+        size);
+    retval = gst_poll_wait (fdsink->fdset, GST_CLOCK_TIME_NONE);
+  } while (retval == -1 && (errno == EINTR || errno == EAGAIN));
+
+  if (retval == -1) {
+    if (errno == EBUSY)
+      goto stopped;
+    else
+      goto select_error;
+  }
+#endif
+
+  GST_DEBUG_OBJECT (fdsink, "writing %d bytes in %d vectors to file "
+      "descriptor %d", size, n_vecs, fdsink->fd);
+
+  written = writev (fdsink->fd, vecs, n_vecs);
+
+  if (G_UNLIKELY (written < 0)) {
+    if (errno == EAGAIN || errno == EINTR)
+      goto again;
+
+    goto write_error;
+  }
+
+  size -= written;
+  fdsink->bytes_written += written;
+  fdsink->current_pos += written;
+
+  GST_DEBUG_OBJECT (fdsink, "wrote %" G_GSSIZE_FORMAT " bytes, %d left",
+      written, size);
+
+  if (G_UNLIKELY (size > 0)) {
+    /* short write, skip the vectors that were written completely and
+     * continue in the middle of the partially written one */
+    while (written >= (gssize) vecs->iov_len) {
+      written -= vecs->iov_len;
+      vecs++;
+      n_vecs--;
+    }
+    vecs->iov_base = (guint8 *) vecs->iov_base + written;
+    vecs->iov_len -= written;
+    goto again;
+  }
+
+  return GST_FLOW_OK;
+
+#ifndef HAVE_WIN32
+select_error:
+  {
+    GST_ELEMENT_ERROR (fdsink, RESOURCE, READ, (NULL),
+        ("select on file descriptor: %s.", g_strerror (errno)));
+    GST_DEBUG_OBJECT (fdsink, "Error during select");
+    return GST_FLOW_ERROR;
+  }
+stopped:
+  {
+    GST_DEBUG_OBJECT (fdsink, "Select stopped");
+    return GST_FLOW_WRONG_STATE;
+  }
+#endif
+
+write_error:
+  {
+    switch (errno) {
+      case ENOSPC:
+        GST_ELEMENT_ERROR (fdsink, RESOURCE, NO_SPACE_LEFT, (NULL), (NULL));
+        break;
+      default:{
+        GST_ELEMENT_ERROR (fdsink, RESOURCE, WRITE, (NULL),
+            ("Error while writing to file descriptor %d: %s",
+                fdsink->fd, g_strerror (errno)));
+      }
+    }
+    return GST_FLOW_ERROR;
+  }
+}
+
+/* writes all buffers of the list with writev(), so that headers and payloads
+ * in separate buffers do not have to be merged first */
+static GstFlowReturn
+gst_fd_sink_render_list (GstBaseSink * sink, GstBufferList * list)
+{
+  GstFdSink *fdsink;
+  GstBufferListIterator *it;
+  GstBuffer *buffer;
+  struct iovec vecs[MAX_VECS];
+  gint n_vecs = 0;
+  guint size = 0;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  fdsink = GST_FD_SINK (sink);
+
+  g_return_val_if_fail (fdsink->fd >= 0, GST_FLOW_ERROR);
+
+  it = gst_buffer_list_iterate (list);
+  while (ret == GST_FLOW_OK && gst_buffer_list_iterator_next_group (it)) {
+    while (ret == GST_FLOW_OK && (buffer = gst_buffer_list_iterator_next (it))) {
+      if (GST_BUFFER_SIZE (buffer) == 0)
+        continue;
+
+#ifdef USE_VMSPLICE
+      /* buffers we allocated ourselves are spliced one by one, after writing
+       * everything before them */
+      if (fdsink->vmsplice && fdsink->is_pipe &&
+          GST_BUFFER_FREE_FUNC (buffer) == gst_fd_sink_free_pages) {
+        if (n_vecs > 0) {
+          ret = gst_fd_sink_writev (fdsink, vecs, n_vecs, size);
+          n_vecs = 0;
+          size = 0;
+          if (ret != GST_FLOW_OK)
+            break;
+        }
+        ret = gst_fd_sink_render (sink, buffer);
+        continue;
+      }
+#endif
+
+      if (n_vecs == MAX_VECS) {
+        ret = gst_fd_sink_writev (fdsink, vecs, n_vecs, size);
+        n_vecs = 0;
+        size = 0;
+      }
+      vecs[n_vecs].iov_base = GST_BUFFER_DATA (buffer);
+      vecs[n_vecs].iov_len = GST_BUFFER_SIZE (buffer);
+      size += GST_BUFFER_SIZE (buffer);
+      n_vecs++;
+    }
+  }
+  gst_buffer_list_iterator_free (it);
+
+  if (ret == GST_FLOW_OK && n_vecs > 0)
+    ret = gst_fd_sink_writev (fdsink, vecs, n_vecs, size);
+
+  return ret;
+}
+#endif
+
 static gboolean
 gst_fd_sink_check_fd (GstFdSink * fdsink, int fd)
 {
@@ -364,6 +804,21 @@ not_seekable:
   }
 }
 
+static gboolean
+gst_fd_sink_fd_is_pipe (int fd)
+{
+#ifdef S_ISFIFO
+  struct stat stat_results;
+
+  if (fstat (fd, &stat_results) < 0)
+    return FALSE;
+
+  return S_ISFIFO (stat_results.st_mode);
+#else
+  return FALSE;
+#endif
+}
+
 static gboolean
 gst_fd_sink_start (GstBaseSink * basesink)
 {
@@ -383,6 +838,10 @@ gst_fd_sink_start (GstBaseSink * basesink)
 
   fdsink->bytes_written = 0;
   fdsink->current_pos = 0;
+  fdsink->is_pipe = gst_fd_sink_fd_is_pipe (fdsink->fd);
+#ifdef USE_VMSPLICE
+  fdsink->pool = gst_fd_sink_page_pool_new ();
+#endif
 
   return TRUE;
 
@@ -404,6 +863,12 @@ gst_fd_sink_stop (GstBaseSink * basesink)
     gst_poll_free (fdsink->fdset);
     fdsink->fdset = NULL;
   }
+#ifdef USE_VMSPLICE
+  if (fdsink->pool) {
+    gst_fd_sink_page_pool_close (fdsink->pool);
+    fdsink->pool = NULL;
+  }
+#endif
 
   return TRUE;
 }
@@ -456,6 +921,7 @@ gst_fd_sink_update_fd (GstFdSink * fdsink, int new_fd)
     gst_poll_fd_ctl_write (fdsink->fdset, &fd, TRUE);
   }
   fdsink->fd = new_fd;
+  fdsink->is_pipe = gst_fd_sink_fd_is_pipe (new_fd);
   g_free (fdsink->uri);
   fdsink->uri = g_strdup_printf ("fd://%d", fdsink->fd);
 
@@ -487,6 +953,9 @@ gst_fd_sink_set_property (GObject * object, guint prop_id,
       gst_fd_sink_update_fd (fdsink, fd);
       break;
     }
+    case ARG_VMSPLICE:
+      fdsink->vmsplice = g_value_get_boolean (value);
+      break;
     default:
       break;
   }
@@ -506,6 +975,9 @@ gst_fd_sink_get_property (GObject * object, guint prop_id, GValue * value,
     case ARG_FD:
       g_value_set_int (value, fdsink->fd);
       break;
+    case ARG_VMSPLICE:
+      g_value_set_boolean (value, fdsink->vmsplice);
+      break;
     default:
       break;
   }
@@ -43,6 +43,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstFdSink GstFdSink;
 typedef struct _GstFdSinkClass GstFdSinkClass;
+typedef struct _GstFdSinkPagePool GstFdSinkPagePool;
 
 /**
  * GstFdSink:
@@ -59,6 +60,11 @@ struct _GstFdSink {
   int fd;
   guint64 bytes_written;
   guint64 current_pos;
+
+  gboolean vmsplice;
+  gboolean is_pipe;
+  guint pagesize;
+  GstFdSinkPagePool *pool;
 };
 
 struct _GstFdSinkClass {
@@ -43,6 +43,17 @@
  *   </para>
  * </listitem>
  * </itemizedlist>
+ *
+ * When #GstFdSrc:use-buffer-alloc is enabled, fdsrc reads into buffers
+ * allocated by the downstream peer instead of allocating them itself. In
+ * combination with the #GstFdSink:vmsplice property of a downstream fdsink
+ * writing into a pipe, the data is relayed with a single copy from the kernel.
+ *
+ * With #GstFdSrc:adaptive-blocksize enabled, the size of the reads grows up to
+ * #GstFdSrc:max-blocksize while every read fills the whole buffer and shrinks
+ * back towards #GstBaseSrc:blocksize when less data is available. This reduces
+ * the number of polls and reads per byte for high rate pipe and socket input.
+ * Live sources always read #GstBaseSrc:blocksize bytes to keep latency low.
  * 
  * <refsect2>
  * <title>Example launch line</title>
@@ -100,6 +111,9 @@ GST_DEBUG_CATEGORY_STATIC (gst_fd_src_debug);
 
 #define DEFAULT_FD              0
 #define DEFAULT_TIMEOUT         0
+#define DEFAULT_USE_BUFFER_ALLOC FALSE
+#define DEFAULT_ADAPTIVE_BLOCKSIZE FALSE
+#define DEFAULT_MAX_BLOCKSIZE   (256 * 1024)
 
 enum
 {
@@ -107,6 +121,9 @@ enum
 
   PROP_FD,
   PROP_TIMEOUT,
+  PROP_USE_BUFFER_ALLOC,
+  PROP_ADAPTIVE_BLOCKSIZE,
+  PROP_MAX_BLOCKSIZE,
 
   PROP_LAST
 };
@@ -193,6 +210,45 @@ gst_fd_src_class_init (GstFdSrcClass * klass)
           "Post a message after timeout microseconds (0 = disabled)", 0,
           G_MAXUINT64, DEFAULT_TIMEOUT,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFdSrc:use-buffer-alloc
+   *
+   * Read into buffers allocated by the downstream peer. This lets sinks such
+   * as fdsink provide memory they can write out without copying.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_USE_BUFFER_ALLOC, g_param_spec_boolean ("use-buffer-alloc",
+          "Use buffer alloc", "Read into buffers allocated by downstream",
+          DEFAULT_USE_BUFFER_ALLOC,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFdSrc:adaptive-blocksize
+   *
+   * Grow the read size up to #GstFdSrc:max-blocksize while data is plentiful
+   * and shrink it again when reads come back short.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_ADAPTIVE_BLOCKSIZE, g_param_spec_boolean ("adaptive-blocksize",
+          "Adaptive blocksize", "Adapt the read size to the available data",
+          DEFAULT_ADAPTIVE_BLOCKSIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstFdSrc:max-blocksize
+   *
+   * The maximum number of bytes to read at once when
+   * #GstFdSrc:adaptive-blocksize is enabled.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_MAX_BLOCKSIZE, g_param_spec_uint ("max-blocksize",
+          "Max blocksize", "Maximum size to read per buffer with "
+          "adaptive-blocksize", 1, G_MAXUINT, DEFAULT_MAX_BLOCKSIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstbasesrc_class->start = GST_DEBUG_FUNCPTR (gst_fd_src_start);
   gstbasesrc_class->stop = GST_DEBUG_FUNCPTR (gst_fd_src_stop);
@@ -214,6 +270,10 @@ gst_fd_src_init (GstFdSrc * fdsrc, GstFdSrcClass * klass)
   fdsrc->fd = -1;
   fdsrc->size = -1;
   fdsrc->timeout = DEFAULT_TIMEOUT;
+  fdsrc->use_buffer_alloc = DEFAULT_USE_BUFFER_ALLOC;
+  fdsrc->adaptive_blocksize = DEFAULT_ADAPTIVE_BLOCKSIZE;
+  fdsrc->max_blocksize = DEFAULT_MAX_BLOCKSIZE;
+  fdsrc->cur_blocksize = 0;
   fdsrc->uri = g_strdup_printf ("fd://0");
   fdsrc->curoffset = 0;
 }
@@ -293,6 +353,7 @@ gst_fd_src_start (GstBaseSrc * bsrc)
   GstFdSrc *src = GST_FD_SRC (bsrc);
 
   src->curoffset = 0;
+  src->cur_blocksize = 0;
 
   if ((src->fdset = gst_poll_new (TRUE)) == NULL)
     goto socket_pair;
@@ -375,6 +436,15 @@ gst_fd_src_set_property (GObject * object, guint prop_id, const GValue * value,
       GST_DEBUG_OBJECT (src, "poll timeout set to %" GST_TIME_FORMAT,
           GST_TIME_ARGS (src->timeout));
       break;
+    case PROP_USE_BUFFER_ALLOC:
+      src->use_buffer_alloc = g_value_get_boolean (value);
+      break;
+    case PROP_ADAPTIVE_BLOCKSIZE:
+      src->adaptive_blocksize = g_value_get_boolean (value);
+      break;
+    case PROP_MAX_BLOCKSIZE:
+      src->max_blocksize = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -394,12 +464,43 @@ gst_fd_src_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_TIMEOUT:
       g_value_set_uint64 (value, src->timeout);
       break;
+    case PROP_USE_BUFFER_ALLOC:
+      g_value_set_boolean (value, src->use_buffer_alloc);
+      break;
+    case PROP_ADAPTIVE_BLOCKSIZE:
+      g_value_set_boolean (value, src->adaptive_blocksize);
+      break;
+    case PROP_MAX_BLOCKSIZE:
+      g_value_set_uint (value, src->max_blocksize);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
 }
 
+/* a full read means more data is probably waiting, so read more at once next
+ * time. When reads come back mostly empty, go back towards the configured
+ * blocksize to avoid allocating large buffers for little data. */
+static void
+gst_fd_src_adapt_blocksize (GstFdSrc * src, guint blocksize, gssize readbytes)
+{
+  guint min_blocksize = GST_BASE_SRC (src)->blocksize;
+  guint new_blocksize = blocksize;
+
+  if (readbytes == (gssize) blocksize) {
+    if (blocksize < src->max_blocksize)
+      new_blocksize = MIN (blocksize * 2, src->max_blocksize);
+  } else if (readbytes < (gssize) (blocksize / 4)) {
+    new_blocksize = MAX (blocksize / 2, min_blocksize);
+  }
+
+  if (new_blocksize != blocksize)
+    GST_LOG_OBJECT (src, "blocksize %u -> %u", blocksize, new_blocksize);
+
+  src->cur_blocksize = new_blocksize;
+}
+
 static GstFlowReturn
 gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -454,8 +555,30 @@ gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 
   blocksize = GST_BASE_SRC (src)->blocksize;
 
+  /* live sources keep the configured blocksize so that latency stays low */
+  if (src->adaptive_blocksize && !gst_base_src_is_live (GST_BASE_SRC (src)))
+    blocksize = MAX (blocksize, src->cur_blocksize);
+
   /* create the buffer */
-  buf = gst_buffer_try_new_and_alloc (blocksize);
+  if (src->use_buffer_alloc) {
+    GstPad *pad = GST_BASE_SRC_PAD (src);
+    GstFlowReturn ret;
+
+    ret = gst_pad_alloc_buffer (pad, src->curoffset, blocksize,
+        GST_PAD_CAPS (pad), &buf);
+    if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+      GST_DEBUG_OBJECT (src, "pad alloc returned %s", gst_flow_get_name (ret));
+      return ret;
+    }
+    if (G_UNLIKELY (GST_BUFFER_SIZE (buf) < blocksize)) {
+      GST_DEBUG_OBJECT (src, "downstream buffer too small, allocating");
+      gst_buffer_unref (buf);
+      buf = gst_buffer_try_new_and_alloc (blocksize);
+    }
+  } else {
+    buf = gst_buffer_try_new_and_alloc (blocksize);
+  }
+
   if (G_UNLIKELY (buf == NULL)) {
     GST_ERROR_OBJECT (src, "Failed to allocate %u bytes", blocksize);
     return GST_FLOW_ERROR;
@@ -472,6 +595,9 @@ gst_fd_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
   if (readbytes == 0)
     goto eos;
 
+  if (src->adaptive_blocksize)
+    gst_fd_src_adapt_blocksize (src, blocksize, readbytes);
+
   GST_BUFFER_OFFSET (buf) = src->curoffset;
   GST_BUFFER_SIZE (buf) = readbytes;
   GST_BUFFER_TIMESTAMP (buf) = GST_CLOCK_TIME_NONE;
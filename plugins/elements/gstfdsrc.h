@@ -66,6 +66,14 @@ struct _GstFdSrc {
   /* poll timeout */
   guint64 timeout;
 
+  /* read into buffers allocated by the peer */
+  gboolean use_buffer_alloc;
+
+  /* read size adaptation */
+  gboolean adaptive_blocksize;
+  guint max_blocksize;
+  guint cur_blocksize;
+
   gchar *uri;
 
   GstPoll *fdset;
@@ -25,6 +25,10 @@
  * @see_also: #GstFileSrc
  *
  * Write incoming data to a file in the local file system.
+ *
+ * Buffer lists that are larger than the stdio buffer are written with
+ * writev() where available, so that buffers in a group (for example a header
+ * and its payload) are not merged before writing.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -58,6 +62,15 @@
 #ifdef HAVE_UNISTD_H
 #include <unistd.h>
 #endif
+#ifdef HAVE_SYS_UIO_H
+#include <sys/uio.h>
+#endif
+
+#if defined (HAVE_WRITEV) && defined (HAVE_SYS_UIO_H)
+#define USE_WRITEV 1
+/* number of buffers written with one writev() call */
+#define MAX_VECS 64
+#endif
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -155,6 +168,10 @@ static gboolean gst_file_sink_stop (GstBaseSink * sink);
 static gboolean gst_file_sink_event (GstBaseSink * sink, GstEvent * event);
 static GstFlowReturn gst_file_sink_render (GstBaseSink * sink,
     GstBuffer * buffer);
+#ifdef USE_WRITEV
+static GstFlowReturn gst_file_sink_render_list (GstBaseSink * sink,
+    GstBufferList * list);
+#endif
 
 static gboolean gst_file_sink_do_seek (GstFileSink * filesink,
     guint64 new_offset);
@@ -240,6 +257,10 @@ gst_file_sink_class_init (GstFileSinkClass * klass)
   gstbasesink_class->start = GST_DEBUG_FUNCPTR (gst_file_sink_start);
   gstbasesink_class->stop = GST_DEBUG_FUNCPTR (gst_file_sink_stop);
   gstbasesink_class->render = GST_DEBUG_FUNCPTR (gst_file_sink_render);
+#ifdef USE_WRITEV
+  gstbasesink_class->render_list =
+      GST_DEBUG_FUNCPTR (gst_file_sink_render_list);
+#endif
   gstbasesink_class->event = GST_DEBUG_FUNCPTR (gst_file_sink_event);
 
   if (sizeof (off_t) < 8) {
@@ -668,6 +689,132 @@ handle_error:
   }
 }
 
+#ifdef USE_WRITEV
+/* writes all vectors, returns FALSE with errno set on errors */
+static gboolean
+gst_file_sink_writev (GstFileSink * filesink, struct iovec *vecs,
+    gint n_vecs, guint size)
+{
+  gssize written;
+
+  GST_DEBUG_OBJECT (filesink, "writing %u bytes in %d vectors at %"
+      G_GUINT64_FORMAT, size, n_vecs, filesink->current_pos);
+
+  while (size > 0) {
+    written = writev (fileno (filesink->file), vecs, n_vecs);
+    if (G_UNLIKELY (written < 0)) {
+      if (errno == EINTR || errno == EAGAIN)
+        continue;
+      return FALSE;
+    }
+
+    size -= written;
+    filesink->current_pos += written;
+
+    /* skip the vectors that were written completely */
+    while (size > 0 && written >= (gssize) vecs->iov_len) {
+      written -= vecs->iov_len;
+      vecs++;
+      n_vecs--;
+    }
+    if (size > 0) {
+      vecs->iov_base = (guint8 *) vecs->iov_base + written;
+      vecs->iov_len -= written;
+    }
+  }
+  return TRUE;
+}
+
+static GstFlowReturn
+gst_file_sink_render_list (GstBaseSink * sink, GstBufferList * list)
+{
+  GstFileSink *filesink;
+  GstBufferListIterator *it;
+  GstBuffer *buffer;
+  struct iovec vecs[MAX_VECS];
+  gint n_vecs = 0;
+  guint size = 0, total = 0, threshold;
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  filesink = GST_FILE_SINK (sink);
+
+  it = gst_buffer_list_iterate (list);
+  while (gst_buffer_list_iterator_next_group (it)) {
+    while ((buffer = gst_buffer_list_iterator_next (it)))
+      total += GST_BUFFER_SIZE (buffer);
+  }
+  gst_buffer_list_iterator_free (it);
+  it = NULL;
+
+  /* lists that fit into the stdio buffer are cheaper to collect there */
+  if (filesink->buffer_mode == _IONBF)
+    threshold = 0;
+  else if (filesink->buffer_mode == -1)
+    threshold = BUFSIZ;
+  else
+    threshold = filesink->buffer_size;
+
+  if (total < threshold) {
+    it = gst_buffer_list_iterate (list);
+    while (ret == GST_FLOW_OK && gst_buffer_list_iterator_next_group (it)) {
+      while (ret == GST_FLOW_OK &&
+          (buffer = gst_buffer_list_iterator_next (it)))
+        ret = gst_file_sink_render (sink, buffer);
+    }
+    gst_buffer_list_iterator_free (it);
+    return ret;
+  }
+
+  /* everything written through the FILE must reach the file first */
+  if (fflush (filesink->file))
+    goto handle_error;
+
+  it = gst_buffer_list_iterate (list);
+  while (gst_buffer_list_iterator_next_group (it)) {
+    while ((buffer = gst_buffer_list_iterator_next (it))) {
+      if (GST_BUFFER_SIZE (buffer) == 0 || GST_BUFFER_DATA (buffer) == NULL)
+        continue;
+
+      if (n_vecs == MAX_VECS) {
+        if (!gst_file_sink_writev (filesink, vecs, n_vecs, size))
+          goto handle_error;
+        n_vecs = 0;
+        size = 0;
+      }
+      vecs[n_vecs].iov_base = GST_BUFFER_DATA (buffer);
+      vecs[n_vecs].iov_len = GST_BUFFER_SIZE (buffer);
+      size += GST_BUFFER_SIZE (buffer);
+      n_vecs++;
+    }
+  }
+  gst_buffer_list_iterator_free (it);
+  it = NULL;
+
+  if (n_vecs > 0 && !gst_file_sink_writev (filesink, vecs, n_vecs, size))
+    goto handle_error;
+
+  return GST_FLOW_OK;
+
+handle_error:
+  {
+    switch (errno) {
+      case ENOSPC:{
+        GST_ELEMENT_ERROR (filesink, RESOURCE, NO_SPACE_LEFT, (NULL), (NULL));
+        break;
+      }
+      default:{
+        GST_ELEMENT_ERROR (filesink, RESOURCE, WRITE,
+            (_("Error while writing to file \"%s\"."), filesink->filename),
+            ("%s", g_strerror (errno)));
+      }
+    }
+    if (it)
+      gst_buffer_list_iterator_free (it);
+    return GST_FLOW_ERROR;
+  }
+}
+#endif
+
 static gboolean
 gst_file_sink_start (GstBaseSink * basesink)
 {
@@ -111,6 +111,8 @@ static GstFlowReturn gst_identity_prepare_output_buffer (GstBaseTransform
     GstBuffer ** out_buf);
 static gboolean gst_identity_start (GstBaseTransform * trans);
 static gboolean gst_identity_stop (GstBaseTransform * trans);
+static GstStateChangeReturn gst_identity_change_state (GstElement * element,
+    GstStateChange transition);
 
 static guint gst_identity_signals[LAST_SIGNAL] = { 0 };
 
@@ -138,6 +140,7 @@ gst_identity_finalize (GObject * object)
 
   g_free (identity->last_message);
   g_static_rec_mutex_free (&identity->notify_lock);
+  g_cond_free (identity->sleep_cond);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -174,9 +177,11 @@ static void
 gst_identity_class_init (GstIdentityClass * klass)
 {
   GObjectClass *gobject_class;
+  GstElementClass *gstelement_class;
   GstBaseTransformClass *gstbasetrans_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
+  gstelement_class = GST_ELEMENT_CLASS (klass);
   gstbasetrans_class = GST_BASE_TRANSFORM_CLASS (klass);
 
   gobject_class->set_property = gst_identity_set_property;
@@ -265,6 +270,9 @@ gst_identity_class_init (GstIdentityClass * klass)
 
   gobject_class->finalize = gst_identity_finalize;
 
+  gstelement_class->change_state =
+      GST_DEBUG_FUNCPTR (gst_identity_change_state);
+
   gstbasetrans_class->event = GST_DEBUG_FUNCPTR (gst_identity_event);
   gstbasetrans_class->transform_ip =
       GST_DEBUG_FUNCPTR (gst_identity_transform_ip);
@@ -291,6 +299,28 @@ gst_identity_init (GstIdentity * identity, GstIdentityClass * g_class)
   identity->last_message = NULL;
   identity->signal_handoffs = DEFAULT_SIGNAL_HANDOFFS;
   g_static_rec_mutex_init (&identity->notify_lock);
+  identity->sleep_cond = g_cond_new ();
+}
+
+/* interrupt a clock wait or sleep in the streaming thread and make it return
+ * WRONG_STATE until gst_identity_unlock_stop() is called */
+static void
+gst_identity_unlock (GstIdentity * identity)
+{
+  GST_OBJECT_LOCK (identity);
+  identity->flushing = TRUE;
+  if (identity->clock_id)
+    gst_clock_id_unschedule (identity->clock_id);
+  g_cond_broadcast (identity->sleep_cond);
+  GST_OBJECT_UNLOCK (identity);
+}
+
+static void
+gst_identity_unlock_stop (GstIdentity * identity)
+{
+  GST_OBJECT_LOCK (identity);
+  identity->flushing = FALSE;
+  GST_OBJECT_UNLOCK (identity);
 }
 
 static void
@@ -360,6 +390,17 @@ gst_identity_event (GstBaseTransform * trans, GstEvent * event)
     identity->prev_offset = identity->prev_offset_end = GST_BUFFER_OFFSET_NONE;
   }
 
+  switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_FLUSH_START:
+      gst_identity_unlock (identity);
+      break;
+    case GST_EVENT_FLUSH_STOP:
+      gst_identity_unlock_stop (identity);
+      break;
+    default:
+      break;
+  }
+
   ret = parent_class->event (trans, event);
 
   if (identity->single_segment
@@ -624,14 +665,15 @@ gst_identity_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
     GstClock *clock;
 
     GST_OBJECT_LOCK (identity);
-    if ((clock = GST_ELEMENT (identity)->clock)) {
+    if (identity->flushing) {
+      ret = GST_FLOW_WRONG_STATE;
+    } else if ((clock = GST_ELEMENT (identity)->clock)) {
       GstClockReturn cret;
       GstClockTime timestamp;
 
       timestamp = runtimestamp + GST_ELEMENT (identity)->base_time;
 
       /* save id if we need to unlock */
-      /* FIXME: actually unlock this somewhere in the state changes */
       identity->clock_id = gst_clock_new_single_shot_id (clock, timestamp);
       GST_OBJECT_UNLOCK (identity);
 
@@ -643,15 +685,27 @@ gst_identity_transform_ip (GstBaseTransform * trans, GstBuffer * buf)
         identity->clock_id = NULL;
       }
       if (cret == GST_CLOCK_UNSCHEDULED)
-        ret = GST_FLOW_UNEXPECTED;
+        ret = identity->flushing ? GST_FLOW_WRONG_STATE : GST_FLOW_UNEXPECTED;
     }
     GST_OBJECT_UNLOCK (identity);
   }
 
   identity->offset += GST_BUFFER_SIZE (buf);
 
-  if (identity->sleep_time && ret == GST_FLOW_OK)
-    g_usleep (identity->sleep_time);
+  if (identity->sleep_time && ret == GST_FLOW_OK) {
+    GTimeVal deadline;
+
+    /* sleep on the cond so that a flush can wake us up early */
+    g_get_current_time (&deadline);
+    g_time_val_add (&deadline, identity->sleep_time);
+
+    GST_OBJECT_LOCK (identity);
+    while (!identity->flushing && g_cond_timed_wait (identity->sleep_cond,
+            GST_OBJECT_GET_LOCK (identity), &deadline));
+    if (identity->flushing)
+      ret = GST_FLOW_WRONG_STATE;
+    GST_OBJECT_UNLOCK (identity);
+  }
 
   if (identity->single_segment && (trans->segment.format == GST_FORMAT_TIME)
       && (ret == GST_FLOW_OK)) {
@@ -800,3 +854,27 @@ gst_identity_stop (GstBaseTransform * trans)
 
   return TRUE;
 }
+
+static GstStateChangeReturn
+gst_identity_change_state (GstElement * element, GstStateChange transition)
+{
+  GstIdentity *identity = GST_IDENTITY (element);
+  GstStateChangeReturn ret;
+
+  switch (transition) {
+    case GST_STATE_CHANGE_READY_TO_PAUSED:
+      gst_identity_unlock_stop (identity);
+      break;
+    case GST_STATE_CHANGE_PAUSED_TO_READY:
+      /* wake up the streaming thread before the pads are deactivated, which
+       * needs to take the stream lock */
+      gst_identity_unlock (identity);
+      break;
+    default:
+      break;
+  }
+
+  ret = GST_ELEMENT_CLASS (parent_class)->change_state (element, transition);
+
+  return ret;
+}
@@ -74,6 +74,10 @@ struct _GstIdentity {
   guint64        offset;
   gboolean       signal_handoffs;
   GStaticRecMutex  notify_lock;
+
+  /* protected with the object lock */
+  gboolean       flushing;
+  GCond         *sleep_cond;
 };
 
 struct _GstIdentityClass {
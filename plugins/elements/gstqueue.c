@@ -53,6 +53,16 @@
  * the specified minimum thresholds require (by default: when the queue is
  * empty). The #GstQueue::overrun signal is emitted when the queue is filled
  * up. Both signals are emitted from the context of the streaming thread.
+ *
+ * When the GST_QUEUE_MEMORY_LIMIT environment variable is set to a number of
+ * bytes, all queues in the process share that budget on top of their own
+ * limits. When the total amount of buffered data exceeds the budget, the
+ * queue holding the most data among those with the lowest
+ * #GstQueue:memory-priority is considered filled until enough data was
+ * drained. No queue is throttled while another one is waiting for data. A
+ * queue can be asked for
+ * its usage with a #GST_QUERY_CUSTOM query containing an empty structure
+ * named "GstQueueMemoryUsage".
  */
 
 #include "gst/gst_private.h"
@@ -91,7 +101,23 @@ GST_DEBUG_CATEGORY_STATIC (queue_dataflow);
                       queue->cur_level.time, \
                       queue->min_threshold.time, \
                       queue->max_size.time, \
-                      queue->queue->length)
+                      queue->items_len)
+
+/* an item in the queue together with the running time of the sink position
+ * after the item was enqueued. When the item is dequeued, that running time
+ * is the new src position, so the src side never needs segment math. The
+ * items are stored by value in a ring that only grows, so queueing does not
+ * allocate once the queue has seen its maximum fill level. */
+struct _GstQueueItem
+{
+  GstMiniObject *item;
+  GstClockTime running_time;
+};
+
+#define QUEUE_ITEMS_MIN_SIZE 16
+
+/* the @n-th item from the head of the ring */
+#define QUEUE_ITEM(q,n) (&(q)->items[((q)->items_head + (n)) % (q)->items_size])
 
 /* Queue signals and args */
 enum
@@ -117,7 +143,8 @@ enum
   ARG_MIN_THRESHOLD_BUFFERS,
   ARG_MIN_THRESHOLD_BYTES,
   ARG_MIN_THRESHOLD_TIME,
-  ARG_LEAKY
+  ARG_LEAKY,
+  ARG_MEMORY_PRIORITY
       /* FILL ME */
 };
 
@@ -125,6 +152,10 @@ enum
 #define DEFAULT_MAX_SIZE_BUFFERS  200   /* 200 buffers */
 #define DEFAULT_MAX_SIZE_BYTES    (10 * 1024 * 1024)    /* 10 MB       */
 #define DEFAULT_MAX_SIZE_TIME     GST_SECOND    /* 1 second    */
+#define DEFAULT_MEMORY_PRIORITY   0
+
+/* how often a queue throttled by the memory budget rechecks it */
+#define GOVERNOR_POLL_INTERVAL    (50 * GST_MSECOND)
 
 #define GST_QUEUE_MUTEX_LOCK(q) G_STMT_START {                          \
   g_mutex_lock (q->qlock);                                              \
@@ -150,6 +181,20 @@ enum
   STATUS (q, q->sinkpad, "received DEL");                               \
 } G_STMT_END
 
+/* wait for a DEL or until the memory budget might have changed, other
+ * queues do not signal us when they drain */
+#define GST_QUEUE_TIMED_WAIT_DEL_CHECK(q, label) G_STMT_START {         \
+  GTimeVal _tv;                                                         \
+  STATUS (q, q->sinkpad, "wait for DEL or budget");                     \
+  g_get_current_time (&_tv);                                            \
+  g_time_val_add (&_tv, GOVERNOR_POLL_INTERVAL / GST_USECOND);          \
+  g_cond_timed_wait (q->item_del, q->qlock, &_tv);                      \
+  if (q->srcresult != GST_FLOW_OK) {                                    \
+    STATUS (q, q->srcpad, "received DEL wakeup");                       \
+    goto label;                                                         \
+  }                                                                     \
+} G_STMT_END
+
 #define GST_QUEUE_WAIT_ADD_CHECK(q, label) G_STMT_START {               \
   STATUS (q, q->srcpad, "wait for ADD");                                \
   g_cond_wait (q->item_add, q->qlock);                                  \
@@ -168,6 +213,8 @@ enum
 #define GST_QUEUE_SIGNAL_ADD(q) G_STMT_START {                          \
   STATUS (q, q->sinkpad, "signal ADD");                                 \
   g_cond_signal (q->item_add);                                          \
+  if (G_UNLIKELY (q->task_suspended))                                   \
+    gst_queue_resume_task (q);                                          \
 } G_STMT_END
 
 #define _do_init(bla) \
@@ -208,6 +255,8 @@ static gboolean gst_queue_sink_activate_push (GstPad * pad, gboolean active);
 static gboolean gst_queue_is_empty (GstQueue * queue);
 static gboolean gst_queue_is_filled (GstQueue * queue);
 
+static void gst_queue_resume_task (GstQueue * queue);
+
 #define GST_TYPE_QUEUE_LEAKY (queue_leaky_get_type ())
 
 static GType
@@ -351,6 +400,22 @@ gst_queue_class_init (GstQueueClass * klass)
           GST_TYPE_QUEUE_LEAKY, GST_QUEUE_NO_LEAK,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstQueue:memory-priority
+   *
+   * Priority of the data in this queue when the process-wide memory budget
+   * set with GST_QUEUE_MEMORY_LIMIT is exceeded. Queues with a lower priority
+   * are throttled first.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, ARG_MEMORY_PRIORITY,
+      g_param_spec_int ("memory-priority", "Memory priority",
+          "Priority of the queue when the process-wide memory budget is "
+          "exceeded, lower priorities are throttled first",
+          G_MININT, G_MAXINT, DEFAULT_MEMORY_PRIORITY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gobject_class->finalize = gst_queue_finalize;
 
   /* Registering debug symbols for function pointers */
@@ -400,7 +465,6 @@ gst_queue_init (GstQueue * queue, GstQueueClass * g_class)
   GST_QUEUE_CLEAR_LEVEL (queue->min_threshold);
   GST_QUEUE_CLEAR_LEVEL (queue->orig_min_threshold);
   gst_segment_init (&queue->sink_segment, GST_FORMAT_TIME);
-  gst_segment_init (&queue->src_segment, GST_FORMAT_TIME);
   queue->head_needs_discont = queue->tail_needs_discont = FALSE;
 
   queue->leaky = GST_QUEUE_NO_LEAK;
@@ -409,13 +473,18 @@ gst_queue_init (GstQueue * queue, GstQueueClass * g_class)
   queue->qlock = g_mutex_new ();
   queue->item_add = g_cond_new ();
   queue->item_del = g_cond_new ();
-  queue->queue = g_queue_new ();
+  queue->items = NULL;
+  queue->items_size = queue->items_head = queue->items_len = 0;
+
+  queue->sinktime = 0;
+  queue->srctime = 0;
 
-  queue->sinktime = GST_CLOCK_TIME_NONE;
-  queue->srctime = GST_CLOCK_TIME_NONE;
+  queue->task_suspended = FALSE;
+  queue->underrun = FALSE;
 
-  queue->sink_tainted = TRUE;
-  queue->src_tainted = TRUE;
+  queue->memory_priority = DEFAULT_MEMORY_PRIORITY;
+  queue->governor = gst_queue_governor_register (GST_ELEMENT_CAST (queue),
+      queue->memory_priority);
 
   GST_DEBUG_OBJECT (queue,
       "initialized queue's not_empty & not_full conditions");
@@ -429,12 +498,13 @@ gst_queue_finalize (GObject * object)
 
   GST_DEBUG_OBJECT (queue, "finalizing queue");
 
-  while (!g_queue_is_empty (queue->queue)) {
-    GstMiniObject *data = g_queue_pop_head (queue->queue);
-
-    gst_mini_object_unref (data);
+  while (queue->items_len > 0) {
+    gst_mini_object_unref (QUEUE_ITEM (queue, 0)->item);
+    queue->items_head = (queue->items_head + 1) % queue->items_size;
+    queue->items_len--;
   }
-  g_queue_free (queue->queue);
+  g_free (queue->items);
+  gst_queue_governor_unregister (queue->governor);
   g_mutex_free (queue->qlock);
   g_cond_free (queue->item_add);
   g_cond_free (queue->item_del);
@@ -527,25 +597,12 @@ gst_queue_bufferalloc (GstPad * pad, guint64 offset, guint size, GstCaps * caps,
 
 /* calculate the diff between running time on the sink and src of the queue.
  * This is the total amount of time in the queue. */
-static void
+static inline void
 update_time_level (GstQueue * queue)
 {
   gint64 sink_time, src_time;
 
-  if (queue->sink_tainted) {
-    queue->sinktime =
-        gst_segment_to_running_time (&queue->sink_segment, GST_FORMAT_TIME,
-        queue->sink_segment.last_stop);
-    queue->sink_tainted = FALSE;
-  }
   sink_time = queue->sinktime;
-
-  if (queue->src_tainted) {
-    queue->srctime =
-        gst_segment_to_running_time (&queue->src_segment, GST_FORMAT_TIME,
-        queue->src_segment.last_stop);
-    queue->src_tainted = FALSE;
-  }
   src_time = queue->srctime;
 
   GST_LOG_OBJECT (queue, "sink %" GST_TIME_FORMAT ", src %" GST_TIME_FORMAT,
@@ -557,12 +614,12 @@ update_time_level (GstQueue * queue)
     queue->cur_level.time = 0;
 }
 
-/* take a NEWSEGMENT event and apply the values to segment, updating the time
- * level of queue. */
+/* take a NEWSEGMENT event and apply the values to the sink segment, updating
+ * the sink running time. */
 static void
-apply_segment (GstQueue * queue, GstEvent * event, GstSegment * segment,
-    gboolean sink)
+apply_segment (GstQueue * queue, GstEvent * event)
 {
+  GstSegment *segment = &queue->sink_segment;
   gboolean update;
   GstFormat format;
   gdouble rate, arate;
@@ -585,23 +642,22 @@ apply_segment (GstQueue * queue, GstEvent * event, GstSegment * segment,
   gst_segment_set_newsegment_full (segment, update,
       rate, arate, format, start, stop, time);
 
-  if (sink)
-    queue->sink_tainted = TRUE;
-  else
-    queue->src_tainted = TRUE;
-
   GST_DEBUG_OBJECT (queue,
       "configured NEWSEGMENT %" GST_SEGMENT_FORMAT, segment);
 
+  queue->sinktime = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+      segment->last_stop);
+
   /* segment can update the time level of the queue */
   update_time_level (queue);
 }
 
-/* take a buffer and update segment, updating the time level of the queue. */
+/* take a buffer and update the sink segment, updating the sink running
+ * time. */
 static void
-apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
-    gboolean with_duration, gboolean sink)
+apply_buffer (GstQueue * queue, GstBuffer * buffer)
 {
+  GstSegment *segment = &queue->sink_segment;
   GstClockTime duration, timestamp;
 
   timestamp = GST_BUFFER_TIMESTAMP (buffer);
@@ -613,18 +669,15 @@ apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
     timestamp = segment->last_stop;
 
   /* add duration */
-  if (with_duration && duration != GST_CLOCK_TIME_NONE)
+  if (duration != GST_CLOCK_TIME_NONE)
     timestamp += duration;
 
   GST_LOG_OBJECT (queue, "last_stop updated to %" GST_TIME_FORMAT,
       GST_TIME_ARGS (timestamp));
 
   gst_segment_set_last_stop (segment, GST_FORMAT_TIME, timestamp);
-  if (sink)
-    queue->sink_tainted = TRUE;
-  else
-    queue->src_tainted = TRUE;
-
+  queue->sinktime = gst_segment_to_running_time (segment, GST_FORMAT_TIME,
+      timestamp);
 
   /* calc diff with other end */
   update_time_level (queue);
@@ -633,28 +686,55 @@ apply_buffer (GstQueue * queue, GstBuffer * buffer, GstSegment * segment,
 static void
 gst_queue_locked_flush (GstQueue * queue)
 {
-  while (!g_queue_is_empty (queue->queue)) {
-    GstMiniObject *data = g_queue_pop_head (queue->queue);
-
+  while (queue->items_len > 0) {
     /* Then lose another reference because we are supposed to destroy that
        data when flushing */
-    gst_mini_object_unref (data);
+    gst_mini_object_unref (QUEUE_ITEM (queue, 0)->item);
+    queue->items_head = (queue->items_head + 1) % queue->items_size;
+    queue->items_len--;
   }
+  queue->items_head = 0;
   GST_QUEUE_CLEAR_LEVEL (queue->cur_level);
+  gst_queue_governor_update (queue->governor, 0);
   queue->min_threshold.buffers = queue->orig_min_threshold.buffers;
   queue->min_threshold.bytes = queue->orig_min_threshold.bytes;
   queue->min_threshold.time = queue->orig_min_threshold.time;
   gst_segment_init (&queue->sink_segment, GST_FORMAT_TIME);
-  gst_segment_init (&queue->src_segment, GST_FORMAT_TIME);
   queue->head_needs_discont = queue->tail_needs_discont = FALSE;
+  queue->underrun = FALSE;
+  gst_queue_governor_set_starving (queue->governor, FALSE);
 
-  queue->sinktime = queue->srctime = GST_CLOCK_TIME_NONE;
-  queue->sink_tainted = queue->src_tainted = TRUE;
+  queue->sinktime = queue->srctime = 0;
 
   /* we deleted a lot of something */
   GST_QUEUE_SIGNAL_DEL (queue);
 }
 
+static inline void
+gst_queue_locked_push_tail (GstQueue * queue, gpointer item)
+{
+  GstQueueItem *qitem;
+
+  if (G_UNLIKELY (queue->items_len == queue->items_size)) {
+    guint size = MAX (queue->items_size * 2, QUEUE_ITEMS_MIN_SIZE);
+
+    queue->items = g_renew (GstQueueItem, queue->items, size);
+    /* move the items that wrapped around to the start behind the old end */
+    if (queue->items_head + queue->items_len > queue->items_size)
+      memcpy (queue->items + queue->items_size, queue->items,
+          (queue->items_head + queue->items_len - queue->items_size) *
+          sizeof (GstQueueItem));
+    queue->items_size = size;
+  }
+
+  qitem = QUEUE_ITEM (queue, queue->items_len);
+  qitem->item = item;
+  qitem->running_time = queue->sinktime;
+  queue->items_len++;
+
+  GST_QUEUE_SIGNAL_ADD (queue);
+}
+
 /* enqueue an item an update the level stats, with QUEUE_LOCK */
 static inline void
 gst_queue_locked_enqueue_buffer (GstQueue * queue, gpointer item)
@@ -664,19 +744,14 @@ gst_queue_locked_enqueue_buffer (GstQueue * queue, gpointer item)
   /* add buffer to the statistics */
   queue->cur_level.buffers++;
   queue->cur_level.bytes += GST_BUFFER_SIZE (buffer);
-  apply_buffer (queue, buffer, &queue->sink_segment, TRUE, TRUE);
-
-  /* if this is the first buffer update the end side as well, but without the
-   * duration. */
-  /* FIXME : This will only be useful for current time level if the
-   * source task is running, which is not the case for ex in
-   * gstplaybasebin when pre-rolling.
-   * See #482147 */
-  /*     if (queue->cur_level.buffers == 1) */
-  /*       apply_buffer (queue, buffer, &queue->src_segment, FALSE); */
-
-  g_queue_push_tail (queue->queue, item);
-  GST_QUEUE_SIGNAL_ADD (queue);
+  gst_queue_governor_update (queue->governor, queue->cur_level.bytes);
+  apply_buffer (queue, buffer);
+
+  /* FIXME : The time level will only be useful if the source task is
+   * running, which is not the case for ex in gstplaybasebin when
+   * pre-rolling. See #482147 */
+
+  gst_queue_locked_push_tail (queue, item);
 }
 
 static inline void
@@ -694,7 +769,7 @@ gst_queue_locked_enqueue_event (GstQueue * queue, gpointer item)
       queue->eos = TRUE;
       break;
     case GST_EVENT_NEWSEGMENT:
-      apply_segment (queue, event, &queue->sink_segment, TRUE);
+      apply_segment (queue, event);
       /* a new segment allows us to accept more buffers if we got UNEXPECTED
        * from downstream */
       queue->unexpected = FALSE;
@@ -703,19 +778,27 @@ gst_queue_locked_enqueue_event (GstQueue * queue, gpointer item)
       break;
   }
 
-  g_queue_push_tail (queue->queue, item);
-  GST_QUEUE_SIGNAL_ADD (queue);
+  gst_queue_locked_push_tail (queue, item);
 }
 
-/* dequeue an item from the queue and update level stats, with QUEUE_LOCK */
+/* remove the head item from the queue and update the level stats, with
+ * QUEUE_LOCK. Does not signal the removal. */
 static GstMiniObject *
-gst_queue_locked_dequeue (GstQueue * queue, gboolean * is_buffer)
+gst_queue_locked_pop_head (GstQueue * queue, gboolean * is_buffer)
 {
+  GstQueueItem *qitem;
   GstMiniObject *item;
 
-  item = g_queue_pop_head (queue->queue);
-  if (item == NULL)
-    goto no_item;
+  if (queue->items_len == 0)
+    return NULL;
+
+  qitem = QUEUE_ITEM (queue, 0);
+  queue->items_head = (queue->items_head + 1) % queue->items_size;
+  queue->items_len--;
+
+  item = qitem->item;
+  /* the src side is now where the sink side was when this item arrived */
+  queue->srctime = qitem->running_time;
 
   if (GST_IS_BUFFER (item)) {
     GstBuffer *buffer = GST_BUFFER_CAST (item);
@@ -725,11 +808,13 @@ gst_queue_locked_dequeue (GstQueue * queue, gboolean * is_buffer)
 
     queue->cur_level.buffers--;
     queue->cur_level.bytes -= GST_BUFFER_SIZE (buffer);
-    apply_buffer (queue, buffer, &queue->src_segment, TRUE, FALSE);
+    gst_queue_governor_update (queue->governor, queue->cur_level.bytes);
 
     /* if the queue is empty now, update the other side */
     if (queue->cur_level.buffers == 0)
       queue->cur_level.time = 0;
+    else
+      update_time_level (queue);
 
     *is_buffer = TRUE;
   } else if (GST_IS_EVENT (item)) {
@@ -744,7 +829,7 @@ gst_queue_locked_dequeue (GstQueue * queue, gboolean * is_buffer)
         GST_QUEUE_CLEAR_LEVEL (queue->cur_level);
         break;
       case GST_EVENT_NEWSEGMENT:
-        apply_segment (queue, event, &queue->src_segment, FALSE);
+        update_time_level (queue);
         break;
       default:
         break;
@@ -757,6 +842,20 @@ gst_queue_locked_dequeue (GstQueue * queue, gboolean * is_buffer)
         item, GST_OBJECT_NAME (queue));
     item = NULL;
   }
+
+  return item;
+}
+
+/* dequeue an item from the queue and update level stats, with QUEUE_LOCK */
+static GstMiniObject *
+gst_queue_locked_dequeue (GstQueue * queue, gboolean * is_buffer)
+{
+  GstMiniObject *item;
+
+  if (queue->items_len == 0)
+    goto no_item;
+
+  item = gst_queue_locked_pop_head (queue, is_buffer);
   GST_QUEUE_SIGNAL_DEL (queue);
 
   return item;
@@ -858,7 +957,7 @@ out_eos:
 static gboolean
 gst_queue_is_empty (GstQueue * queue)
 {
-  if (queue->queue->length == 0)
+  if (queue->items_len == 0)
     return TRUE;
 
   /* It is possible that a max size is reached before all min thresholds are.
@@ -872,37 +971,82 @@ gst_queue_is_empty (GstQueue * queue)
       !gst_queue_is_filled (queue);
 }
 
+static inline gboolean
+gst_queue_level_is_filled (GstQueue * queue, GstQueueSize * level)
+{
+  return ((queue->max_size.buffers > 0 &&
+          level->buffers >= queue->max_size.buffers) ||
+      (queue->max_size.bytes > 0 &&
+          level->bytes >= queue->max_size.bytes) ||
+      (queue->max_size.time > 0 && level->time >= queue->max_size.time));
+}
+
 static gboolean
 gst_queue_is_filled (GstQueue * queue)
 {
-  return (((queue->max_size.buffers > 0 &&
-              queue->cur_level.buffers >= queue->max_size.buffers) ||
-          (queue->max_size.bytes > 0 &&
-              queue->cur_level.bytes >= queue->max_size.bytes) ||
-          (queue->max_size.time > 0 &&
-              queue->cur_level.time >= queue->max_size.time)));
+  return gst_queue_level_is_filled (queue, &queue->cur_level) ||
+      gst_queue_governor_is_throttled (queue->governor);
 }
 
 static void
 gst_queue_leak_downstream (GstQueue * queue)
 {
-  /* for as long as the queue is filled, dequeue an item and discard it */
-  while (gst_queue_is_filled (queue)) {
-    GstMiniObject *leak;
-    gboolean is_buffer;
+  GstQueueSize level = queue->cur_level;
+  GstClockTime srctime = queue->srctime;
+  GstQueueItem *qitem;
+  guint n_items = 0, pos, leaked = 0, i;
+
+  /* find out how many items have to go before the queue is no longer filled.
+   * The time level after dropping an item follows from the running time
+   * stored with it, so a whole time budget is measured without touching the
+   * items. */
+  while (n_items < queue->items_len &&
+      (gst_queue_level_is_filled (queue, &level) ||
+          gst_queue_governor_is_throttled (queue->governor))) {
+    qitem = QUEUE_ITEM (queue, n_items);
+    if (GST_IS_BUFFER (qitem->item)) {
+      level.buffers--;
+      level.bytes -= GST_BUFFER_SIZE (qitem->item);
+      gst_queue_governor_update (queue->governor, level.bytes);
+    }
+    srctime = qitem->running_time;
+    if (level.buffers == 0 || srctime >= queue->sinktime)
+      level.time = 0;
+    else
+      level.time = queue->sinktime - srctime;
+    n_items++;
+  }
 
-    leak = gst_queue_locked_dequeue (queue, &is_buffer);
-    /* there is nothing to dequeue and the queue is still filled.. This should
-     * not happen */
-    g_assert (leak != NULL);
+  if (n_items == 0)
+    return;
 
-    GST_CAT_DEBUG_OBJECT (queue_dataflow, queue,
-        "queue is full, leaking item %p on downstream end", leak);
-    gst_mini_object_unref (leak);
+  /* drop the buffers in one go. Events are kept in their order in front of
+   * the remaining items, they now start where the src position will be. */
+  pos = n_items;
+  for (i = n_items; i > 0; i--) {
+    qitem = QUEUE_ITEM (queue, i - 1);
+    if (GST_IS_BUFFER (qitem->item)) {
+      gst_mini_object_unref (qitem->item);
+      leaked++;
+    } else {
+      pos--;
+      qitem->running_time = srctime;
+      *QUEUE_ITEM (queue, pos) = *qitem;
+    }
+  }
+  queue->items_head = (queue->items_head + pos) % queue->items_size;
+  queue->items_len -= pos;
 
-    /* last buffer needs to get a DISCONT flag */
+  queue->cur_level = level;
+  queue->srctime = srctime;
+
+  GST_CAT_DEBUG_OBJECT (queue_dataflow, queue,
+      "queue is full, leaked %u buffers on downstream end", leaked);
+
+  /* last buffer needs to get a DISCONT flag */
+  if (leaked > 0)
     queue->head_needs_discont = TRUE;
-  }
+  GST_QUEUE_SIGNAL_DEL (queue);
 }
 
 static GstFlowReturn
@@ -965,7 +1109,10 @@ gst_queue_chain (GstPad * pad, GstBuffer * buffer)
         /* don't leak. Instead, wait for space to be available */
         do {
           /* for as long as the queue is filled, wait till an item was deleted. */
-          GST_QUEUE_WAIT_DEL_CHECK (queue, out_flushing);
+          if (gst_queue_governor_is_throttled (queue->governor))
+            GST_QUEUE_TIMED_WAIT_DEL_CHECK (queue, out_flushing);
+          else
+            GST_QUEUE_WAIT_DEL_CHECK (queue, out_flushing);
         } while (gst_queue_is_filled (queue));
 
         GST_CAT_DEBUG_OBJECT (queue_dataflow, queue, "queue is not full");
@@ -1152,6 +1299,49 @@ out_flushing:
   }
 }
 
+/* with QUEUE_LOCK, from the src task. Returns TRUE when the task will give up
+ * its thread instead of waiting for data */
+static gboolean
+gst_queue_suspend_task (GstQueue * queue)
+{
+  GstTask *task;
+  gboolean res = FALSE;
+
+  GST_OBJECT_LOCK (queue->srcpad);
+  if ((task = GST_PAD_TASK (queue->srcpad)))
+    res = gst_task_suspend (task);
+  GST_OBJECT_UNLOCK (queue->srcpad);
+
+  if (res) {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue, "suspending task");
+    queue->task_suspended = TRUE;
+  }
+  return res;
+}
+
+/* with QUEUE_LOCK, data was added or the thresholds changed. Resuming does not
+ * wait for the thread the task gave up, the thread callbacks of a task resumed
+ * in another thread are called from that thread before it takes the
+ * QUEUE_LOCK. */
+static void
+gst_queue_resume_task (GstQueue * queue)
+{
+  GstTask *task;
+
+  queue->task_suspended = FALSE;
+
+  GST_OBJECT_LOCK (queue->srcpad);
+  if ((task = GST_PAD_TASK (queue->srcpad)))
+    gst_object_ref (task);
+  GST_OBJECT_UNLOCK (queue->srcpad);
+
+  if (task) {
+    GST_CAT_LOG_OBJECT (queue_dataflow, queue, "resuming task");
+    gst_task_resume (task);
+    gst_object_unref (task);
+  }
+}
+
 static void
 gst_queue_loop (GstPad * pad)
 {
@@ -1163,16 +1353,26 @@ gst_queue_loop (GstPad * pad)
   /* have to lock for thread-safety */
   GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
 
-  while (gst_queue_is_empty (queue)) {
-    GST_QUEUE_MUTEX_UNLOCK (queue);
-    g_signal_emit (queue, gst_queue_signals[SIGNAL_UNDERRUN], 0);
-    GST_CAT_DEBUG_OBJECT (queue_dataflow, queue, "queue is empty");
-    GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
+  while (queue->underrun || gst_queue_is_empty (queue)) {
+    if (!queue->underrun) {
+      queue->underrun = TRUE;
+      gst_queue_governor_set_starving (queue->governor, TRUE);
+      GST_QUEUE_MUTEX_UNLOCK (queue);
+      g_signal_emit (queue, gst_queue_signals[SIGNAL_UNDERRUN], 0);
+      GST_CAT_DEBUG_OBJECT (queue_dataflow, queue, "queue is empty");
+      GST_QUEUE_MUTEX_LOCK_CHECK (queue, out_flushing);
+    }
 
     /* we recheck, the signal could have changed the thresholds */
     while (gst_queue_is_empty (queue)) {
+      /* a cooperative task gives its thread back instead of blocking, it is
+       * scheduled again when data arrives */
+      if (gst_queue_suspend_task (queue))
+        goto out_suspended;
       GST_QUEUE_WAIT_ADD_CHECK (queue, out_flushing);
     }
+    queue->underrun = FALSE;
+    gst_queue_governor_set_starving (queue->governor, FALSE);
     GST_QUEUE_MUTEX_UNLOCK (queue);
 
     g_signal_emit (queue, gst_queue_signals[SIGNAL_RUNNING], 0);
@@ -1191,12 +1391,20 @@ gst_queue_loop (GstPad * pad)
 
   return;
 
+out_suspended:
+  {
+    GST_QUEUE_MUTEX_UNLOCK (queue);
+    return;
+  }
   /* ERRORS */
 out_flushing:
   {
     gboolean eos = queue->eos;
     GstFlowReturn ret = queue->srcresult;
 
+    queue->underrun = FALSE;
+    gst_queue_governor_set_starving (queue->governor, FALSE);
+    queue->task_suspended = FALSE;
     gst_pad_pause_task (queue->srcpad);
     GST_CAT_LOG_OBJECT (queue_dataflow, queue,
         "pause task, reason:  %s", gst_flow_get_name (ret));
@@ -1232,6 +1440,25 @@ gst_queue_handle_src_event (GstPad * pad, GstEvent * event)
   return res;
 }
 
+/* answer with our own usage and that of the process-wide budget */
+static gboolean
+gst_queue_handle_memory_usage_query (GstQueue * queue, GstStructure * s)
+{
+  GST_QUEUE_MUTEX_LOCK (queue);
+  gst_structure_set (s,
+      "bytes", G_TYPE_UINT, queue->cur_level.bytes,
+      "buffers", G_TYPE_UINT, queue->cur_level.buffers,
+      "time", G_TYPE_UINT64, queue->cur_level.time,
+      "priority", G_TYPE_INT, queue->memory_priority,
+      "throttled", G_TYPE_BOOLEAN,
+      gst_queue_governor_is_throttled (queue->governor),
+      "total-bytes", G_TYPE_UINT64, gst_queue_governor_get_total (),
+      "limit", G_TYPE_UINT64, gst_queue_governor_get_limit (), NULL);
+  GST_QUEUE_MUTEX_UNLOCK (queue);
+
+  return TRUE;
+}
+
 static gboolean
 gst_queue_handle_src_query (GstPad * pad, GstQuery * query)
 {
@@ -1239,6 +1466,13 @@ gst_queue_handle_src_query (GstPad * pad, GstQuery * query)
   GstPad *peer;
   gboolean res;
 
+  if (GST_QUERY_TYPE (query) == GST_QUERY_CUSTOM) {
+    GstStructure *s = gst_query_get_structure (query);
+
+    if (s && gst_structure_has_name (s, GST_QUEUE_MEMORY_USAGE_QUERY))
+      return gst_queue_handle_memory_usage_query (queue, s);
+  }
+
   if (!(peer = gst_pad_get_peer (queue->sinkpad)))
     return FALSE;
 
@@ -1356,8 +1590,11 @@ gst_queue_src_activate_push (GstPad * pad, gboolean active)
     /* step 1, unblock loop function */
     GST_QUEUE_MUTEX_LOCK (queue);
     queue->srcresult = GST_FLOW_WRONG_STATE;
-    /* the item add signal will unblock */
+    /* the item add signal will unblock, a suspended task is simply stopped */
     g_cond_signal (queue->item_add);
+    queue->task_suspended = FALSE;
+    queue->underrun = FALSE;
+    gst_queue_governor_set_starving (queue->governor, FALSE);
     GST_QUEUE_MUTEX_UNLOCK (queue);
 
     /* step 2, make sure streaming finishes */
@@ -1430,6 +1667,12 @@ gst_queue_set_property (GObject * object,
     case ARG_LEAKY:
       queue->leaky = g_value_get_enum (value);
       break;
+    case ARG_MEMORY_PRIORITY:
+      queue->memory_priority = g_value_get_int (value);
+      gst_queue_governor_set_priority (queue->governor,
+          queue->memory_priority);
+      queue_capacity_change (queue);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1477,6 +1720,9 @@ gst_queue_get_property (GObject * object,
     case ARG_LEAKY:
       g_value_set_enum (value, queue->leaky);
       break;
+    case ARG_MEMORY_PRIORITY:
+      g_value_set_int (value, queue->memory_priority);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
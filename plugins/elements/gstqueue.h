@@ -26,6 +26,8 @@
 
 #include <gst/gst.h>
 
+#include "gstqueuegovernor.h"
+
 G_BEGIN_DECLS
 
 #define GST_TYPE_QUEUE \
@@ -48,6 +50,7 @@ enum {
 typedef struct _GstQueue GstQueue;
 typedef struct _GstQueueSize GstQueueSize;
 typedef struct _GstQueueClass GstQueueClass;
+typedef struct _GstQueueItem GstQueueItem;
 
 /**
  * GstQueueSize:
@@ -81,22 +84,23 @@ struct _GstQueue {
   GstPad *sinkpad;
   GstPad *srcpad;
 
-  /* segments to keep track of timestamps */
+  /* segment to keep track of timestamps on the sinkpad */
   GstSegment sink_segment;
-  GstSegment src_segment;
 
-  /* position of src/sink */
+  /* running time of the src/sink position */
   GstClockTime sinktime, srctime;
-  /* TRUE if either position needs to be recalculated */
-  gboolean sink_tainted, src_tainted;
 
   /* flowreturn when srcpad is paused */
   GstFlowReturn srcresult;
   gboolean      unexpected;
   gboolean      eos;
 
-  /* the queue of data we're keeping our grubby hands on */
-  GQueue *queue;
+  /* the queue of data we're keeping our grubby hands on, a ring of
+   * items_size items of which items_len are used starting at items_head */
+  GstQueueItem *items;
+  guint items_size;
+  guint items_head;
+  guint items_len;
 
   GstQueueSize
     cur_level,          /* currently in the queue */
@@ -112,6 +116,15 @@ struct _GstQueue {
   GCond *item_del;      /* signals space now available for writing */
 
   gboolean head_needs_discont, tail_needs_discont;
+
+  /* the src task gave up its thread and waits for data */
+  gboolean task_suspended;
+  /* underrun was signaled and running was not yet */
+  gboolean underrun;
+
+  /* share of the process-wide memory budget, NULL without budget */
+  GstQueueGovernorClient *governor;
+  gint memory_priority;
 };
 
 struct _GstQueueClass {
@@ -0,0 +1,253 @@
+/* GStreamer
+ *
+ * gstqueuegovernor.c: process-wide memory budget for queue elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The governor keeps track of the bytes buffered by all registered queues in
+ * the process. The budget is taken from the GST_QUEUE_MEMORY_LIMIT
+ * environment variable, which is read again every time a queue is created;
+ * when it is not set, the queue does not register and the governor costs
+ * nothing.
+ *
+ * When the total exceeds the budget, the queue that holds the most data among
+ * those with the lowest priority is throttled. A throttled queue considers
+ * itself filled, so it blocks or leaks according to its own leaky policy until
+ * enough data was drained everywhere. Throttling a single queue at a time
+ * keeps a demuxer feeding several queues of the same priority from being
+ * blocked on all of them at once.
+ *
+ * A queue holding no data is never throttled, and no queue is throttled while
+ * another one of the same top-level bin waits for data: both could be fed by
+ * the same upstream thread that would otherwise block before the starving
+ * queue gets what it needs to, for example, preroll. Queues of other pipelines
+ * don't share threads with it, an idle pipeline does not keep a stalled one
+ * from being throttled.
+ */
+
+#ifdef HAVE_CONFIG_H
+#  include "config.h"
+#endif
+
+#include <stdlib.h>
+
+#include "gstqueuegovernor.h"
+
+GST_DEBUG_CATEGORY_STATIC (queue_governor_debug);
+#define GST_CAT_DEFAULT (queue_governor_debug)
+
+struct _GstQueueGovernorClient
+{
+  GstElement *element;
+  gint priority;
+  guint64 bytes;
+  gboolean starving;
+};
+
+static GStaticMutex governor_lock = G_STATIC_MUTEX_INIT;
+static GList *clients = NULL;
+static guint64 total = 0;
+static guint64 limit = 0;
+
+static gpointer
+gst_queue_governor_init (gpointer data)
+{
+  GST_DEBUG_CATEGORY_INIT (queue_governor_debug, "queuegovernor", 0,
+      "process-wide queue memory budget");
+
+  return NULL;
+}
+
+/* returns NULL when there is no limit and nothing needs to be accounted */
+GstQueueGovernorClient *
+gst_queue_governor_register (GstElement * element, gint priority)
+{
+  static GOnce once = G_ONCE_INIT;
+  GstQueueGovernorClient *client;
+  const gchar *env;
+  guint64 new_limit = 0;
+
+  g_once (&once, gst_queue_governor_init, NULL);
+
+  /* the limit is looked up for every queue so that it can be changed before
+   * creating queues, like the unit tests do */
+  env = g_getenv ("GST_QUEUE_MEMORY_LIMIT");
+  if (env != NULL)
+    new_limit = g_ascii_strtoull (env, NULL, 10);
+
+  g_static_mutex_lock (&governor_lock);
+  if (new_limit != limit) {
+    GST_DEBUG ("queue memory limit %" G_GUINT64_FORMAT " bytes", new_limit);
+    limit = new_limit;
+  }
+  if (limit == 0) {
+    g_static_mutex_unlock (&governor_lock);
+    return NULL;
+  }
+
+  client = g_slice_new (GstQueueGovernorClient);
+  client->element = element;
+  client->priority = priority;
+  client->bytes = 0;
+  client->starving = FALSE;
+
+  clients = g_list_prepend (clients, client);
+  g_static_mutex_unlock (&governor_lock);
+
+  GST_DEBUG_OBJECT (element, "registered with priority %d", priority);
+
+  return client;
+}
+
+void
+gst_queue_governor_unregister (GstQueueGovernorClient * client)
+{
+  if (client == NULL)
+    return;
+
+  g_static_mutex_lock (&governor_lock);
+  clients = g_list_remove (clients, client);
+  total -= client->bytes;
+  g_static_mutex_unlock (&governor_lock);
+
+  g_slice_free (GstQueueGovernorClient, client);
+}
+
+void
+gst_queue_governor_set_priority (GstQueueGovernorClient * client,
+    gint priority)
+{
+  if (client == NULL)
+    return;
+
+  g_static_mutex_lock (&governor_lock);
+  client->priority = priority;
+  g_static_mutex_unlock (&governor_lock);
+}
+
+/* set the number of bytes the client currently buffers */
+void
+gst_queue_governor_update (GstQueueGovernorClient * client, guint64 bytes)
+{
+  if (client == NULL)
+    return;
+
+  g_static_mutex_lock (&governor_lock);
+  total = total - client->bytes + bytes;
+  client->bytes = bytes;
+  g_static_mutex_unlock (&governor_lock);
+}
+
+/* mark the client as waiting for data */
+void
+gst_queue_governor_set_starving (GstQueueGovernorClient * client,
+    gboolean starving)
+{
+  if (client == NULL)
+    return;
+
+  g_static_mutex_lock (&governor_lock);
+  client->starving = starving;
+  g_static_mutex_unlock (&governor_lock);
+}
+
+/* the top-level bin of @element, or @element itself when it has no parent.
+ * The result is only compared and not referenced. */
+static GstObject *
+gst_queue_governor_get_toplevel (GstElement * element)
+{
+  GstObject *top, *parent;
+
+  top = gst_object_ref (element);
+  while ((parent = gst_object_get_parent (top))) {
+    gst_object_unref (top);
+    top = parent;
+  }
+  gst_object_unref (top);
+
+  return top;
+}
+
+gboolean
+gst_queue_governor_is_throttled (GstQueueGovernorClient * client)
+{
+  GstQueueGovernorClient *victim = NULL;
+  GstObject *toplevel = NULL;
+  gboolean res = FALSE;
+  GList *walk;
+
+  if (client == NULL)
+    return FALSE;
+
+  g_static_mutex_lock (&governor_lock);
+  if (limit == 0 || total <= limit || client->bytes == 0)
+    goto done;
+
+  /* find the biggest consumer with the lowest priority that still has data,
+   * nobody is throttled when another queue of the pipeline is starving */
+  for (walk = clients; walk; walk = g_list_next (walk)) {
+    GstQueueGovernorClient *other = walk->data;
+
+    if (other != client && other->starving) {
+      if (toplevel == NULL)
+        toplevel = gst_queue_governor_get_toplevel (client->element);
+      if (gst_queue_governor_get_toplevel (other->element) == toplevel)
+        goto done;
+    }
+    if (other->bytes == 0)
+      continue;
+    if (victim == NULL || other->priority < victim->priority ||
+        (other->priority == victim->priority && other->bytes > victim->bytes))
+      victim = other;
+  }
+  if (victim != client)
+    goto done;
+
+  res = TRUE;
+
+  GST_LOG_OBJECT (client->element, "throttled, %" G_GUINT64_FORMAT
+      " of %" G_GUINT64_FORMAT " bytes used", total, limit);
+
+done:
+  g_static_mutex_unlock (&governor_lock);
+
+  return res;
+}
+
+guint64
+gst_queue_governor_get_limit (void)
+{
+  guint64 res;
+
+  g_static_mutex_lock (&governor_lock);
+  res = limit;
+  g_static_mutex_unlock (&governor_lock);
+
+  return res;
+}
+
+guint64
+gst_queue_governor_get_total (void)
+{
+  guint64 res;
+
+  g_static_mutex_lock (&governor_lock);
+  res = total;
+  g_static_mutex_unlock (&governor_lock);
+
+  return res;
+}
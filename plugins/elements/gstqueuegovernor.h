@@ -0,0 +1,51 @@
+/* GStreamer
+ *
+ * gstqueuegovernor.h: process-wide memory budget for queue elements
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifndef __GST_QUEUE_GOVERNOR_H__
+#define __GST_QUEUE_GOVERNOR_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+/* name of the GST_QUERY_CUSTOM structure queue elements answer with their
+ * memory usage */
+#define GST_QUEUE_MEMORY_USAGE_QUERY "GstQueueMemoryUsage"
+
+typedef struct _GstQueueGovernorClient GstQueueGovernorClient;
+
+GstQueueGovernorClient *gst_queue_governor_register     (GstElement * element,
+                                                         gint priority);
+void                    gst_queue_governor_unregister   (GstQueueGovernorClient * client);
+
+void                    gst_queue_governor_set_priority (GstQueueGovernorClient * client,
+                                                         gint priority);
+void                    gst_queue_governor_update       (GstQueueGovernorClient * client,
+                                                         guint64 bytes);
+void                    gst_queue_governor_set_starving (GstQueueGovernorClient * client,
+                                                         gboolean starving);
+gboolean                gst_queue_governor_is_throttled (GstQueueGovernorClient * client);
+
+guint64                 gst_queue_governor_get_limit    (void);
+guint64                 gst_queue_governor_get_total    (void);
+
+G_END_DECLS
+
+#endif /* __GST_QUEUE_GOVERNOR_H__ */
@@ -26,6 +26,12 @@
  * @see_also: #GstIdentity
  *
  * Split data to multiple pads.
+ *
+ * All branches share the same buffer. Branches that only change metadata
+ * should use gst_buffer_make_metadata_writable(), which does not copy the
+ * data. The last branch receives the reference of tee itself, so when the
+ * other branches have already released the buffer it can be modified without
+ * a copy.
  */
 
 #ifdef HAVE_CONFIG_H
@@ -619,21 +625,28 @@ gst_tee_do_message (GstTee * tee, GstPad * pad, gpointer data, gboolean is_list)
   g_object_notify (G_OBJECT (tee), "last_message");
 }
 
+/* pushes a new reference to @data on @pad, or our own reference when @take
+ * is TRUE */
 static GstFlowReturn
-gst_tee_do_push (GstTee * tee, GstPad * pad, gpointer data, gboolean is_list)
+gst_tee_do_push (GstTee * tee, GstPad * pad, gpointer data, gboolean is_list,
+    gboolean take)
 {
   GstFlowReturn res;
 
   /* Push */
   if (pad == tee->pull_pad) {
     /* don't push on the pad we're pulling from */
+    if (take)
+      gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
     res = GST_FLOW_OK;
   } else if (is_list) {
-    res =
-        gst_pad_push_list (pad,
-        gst_buffer_list_ref (GST_BUFFER_LIST_CAST (data)));
+    if (!take)
+      gst_buffer_list_ref (GST_BUFFER_LIST_CAST (data));
+    res = gst_pad_push_list (pad, GST_BUFFER_LIST_CAST (data));
   } else {
-    res = gst_pad_push (pad, gst_buffer_ref (GST_BUFFER_CAST (data)));
+    if (!take)
+      gst_buffer_ref (GST_BUFFER_CAST (data));
+    res = gst_pad_push (pad, GST_BUFFER_CAST (data));
   }
   return res;
 }
@@ -704,7 +717,14 @@ restart:
     pdata = g_object_get_qdata ((GObject *) pad, push_data);
     g_assert (pdata != NULL);
 
-    if (G_LIKELY (!pdata->pushed)) {
+    if (G_LIKELY (!pdata->pushed && data != NULL)) {
+      gboolean take;
+
+      /* the last pad gets our own reference. When the other branches have
+       * released the item by now, it is writable for the last branch and
+       * changing its metadata or data does not need a copy. */
+      take = (g_list_next (pads) == NULL);
+
       /* not yet pushed, release lock and start pushing */
       gst_object_ref (pad);
       GST_OBJECT_UNLOCK (tee);
@@ -712,11 +732,14 @@ restart:
       GST_LOG_OBJECT (tee, "Starting to push %s %p",
           is_list ? "list" : "buffer", data);
 
-      ret = gst_tee_do_push (tee, pad, data, is_list);
+      ret = gst_tee_do_push (tee, pad, data, is_list, take);
 
       GST_LOG_OBJECT (tee, "Pushing item %p yielded result %s", data,
           gst_flow_get_name (ret));
 
+      if (take)
+        data = NULL;
+
       GST_OBJECT_LOCK (tee);
       /* keep track of which pad we pushed and the result value. We need to do
        * this before we release the refcount on the pad, the PushData is
@@ -724,11 +747,16 @@ restart:
       pdata->pushed = TRUE;
       pdata->result = ret;
       gst_object_unref (pad);
-    } else {
+    } else if (pdata->pushed) {
       /* already pushed, use previous return value */
       ret = pdata->result;
       GST_LOG_OBJECT (tee, "pad already pushed with %s",
           gst_flow_get_name (ret));
+    } else {
+      /* the pad was added after we gave our reference to the last pad, it
+       * will get the next item */
+      GST_LOG_OBJECT (tee, "item already given away, not pushing");
+      ret = GST_FLOW_NOT_LINKED;
     }
 
     /* before we go combining the return value, check if the pad list is still
@@ -755,7 +783,8 @@ restart:
   }
   GST_OBJECT_UNLOCK (tee);
 
-  gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
+  if (data)
+    gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
 
   /* no need to unset gvalue */
   return cret;
@@ -771,7 +800,8 @@ error:
   {
     GST_DEBUG_OBJECT (tee, "received error %s", gst_flow_get_name (ret));
     GST_OBJECT_UNLOCK (tee);
-    gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
+    if (data)
+      gst_mini_object_unref (GST_MINI_OBJECT_CAST (data));
     return ret;
   }
 }
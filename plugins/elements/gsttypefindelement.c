@@ -26,6 +26,11 @@
  * to the found media type.
  *
  * Plugins can register custom typefinders by using #GstTypeFindFactory.
+ *
+ * Buffers without caps get the detected caps attached. Applications that do
+ * not need the caps on every buffer can set #GstTypeFindElement:implicit-caps,
+ * buffers are then passed on untouched once downstream has been configured
+ * with the caps.
  */
 
 /* FIXME: need a better solution for non-seekable streams */
@@ -44,8 +49,11 @@
  *
  * The element has two scheduling modes:
  *
- * 1) chain based, it will collect buffers and run the typefind function on
- *    the buffer until something is found.
+ * 1) chain based, it will collect buffers in an adapter and run the typefind
+ *    functions on the collected data until something is found. Typefind
+ *    functions that looked at all the data they wanted without suggesting a
+ *    type are not called again, the others are only called again once more
+ *    data than they last asked for is available.
  * 2) getrange based, it will proxy the getrange function to the sinkpad. It
  *    is assumed that the peer element is happy with whatever format we
  *    eventually read.
@@ -104,6 +112,7 @@ enum
   PROP_MINIMUM,
   PROP_MAXIMUM,
   PROP_FORCE_CAPS,
+  PROP_IMPLICIT_CAPS,
   PROP_LAST
 };
 enum
@@ -157,6 +166,28 @@ gst_type_find_element_send_cached_events (GstTypeFindElement * typefind);
 
 static guint gst_type_find_element_signals[LAST_SIGNAL] = { 0 };
 
+/* a typefind function that has not decided yet in chain based mode, it is
+ * called again once @needed bytes have been collected */
+typedef struct
+{
+  GstTypeFindFactory *factory;
+  guint64 needed;
+} GstTypeFindCandidate;
+
+typedef struct
+{
+  GstTypeFindElement *typefind;
+  GstTypeFindFactory *factory;
+  guint avail;
+  /* bytes of the scratch area handed out and wanted in the current call */
+  guint scratch_used;
+  guint scratch_wanted;
+  GSList *chunks;
+  guint64 needed;
+  guint best_probability;
+  GstCaps *caps;
+} GstTypeFindPeekHelper;
+
 static void
 gst_type_find_element_have_type (GstTypeFindElement * typefind,
     guint probability, const GstCaps * caps)
@@ -223,6 +254,20 @@ gst_type_find_element_class_init (GstTypeFindElementClass * typefind_class)
       g_param_spec_boxed ("force-caps", _("force caps"),
           _("force caps without doing a typefind"), gst_caps_get_type (),
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstTypeFindElement:implicit-caps
+   *
+   * Pass buffers without caps on untouched once downstream has been
+   * configured with the detected caps, instead of attaching the caps to every
+   * buffer. Only enable this when nothing downstream reads the caps of every
+   * buffer.
+   *
+   * Since: 0.10.31
+   */
+  g_object_class_install_property (gobject_class, PROP_IMPLICIT_CAPS,
+      g_param_spec_boolean ("implicit-caps", "Implicit caps",
+          "Don't attach the caps to buffers without caps once downstream has "
+          "them", FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
   /**
    * GstTypeFindElement::have-type:
    * @typefind: the typefind instance
@@ -285,8 +330,28 @@ gst_type_find_element_init (GstTypeFindElement * typefind,
   typefind->caps = NULL;
   typefind->min_probability = 1;
   typefind->max_probability = GST_TYPE_FIND_MAXIMUM;
+  typefind->implicit_caps = FALSE;
 
-  typefind->store = NULL;
+  typefind->adapter = gst_adapter_new ();
+  typefind->adapter_offset = GST_BUFFER_OFFSET_NONE;
+  typefind->candidates = NULL;
+  typefind->scratch = NULL;
+  typefind->scratch_size = 0;
+}
+
+static void
+gst_type_find_element_free_candidates (GstTypeFindElement * typefind)
+{
+  GList *l;
+
+  for (l = typefind->candidates; l != NULL; l = l->next) {
+    GstTypeFindCandidate *candidate = l->data;
+
+    gst_object_unref (candidate->factory);
+    g_slice_free (GstTypeFindCandidate, candidate);
+  }
+  g_list_free (typefind->candidates);
+  typefind->candidates = NULL;
 }
 
 static void
@@ -294,11 +359,17 @@ gst_type_find_element_dispose (GObject * object)
 {
   GstTypeFindElement *typefind = GST_TYPE_FIND_ELEMENT (object);
 
-  if (typefind->store) {
-    gst_buffer_unref (typefind->store);
-    typefind->store = NULL;
+  if (typefind->adapter) {
+    g_object_unref (typefind->adapter);
+    typefind->adapter = NULL;
   }
 
+  gst_type_find_element_free_candidates (typefind);
+
+  g_free (typefind->scratch);
+  typefind->scratch = NULL;
+  typefind->scratch_size = 0;
+
   if (typefind->force_caps) {
     gst_caps_unref (typefind->force_caps);
     typefind->force_caps = NULL;
@@ -329,6 +400,11 @@ gst_type_find_element_set_property (GObject * object, guint prop_id,
       typefind->force_caps = g_value_dup_boxed (value);
       GST_OBJECT_UNLOCK (typefind);
       break;
+    case PROP_IMPLICIT_CAPS:
+      GST_OBJECT_LOCK (typefind);
+      typefind->implicit_caps = g_value_get_boolean (value);
+      GST_OBJECT_UNLOCK (typefind);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -360,6 +436,11 @@ gst_type_find_element_get_property (GObject * object, guint prop_id,
       g_value_set_boxed (value, typefind->force_caps);
       GST_OBJECT_UNLOCK (typefind);
       break;
+    case PROP_IMPLICIT_CAPS:
+      GST_OBJECT_LOCK (typefind);
+      g_value_set_boolean (value, typefind->implicit_caps);
+      GST_OBJECT_UNLOCK (typefind);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -390,7 +471,7 @@ gst_type_find_handle_src_query (GstPad * pad, GstQuery * query)
       GstFormat format;
 
       GST_OBJECT_LOCK (typefind);
-      if (typefind->store == NULL) {
+      if (gst_adapter_available (typefind->adapter) == 0) {
         GST_OBJECT_UNLOCK (typefind);
         goto out;
       }
@@ -400,7 +481,7 @@ gst_type_find_handle_src_query (GstPad * pad, GstQuery * query)
       /* FIXME: this code assumes that there's no discont in the queue */
       switch (format) {
         case GST_FORMAT_BYTES:
-          peer_pos -= GST_BUFFER_SIZE (typefind->store);
+          peer_pos -= gst_adapter_available (typefind->adapter);
           break;
         default:
           /* FIXME */
@@ -462,11 +543,38 @@ start_typefinding (GstTypeFindElement * typefind)
   typefind->mode = MODE_TYPEFIND;
 }
 
+/* with LOCK, takes the data collected while typefinding as one buffer */
+static GstBuffer *
+gst_type_find_element_take_store (GstTypeFindElement * typefind)
+{
+  GstBuffer *store;
+  GstClockTime timestamp;
+  guint64 distance;
+  guint avail;
+
+  avail = gst_adapter_available (typefind->adapter);
+  if (avail == 0)
+    return NULL;
+
+  timestamp = gst_adapter_prev_timestamp (typefind->adapter, &distance);
+  store = gst_adapter_take_buffer (typefind->adapter, avail);
+  store = gst_buffer_make_metadata_writable (store);
+  if (distance == 0)
+    GST_BUFFER_TIMESTAMP (store) = timestamp;
+  /* the adapter only keeps the offset when it did not have to merge buffers */
+  GST_BUFFER_OFFSET (store) = typefind->adapter_offset;
+  typefind->adapter_offset = GST_BUFFER_OFFSET_NONE;
+  gst_buffer_set_caps (store, typefind->caps);
+
+  return store;
+}
+
 static void
 stop_typefinding (GstTypeFindElement * typefind)
 {
   GstState state;
   gboolean push_cached_buffers;
+  GstBuffer *store;
 
   gst_element_get_state (GST_ELEMENT (typefind), &state, NULL, 0);
 
@@ -476,14 +584,11 @@ stop_typefinding (GstTypeFindElement * typefind)
       push_cached_buffers ? " and pushing cached buffers" : "");
 
   GST_OBJECT_LOCK (typefind);
-  if (typefind->store) {
-    GstBuffer *store;
-
-    store = gst_buffer_make_metadata_writable (typefind->store);
-    typefind->store = NULL;
-    gst_buffer_set_caps (store, typefind->caps);
-    GST_OBJECT_UNLOCK (typefind);
+  gst_type_find_element_free_candidates (typefind);
+  store = gst_type_find_element_take_store (typefind);
+  GST_OBJECT_UNLOCK (typefind);
 
+  if (store) {
     if (!push_cached_buffers) {
       gst_buffer_unref (store);
     } else {
@@ -514,8 +619,6 @@ stop_typefinding (GstTypeFindElement * typefind)
       if (peer)
         gst_object_unref (peer);
     }
-  } else {
-    GST_OBJECT_UNLOCK (typefind);
   }
 }
 
@@ -534,15 +637,25 @@ gst_type_find_element_handle_event (GstPad * pad, GstEvent * event)
         case GST_EVENT_EOS:{
           GstTypeFindProbability prob = 0;
           GstCaps *caps = NULL;
+          guint avail;
 
           GST_INFO_OBJECT (typefind, "Got EOS and no type found yet");
 
           /* we might not have started typefinding yet because there was not
            * enough data so far; just give it a shot now and see what we get */
           GST_OBJECT_LOCK (typefind);
-          if (typefind->store) {
+          avail = gst_adapter_available (typefind->adapter);
+          if (avail > 0) {
+            GstBuffer *buffer;
+
+            /* give all typefind functions a last chance on all the data */
+            buffer = gst_buffer_new ();
+            GST_BUFFER_DATA (buffer) =
+                (guint8 *) gst_adapter_peek (typefind->adapter, avail);
+            GST_BUFFER_SIZE (buffer) = avail;
             caps = gst_type_find_helper_for_buffer (GST_OBJECT (typefind),
-                typefind->store, &prob);
+                buffer, &prob);
+            gst_buffer_unref (buffer);
             GST_OBJECT_UNLOCK (typefind);
 
             if (caps && prob >= typefind->min_probability) {
@@ -571,7 +684,8 @@ gst_type_find_element_handle_event (GstPad * pad, GstEvent * event)
               (GFunc) gst_mini_object_unref, NULL);
           g_list_free (typefind->cached_events);
           typefind->cached_events = NULL;
-          gst_buffer_replace (&typefind->store, NULL);
+          gst_adapter_clear (typefind->adapter);
+          gst_type_find_element_free_candidates (typefind);
           GST_OBJECT_UNLOCK (typefind);
           /* fall through */
         case GST_EVENT_FLUSH_START:
@@ -623,6 +737,7 @@ static gboolean
 gst_type_find_element_setcaps (GstPad * pad, GstCaps * caps)
 {
   GstTypeFindElement *typefind;
+  GstBuffer *store;
 
   typefind = GST_TYPE_FIND_ELEMENT (GST_PAD_PARENT (pad));
 
@@ -641,19 +756,13 @@ gst_type_find_element_setcaps (GstPad * pad, GstCaps * caps)
 
     gst_type_find_element_send_cached_events (typefind);
     GST_OBJECT_LOCK (typefind);
-    if (typefind->store) {
-      GstBuffer *store = typefind->store;
+    gst_type_find_element_free_candidates (typefind);
+    store = gst_type_find_element_take_store (typefind);
+    GST_OBJECT_UNLOCK (typefind);
 
-      typefind->store = NULL;
+    if (store) {
       GST_DEBUG_OBJECT (typefind, "Pushing store: %d", GST_BUFFER_SIZE (store));
-
-      store = gst_buffer_make_metadata_writable (store);
-      gst_buffer_set_caps (store, typefind->caps);
-      GST_OBJECT_UNLOCK (typefind);
-
       gst_pad_push (typefind->src, store);
-    } else {
-      GST_OBJECT_UNLOCK (typefind);
     }
   }
 
@@ -742,6 +851,23 @@ gst_type_find_guess_by_extension (GstTypeFindElement * typefind, GstPad * pad,
   return caps;
 }
 
+/* with LOCK, checks if the peer of our srcpad is configured with our caps.
+ * The caps of the peer only change when we push buffers so a pointer compare
+ * is enough. */
+static gboolean
+gst_type_find_element_peer_has_caps (GstTypeFindElement * typefind)
+{
+  GstPad *peer;
+  gboolean res;
+
+  GST_OBJECT_LOCK (typefind->src);
+  peer = GST_PAD_PEER (typefind->src);
+  res = peer != NULL && GST_PAD_CAPS (peer) == typefind->caps;
+  GST_OBJECT_UNLOCK (typefind->src);
+
+  return res;
+}
+
 static GstFlowReturn
 gst_type_find_element_chain (GstPad * pad, GstBuffer * buffer)
 {
@@ -756,16 +882,22 @@ gst_type_find_element_chain (GstPad * pad, GstBuffer * buffer)
       return GST_FLOW_ERROR;
     case MODE_NORMAL:
       GST_OBJECT_LOCK (typefind);
-      buffer = gst_buffer_make_metadata_writable (buffer);
-      gst_buffer_set_caps (buffer, typefind->caps);
+      /* a buffer without caps keeps the caps of the previous buffer
+       * downstream, with implicit caps we only set them until the peer has
+       * them */
+      if (GST_BUFFER_CAPS (buffer) != typefind->caps &&
+          (GST_BUFFER_CAPS (buffer) != NULL || !typefind->implicit_caps ||
+              !gst_type_find_element_peer_has_caps (typefind))) {
+        buffer = gst_buffer_make_metadata_writable (buffer);
+        gst_buffer_set_caps (buffer, typefind->caps);
+      }
       GST_OBJECT_UNLOCK (typefind);
       return gst_pad_push (typefind->src, buffer);
     case MODE_TYPEFIND:{
       GST_OBJECT_LOCK (typefind);
-      if (typefind->store)
-        typefind->store = gst_buffer_join (typefind->store, buffer);
-      else
-        typefind->store = buffer;
+      if (gst_adapter_available (typefind->adapter) == 0)
+        typefind->adapter_offset = GST_BUFFER_OFFSET (buffer);
+      gst_adapter_push (typefind->adapter, buffer);
       GST_OBJECT_UNLOCK (typefind);
 
       res = gst_type_find_element_chain_do_typefinding (typefind);
@@ -783,51 +915,178 @@ gst_type_find_element_chain (GstPad * pad, GstBuffer * buffer)
   return res;
 }
 
+static guint8 *
+gst_type_find_element_peek (gpointer data, gint64 offset, guint size)
+{
+  GstTypeFindPeekHelper *helper = data;
+  guint8 *chunk;
+  guint64 end;
+
+  GST_LOG_OBJECT (helper->typefind, "'%s' called peek (%" G_GINT64_FORMAT
+      ", %u)", GST_PLUGIN_FEATURE_NAME (helper->factory), offset, size);
+
+  if (size == 0 || offset < 0)
+    return NULL;
+
+  /* remember how much data this function wants to see */
+  end = offset + size;
+  if (end > helper->avail) {
+    if (helper->needed == 0 || end < helper->needed)
+      helper->needed = end;
+    return NULL;
+  }
+
+  /* copy out only what was asked for instead of flattening all the data. The
+   * copies only have to stay valid until the typefind function returns, so
+   * they go into a scratch area that is reused for every call. When it is too
+   * small, the copy is allocated separately and the area grows after the
+   * call. */
+  if (helper->scratch_used + size <= helper->typefind->scratch_size) {
+    chunk = helper->typefind->scratch + helper->scratch_used;
+    helper->scratch_used += size;
+  } else {
+    chunk = g_malloc (size);
+    helper->chunks = g_slist_prepend (helper->chunks, chunk);
+  }
+  helper->scratch_wanted += size;
+  gst_adapter_copy (helper->typefind->adapter, chunk, offset, size);
+
+  return chunk;
+}
+
+static void
+gst_type_find_element_suggest (gpointer data, guint probability,
+    const GstCaps * caps)
+{
+  GstTypeFindPeekHelper *helper = data;
+
+  GST_LOG_OBJECT (helper->typefind, "'%s' called suggest (%u, %"
+      GST_PTR_FORMAT ")", GST_PLUGIN_FEATURE_NAME (helper->factory),
+      probability, caps);
+
+  /* Note: not >= as we call typefinders in order of rank, highest first */
+  if (probability > helper->best_probability) {
+    GstCaps *copy = gst_caps_copy (caps);
+
+    gst_caps_replace (&helper->caps, copy);
+    gst_caps_unref (copy);
+    helper->best_probability = probability;
+  }
+}
+
+/* with LOCK. Calls the typefind functions that wanted less data than what
+ * was collected so far. Functions that saw everything they asked for can't
+ * change their mind with more data and are dropped. */
+static GstCaps *
+gst_type_find_element_run_candidates (GstTypeFindElement * typefind,
+    GstTypeFindProbability * probability)
+{
+  GstTypeFindPeekHelper helper = { NULL, };
+  GstTypeFind find;
+  GList *l, *next;
+
+  if (typefind->candidates == NULL) {
+    GList *factories = gst_type_find_factory_get_list ();
+
+    for (l = factories; l != NULL; l = l->next) {
+      GstTypeFindCandidate *candidate = g_slice_new (GstTypeFindCandidate);
+
+      /* takes the ref of the list */
+      candidate->factory = l->data;
+      candidate->needed = 0;
+      typefind->candidates = g_list_prepend (typefind->candidates, candidate);
+    }
+    typefind->candidates = g_list_reverse (typefind->candidates);
+    g_list_free (factories);
+  }
+
+  helper.typefind = typefind;
+  helper.avail = gst_adapter_available (typefind->adapter);
+
+  find.data = &helper;
+  find.peek = gst_type_find_element_peek;
+  find.suggest = gst_type_find_element_suggest;
+  find.get_length = NULL;
+
+  for (l = typefind->candidates; l != NULL; l = next) {
+    GstTypeFindCandidate *candidate = l->data;
+
+    next = l->next;
+    if (candidate->needed > helper.avail)
+      continue;
+
+    helper.factory = candidate->factory;
+    helper.needed = 0;
+    gst_type_find_factory_call_function (candidate->factory, &find);
+
+    if (G_UNLIKELY (helper.chunks)) {
+      g_slist_foreach (helper.chunks, (GFunc) g_free, NULL);
+      g_slist_free (helper.chunks);
+      helper.chunks = NULL;
+
+      g_free (typefind->scratch);
+      typefind->scratch = g_malloc (helper.scratch_wanted);
+      typefind->scratch_size = helper.scratch_wanted;
+    }
+    helper.scratch_used = 0;
+    helper.scratch_wanted = 0;
+
+    if (helper.needed == 0) {
+      GST_LOG_OBJECT (typefind, "'%s' is done",
+          GST_PLUGIN_FEATURE_NAME (candidate->factory));
+      gst_object_unref (candidate->factory);
+      g_slice_free (GstTypeFindCandidate, candidate);
+      typefind->candidates = g_list_delete_link (typefind->candidates, l);
+    } else {
+      candidate->needed = helper.needed;
+    }
+
+    if (helper.best_probability >= GST_TYPE_FIND_MAXIMUM)
+      break;
+  }
+
+  *probability = helper.best_probability;
+  return helper.caps;
+}
+
 static GstFlowReturn
 gst_type_find_element_chain_do_typefinding (GstTypeFindElement * typefind)
 {
   GstTypeFindProbability probability;
   GstCaps *caps;
+  guint avail;
 
   GST_OBJECT_LOCK (typefind);
-  if (GST_BUFFER_SIZE (typefind->store) < TYPE_FIND_MIN_SIZE) {
+  avail = gst_adapter_available (typefind->adapter);
+  if (avail < TYPE_FIND_MIN_SIZE) {
     GST_DEBUG_OBJECT (typefind, "not enough data for typefinding yet "
-        "(%u bytes)", GST_BUFFER_SIZE (typefind->store));
+        "(%u bytes)", avail);
     GST_OBJECT_UNLOCK (typefind);
     return GST_FLOW_OK;
   }
 
-  caps = gst_type_find_helper_for_buffer (GST_OBJECT (typefind),
-      typefind->store, &probability);
-  if (caps == NULL && GST_BUFFER_SIZE (typefind->store) > TYPE_FIND_MAX_SIZE) {
-    GST_OBJECT_UNLOCK (typefind);
-    GST_ELEMENT_ERROR (typefind, STREAM, TYPE_NOT_FOUND, (NULL), (NULL));
-    stop_typefinding (typefind);
-    return GST_FLOW_ERROR;
-  } else if (caps == NULL) {
-    GST_OBJECT_UNLOCK (typefind);
-    GST_DEBUG_OBJECT (typefind, "no caps found with %u bytes of data, "
-        "waiting for more data", GST_BUFFER_SIZE (typefind->store));
-    return GST_FLOW_OK;
-  }
-
-  /* found a type */
-  if (probability < typefind->min_probability) {
+  caps = gst_type_find_element_run_candidates (typefind, &probability);
+  if (caps != NULL && probability < typefind->min_probability) {
     GST_DEBUG_OBJECT (typefind, "found caps %" GST_PTR_FORMAT ", but "
         "probability is %u which is lower than the required minimum of %u",
         caps, probability, typefind->min_probability);
 
     gst_caps_replace (&caps, NULL);
+  }
 
-    if (GST_BUFFER_SIZE (typefind->store) >= TYPE_FIND_MAX_SIZE) {
+  if (caps == NULL) {
+    /* nothing left that could still decide with more data */
+    if (typefind->candidates == NULL || avail >= TYPE_FIND_MAX_SIZE) {
       GST_OBJECT_UNLOCK (typefind);
       GST_ELEMENT_ERROR (typefind, STREAM, TYPE_NOT_FOUND, (NULL), (NULL));
       stop_typefinding (typefind);
       return GST_FLOW_ERROR;
     }
 
+    GST_DEBUG_OBJECT (typefind, "no caps found with %u bytes of data, "
+        "waiting for more data for %u typefind functions", avail,
+        g_list_length (typefind->candidates));
     GST_OBJECT_UNLOCK (typefind);
-    GST_DEBUG_OBJECT (typefind, "waiting for more data to try again");
     return GST_FLOW_OK;
   }
   GST_OBJECT_UNLOCK (typefind);
@@ -1031,6 +1290,8 @@ gst_type_find_element_change_state (GstElement * element,
           (GFunc) gst_mini_object_unref, NULL);
       g_list_free (typefind->cached_events);
       typefind->cached_events = NULL;
+      gst_adapter_clear (typefind->adapter);
+      gst_type_find_element_free_candidates (typefind);
       typefind->mode = MODE_TYPEFIND;
       GST_OBJECT_UNLOCK (typefind);
       break;
@@ -25,6 +25,7 @@
 
 #include <gst/gstinfo.h>
 #include <gst/gstelement.h>
+#include <gst/base/gstadapter.h>
 
 G_BEGIN_DECLS
 
@@ -56,10 +57,15 @@ struct _GstTypeFindElement {
   GstCaps *		caps;
 
   guint			mode;
-  GstBuffer *		store;
+  GstAdapter *		adapter;
+  guint64		adapter_offset;
+  GList *		candidates;
+  guint8 *		scratch;
+  guint			scratch_size;
 
   GList *               cached_events;
   GstCaps *             force_caps;
+  gboolean              implicit_caps;
 };
 
 struct _GstTypeFindElementClass {
@@ -0,0 +1,139 @@
+/* GStreamer
+ *
+ * fdrelay.c: measure fdsrc ! fdsink relay throughput between pipes
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The relay pipeline reads from one pipe and writes into another. It is fed
+ * by a fakesrc pipeline and drained by a fakesink pipeline, so the measured
+ * time is dominated by the cost of moving data through the relay. */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <gst/gst.h>
+
+#define BUFFER_COUNT (10000)
+#define BUFFER_SIZE (64 * 1024)
+
+static GstElement *
+launch (const gchar * description)
+{
+  GstElement *pipeline;
+  GError *error = NULL;
+
+  pipeline = gst_parse_launch (description, &error);
+  if (pipeline == NULL) {
+    g_print ("could not create \"%s\": %s\n", description,
+        error ? error->message : "unknown error");
+    exit (1);
+  }
+  if (error)
+    g_error_free (error);
+
+  return pipeline;
+}
+
+static void
+wait_eos (GstElement * pipeline)
+{
+  GstBus *bus;
+  GstMessage *msg;
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    g_print ("pipeline posted an error, aborting...\n");
+    exit (1);
+  }
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+static void
+run_relay (guint buffers, guint size, gboolean zerocopy)
+{
+  GstElement *writer, *relay, *reader;
+  gint in[2], out[2];
+  gchar *desc;
+  GstClockTime start, end;
+  gdouble secs;
+
+  if (pipe (in) < 0 || pipe (out) < 0) {
+    g_print ("could not create pipes: %s\n", g_strerror (errno));
+    exit (1);
+  }
+
+  desc = g_strdup_printf ("fakesrc num-buffers=%u sizetype=fixed "
+      "sizemax=%u ! fdsink fd=%d", buffers, size, in[1]);
+  writer = launch (desc);
+  g_free (desc);
+
+  desc = g_strdup_printf ("fdsrc fd=%d blocksize=%u use-buffer-alloc=%d ! "
+      "fdsink fd=%d vmsplice=%d", in[0], size, zerocopy, out[1], zerocopy);
+  relay = launch (desc);
+  g_free (desc);
+
+  desc = g_strdup_printf ("fdsrc fd=%d blocksize=%u ! fakesink", out[0], size);
+  reader = launch (desc);
+  g_free (desc);
+
+  start = gst_util_get_timestamp ();
+
+  gst_element_set_state (reader, GST_STATE_PLAYING);
+  gst_element_set_state (relay, GST_STATE_PLAYING);
+  gst_element_set_state (writer, GST_STATE_PLAYING);
+
+  /* closing the write ends makes the next fdsrc go EOS */
+  wait_eos (writer);
+  close (in[1]);
+  wait_eos (relay);
+  close (out[1]);
+  wait_eos (reader);
+
+  end = gst_util_get_timestamp ();
+
+  close (in[0]);
+  close (out[0]);
+
+  secs = (gdouble) (end - start) / GST_SECOND;
+  g_print ("%" GST_TIME_FORMAT " - relaying %u buffers of %u bytes "
+      "(%s): %.1f MB/s\n", GST_TIME_ARGS (end - start), buffers, size,
+      zerocopy ? "vmsplice" : "read/write",
+      ((gdouble) buffers * size) / (1024.0 * 1024.0) / secs);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  guint buffers = BUFFER_COUNT, size = BUFFER_SIZE;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    buffers = atoi (argv[1]);
+  if (argc > 2)
+    size = atoi (argv[2]);
+
+  run_relay (buffers, size, FALSE);
+  run_relay (buffers, size, TRUE);
+
+  return 0;
+}
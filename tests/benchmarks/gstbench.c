@@ -0,0 +1,405 @@
+/* GStreamer
+ *
+ * gstbench.c: run the benchmarks with warmup and repetitions
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Every benchmark of the suite is run as a separate process, a few times to
+ * warm up the page cache and the registry and then a number of measured
+ * times. For each run the wall clock time and the CPU time (user + system,
+ * of all threads) of the process are recorded, the results are summarized
+ * as min, median, p95 and max and written as JSON, one benchmark per line.
+ *
+ * A previous result file can be given with --compare, benchmarks whose
+ * median wall or CPU time grew by more than --threshold percent are then
+ * reported as regressions and the exit code is 1.
+ *
+ *   make benchmark
+ *   make benchmark BENCHMARK_FLAGS="--compare=baseline.json"
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <gst/gst.h>
+
+typedef struct
+{
+  const gchar *name;
+  const gchar *args;
+} Benchmark;
+
+/* benchmarks that run forever (gstpollstress) or for a fixed time
+ * (gstclockstress) are not part of the suite, their wall time says nothing */
+static const Benchmark suite[] = {
+  {"init", ""},
+  {"caps", ""},
+  {"capsnego", "-d 2 -c 3"},
+  {"complexity", "2 200"},
+  {"mass-elements", "100 10000"},
+  {"gstbufferstress", "4 1000000"},
+  {"controller", ""},
+  {"fdrelay", "2000"},
+  {"seeklatency", "20"},
+  {"queuebuffers", "1000000"},
+};
+
+typedef struct
+{
+  GstClockTime min;
+  GstClockTime median;
+  GstClockTime p95;
+  GstClockTime max;
+} Summary;
+
+typedef struct
+{
+  gchar *name;
+  Summary wall;
+  Summary cpu;
+} Result;
+
+static gint warmup = 1;
+static gint repetitions = 5;
+static gdouble threshold = 10.0;
+static gchar *output = NULL;
+static gchar *compare = NULL;
+
+static GOptionEntry options[] = {
+  {"warmup", 'w', 0, G_OPTION_ARG_INT, &warmup,
+      "Number of unmeasured runs before the measurements (default 1)", "N"},
+  {"repetitions", 'r', 0, G_OPTION_ARG_INT, &repetitions,
+      "Number of measured runs (default 5)", "N"},
+  {"output", 'o', 0, G_OPTION_ARG_FILENAME, &output,
+      "Write the JSON results to FILE instead of stdout", "FILE"},
+  {"compare", 'c', 0, G_OPTION_ARG_FILENAME, &compare,
+      "Compare the results against the JSON results in FILE", "FILE"},
+  {"threshold", 't', 0, G_OPTION_ARG_DOUBLE, &threshold,
+      "Percentage a median may grow before it is a regression (default 10)",
+      "PERCENT"},
+  {NULL}
+};
+
+static gint
+compare_times (gconstpointer a, gconstpointer b)
+{
+  GstClockTime ta = *(const GstClockTime *) a;
+  GstClockTime tb = *(const GstClockTime *) b;
+
+  return ta < tb ? -1 : (ta > tb ? 1 : 0);
+}
+
+static void
+summarize (GstClockTime * times, gint n, Summary * summary)
+{
+  qsort (times, n, sizeof (GstClockTime), compare_times);
+
+  summary->min = times[0];
+  summary->median = (n & 1) ? times[n / 2] :
+      (times[n / 2 - 1] + times[n / 2]) / 2;
+  /* nearest rank */
+  summary->p95 = times[MIN (n - 1, (95 * n + 99) / 100 - 1)];
+  summary->max = times[n - 1];
+}
+
+static GstClockTime
+timeval_to_time (const struct timeval *tv)
+{
+  return GST_TIMEVAL_TO_TIME (*tv);
+}
+
+/* runs @argv once and returns the wall and CPU time it took */
+static gboolean
+run_once (gchar ** argv, GstClockTime * wall, GstClockTime * cpu)
+{
+  struct rusage usage;
+  GError *error = NULL;
+  GstClockTime start;
+  GPid pid;
+  gint status;
+
+  start = gst_util_get_timestamp ();
+  if (!g_spawn_async (NULL, argv, NULL,
+          G_SPAWN_DO_NOT_REAP_CHILD | G_SPAWN_STDOUT_TO_DEV_NULL, NULL, NULL,
+          &pid, &error)) {
+    g_printerr ("could not run %s: %s\n", argv[0], error->message);
+    g_error_free (error);
+    return FALSE;
+  }
+
+  while (wait4 (pid, &status, 0, &usage) < 0) {
+    if (errno != EINTR) {
+      g_printerr ("could not wait for %s: %s\n", argv[0], g_strerror (errno));
+      return FALSE;
+    }
+  }
+  *wall = gst_util_get_timestamp () - start;
+  *cpu = timeval_to_time (&usage.ru_utime) + timeval_to_time (&usage.ru_stime);
+  g_spawn_close_pid (pid);
+
+  if (!WIFEXITED (status) || WEXITSTATUS (status) != 0) {
+    g_printerr ("%s failed\n", argv[0]);
+    return FALSE;
+  }
+  return TRUE;
+}
+
+static gboolean
+run_benchmark (const gchar * dir, const Benchmark * bench, Result * result)
+{
+  GstClockTime *walls, *cpus;
+  gchar *cmdline, **argv;
+  GError *error = NULL;
+  gboolean ret = FALSE;
+  gint i;
+
+  cmdline = g_strdup_printf ("%s" G_DIR_SEPARATOR_S "%s %s", dir, bench->name,
+      bench->args);
+  if (!g_shell_parse_argv (cmdline, NULL, &argv, &error)) {
+    g_printerr ("could not parse '%s': %s\n", cmdline, error->message);
+    g_error_free (error);
+    g_free (cmdline);
+    return FALSE;
+  }
+  g_free (cmdline);
+
+  walls = g_new (GstClockTime, repetitions);
+  cpus = g_new (GstClockTime, repetitions);
+
+  for (i = 0; i < warmup; i++) {
+    if (!run_once (argv, &walls[0], &cpus[0]))
+      goto done;
+  }
+  for (i = 0; i < repetitions; i++) {
+    if (!run_once (argv, &walls[i], &cpus[i]))
+      goto done;
+  }
+
+  result->name = g_strdup (bench->name);
+  summarize (walls, repetitions, &result->wall);
+  summarize (cpus, repetitions, &result->cpu);
+  ret = TRUE;
+
+done:
+  g_free (walls);
+  g_free (cpus);
+  g_strfreev (argv);
+
+  return ret;
+}
+
+static void
+write_result (GString * json, const Result * result, gboolean last)
+{
+  g_string_append_printf (json, "    { \"name\": \"%s\", "
+      "\"wall-min\": %" G_GUINT64_FORMAT ", "
+      "\"wall-median\": %" G_GUINT64_FORMAT ", "
+      "\"wall-p95\": %" G_GUINT64_FORMAT ", "
+      "\"wall-max\": %" G_GUINT64_FORMAT ", "
+      "\"cpu-min\": %" G_GUINT64_FORMAT ", "
+      "\"cpu-median\": %" G_GUINT64_FORMAT ", "
+      "\"cpu-p95\": %" G_GUINT64_FORMAT ", "
+      "\"cpu-max\": %" G_GUINT64_FORMAT " }%s\n", result->name,
+      result->wall.min, result->wall.median, result->wall.p95, result->wall.max,
+      result->cpu.min, result->cpu.median, result->cpu.p95, result->cpu.max,
+      last ? "" : ",");
+}
+
+/* result files are written by us, with one benchmark per line */
+static gboolean
+parse_field (const gchar * line, const gchar * field, guint64 * value)
+{
+  gchar *key;
+  const gchar *pos;
+
+  key = g_strdup_printf ("\"%s\": ", field);
+  pos = strstr (line, key);
+  if (pos)
+    *value = g_ascii_strtoull (pos + strlen (key), NULL, 10);
+  g_free (key);
+
+  return pos != NULL;
+}
+
+static GHashTable *
+load_results (const gchar * filename)
+{
+  GHashTable *results;
+  GError *error = NULL;
+  gchar *contents, **lines;
+  gint i;
+
+  if (!g_file_get_contents (filename, &contents, NULL, &error)) {
+    g_printerr ("could not read %s: %s\n", filename, error->message);
+    g_error_free (error);
+    return NULL;
+  }
+
+  results = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  lines = g_strsplit (contents, "\n", -1);
+  for (i = 0; lines[i]; i++) {
+    const gchar *name, *end;
+    Result *result;
+
+    name = strstr (lines[i], "\"name\": \"");
+    if (name == NULL)
+      continue;
+    name += strlen ("\"name\": \"");
+    if ((end = strchr (name, '"')) == NULL)
+      continue;
+
+    result = g_new0 (Result, 1);
+    if (!parse_field (lines[i], "wall-median", &result->wall.median) ||
+        !parse_field (lines[i], "cpu-median", &result->cpu.median)) {
+      g_free (result);
+      continue;
+    }
+    g_hash_table_insert (results, g_strndup (name, end - name), result);
+  }
+  g_strfreev (lines);
+  g_free (contents);
+
+  return results;
+}
+
+static gboolean
+check_regression (const gchar * name, const gchar * what, GstClockTime base,
+    GstClockTime now)
+{
+  gdouble change;
+
+  if (base == 0)
+    return FALSE;
+
+  change = 100.0 * ((gdouble) now - (gdouble) base) / base;
+  g_printerr ("%-16s %-4s %" GST_TIME_FORMAT " -> %" GST_TIME_FORMAT
+      " (%+.1f%%)%s\n", name, what, GST_TIME_ARGS (base), GST_TIME_ARGS (now),
+      change, change > threshold ? "  REGRESSION" : "");
+
+  return change > threshold;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GOptionContext *ctx;
+  GError *error = NULL;
+  GArray *results;
+  GString *json;
+  gchar *dir;
+  gboolean failed = FALSE, regressed = FALSE;
+  guint i;
+  gint j;
+
+  ctx = g_option_context_new ("[BENCHMARK...]");
+  g_option_context_set_summary (ctx, "Runs the GStreamer benchmarks with "
+      "warmup and repetitions and reports the wall and CPU times as JSON.");
+  g_option_context_add_main_entries (ctx, options, NULL);
+  g_option_context_add_group (ctx, gst_init_get_option_group ());
+  if (!g_option_context_parse (ctx, &argc, &argv, &error)) {
+    g_printerr ("Error initializing: %s\n", error->message);
+    g_error_free (error);
+    return 2;
+  }
+  g_option_context_free (ctx);
+
+  if (warmup < 0 || repetitions < 1) {
+    g_printerr ("need at least one repetition\n");
+    return 2;
+  }
+
+  /* the benchmarks live next to us */
+  dir = g_path_get_dirname (argv[0]);
+  results = g_array_new (FALSE, TRUE, sizeof (Result));
+
+  for (i = 0; i < G_N_ELEMENTS (suite); i++) {
+    Result result = { NULL, };
+
+    /* only run the benchmarks named on the command line, if any */
+    if (argc > 1) {
+      for (j = 1; j < argc; j++)
+        if (strcmp (argv[j], suite[i].name) == 0)
+          break;
+      if (j == argc)
+        continue;
+    }
+
+    g_printerr ("running %s %s\n", suite[i].name, suite[i].args);
+    if (run_benchmark (dir, &suite[i], &result))
+      g_array_append_val (results, result);
+    else
+      failed = TRUE;
+  }
+  g_free (dir);
+
+  json = g_string_new ("{\n");
+  g_string_append_printf (json, "  \"version\": \"%s\",\n",
+      gst_version_string ());
+  g_string_append_printf (json, "  \"warmup\": %d,\n  \"repetitions\": %d,\n",
+      warmup, repetitions);
+  g_string_append (json, "  \"benchmarks\": [\n");
+  for (i = 0; i < results->len; i++)
+    write_result (json, &g_array_index (results, Result, i),
+        i + 1 == results->len);
+  g_string_append (json, "  ]\n}\n");
+
+  if (output) {
+    if (!g_file_set_contents (output, json->str, json->len, &error)) {
+      g_printerr ("could not write %s: %s\n", output, error->message);
+      g_error_free (error);
+      failed = TRUE;
+    }
+  } else {
+    g_print ("%s", json->str);
+  }
+  g_string_free (json, TRUE);
+
+  if (compare) {
+    GHashTable *baseline;
+
+    if ((baseline = load_results (compare))) {
+      for (i = 0; i < results->len; i++) {
+        Result *now = &g_array_index (results, Result, i);
+        Result *base = g_hash_table_lookup (baseline, now->name);
+
+        if (base == NULL) {
+          g_printerr ("%-16s not in %s\n", now->name, compare);
+          continue;
+        }
+        regressed |= check_regression (now->name, "wall", base->wall.median,
+            now->wall.median);
+        regressed |= check_regression (now->name, "cpu", base->cpu.median,
+            now->cpu.median);
+      }
+      g_hash_table_destroy (baseline);
+    } else {
+      failed = TRUE;
+    }
+  }
+
+  for (i = 0; i < results->len; i++)
+    g_free (g_array_index (results, Result, i).name);
+  g_array_free (results, TRUE);
+
+  if (failed)
+    return 2;
+  return regressed ? 1 : 0;
+}
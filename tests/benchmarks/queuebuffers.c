@@ -0,0 +1,85 @@
+/* GStreamer
+ *
+ * queuebuffers.c: pass small buffers from one thread to another through a queue
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* Buffers without data are created in the fakesrc thread and released in the
+ * fakesink thread behind the queue, so the measured time is dominated by the
+ * cost of allocating, handing over and freeing buffer instances. */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define BUFFER_COUNT (1000000)
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *error = NULL;
+  gchar *desc;
+  guint buffers = BUFFER_COUNT;
+  GstClockTime start, end;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    buffers = atoi (argv[1]);
+
+  desc = g_strdup_printf ("fakesrc num-buffers=%u sizetype=empty ! queue ! "
+      "fakesink sync=FALSE", buffers);
+  pipeline = gst_parse_launch (desc, &error);
+  if (pipeline == NULL) {
+    g_print ("could not create \"%s\": %s\n", desc,
+        error ? error->message : "unknown error");
+    exit (1);
+  }
+  if (error)
+    g_error_free (error);
+  g_free (desc);
+
+  start = gst_util_get_timestamp ();
+
+  if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_print ("pipeline doesn't want to play, aborting...\n");
+    exit (1);
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR) {
+    g_print ("pipeline posted an error, aborting...\n");
+    exit (1);
+  }
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  end = gst_util_get_timestamp ();
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  g_print ("%" GST_TIME_FORMAT " - passing %u buffers through a queue: "
+      "%.0f buffers/s\n", GST_TIME_ARGS (end - start), buffers,
+      (gdouble) buffers * GST_SECOND / MAX (end - start, 1));
+
+  return 0;
+}
@@ -0,0 +1,156 @@
+/* GStreamer
+ *
+ * seeklatency.c: measure the time from a flushing seek to the first buffer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/* The identity elements sleep for every buffer to simulate slow processing.
+ * When a flush does not interrupt those sleeps, every seek has to wait for the
+ * buffers in flight to finish first. Run with GST_DEBUG=GST_PERFORMANCE:5 to
+ * see the latency as seen by every pad. */
+
+#include <stdlib.h>
+#include <gst/gst.h>
+
+#define SEEK_COUNT (20)
+#define SLEEP_TIME (100000)
+
+static GMutex *lock;
+static GCond *cond;
+static gboolean waiting = FALSE;
+static gboolean flushed = FALSE;
+static GstClockTime first = GST_CLOCK_TIME_NONE;
+
+/* buffers that reach the sink before the FLUSH_STOP of the seek were already
+ * in flight and are not counted */
+static gboolean
+flush_probe (GstPad * pad, GstEvent * event, gpointer data)
+{
+  if (GST_EVENT_TYPE (event) == GST_EVENT_FLUSH_STOP) {
+    g_mutex_lock (lock);
+    if (waiting)
+      flushed = TRUE;
+    g_mutex_unlock (lock);
+  }
+  return TRUE;
+}
+
+static void
+handoff (GstElement * sink, GstBuffer * buffer, GstPad * pad, gpointer data)
+{
+  g_mutex_lock (lock);
+  if (waiting && flushed) {
+    first = gst_util_get_timestamp ();
+    waiting = FALSE;
+    g_cond_signal (cond);
+  }
+  g_mutex_unlock (lock);
+}
+
+static GstClockTime
+seek (GstElement * pipeline, gint64 position)
+{
+  GstClockTime start;
+
+  /* arm before seeking, the first new buffer can reach the sink before the
+   * seek returns */
+  g_mutex_lock (lock);
+  waiting = TRUE;
+  flushed = FALSE;
+  g_mutex_unlock (lock);
+
+  start = gst_util_get_timestamp ();
+  if (!gst_element_seek_simple (pipeline, GST_FORMAT_BYTES,
+          GST_SEEK_FLAG_FLUSH, position)) {
+    g_print ("seek failed, aborting...\n");
+    exit (1);
+  }
+
+  g_mutex_lock (lock);
+  while (waiting)
+    g_cond_wait (cond, lock);
+  g_mutex_unlock (lock);
+
+  return first - start;
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GstElement *pipeline, *sink;
+  GstPad *pad;
+  GError *error = NULL;
+  gchar *desc;
+  guint seeks = SEEK_COUNT, sleep_time = SLEEP_TIME, i;
+  GstClockTime latency, total = 0, max = 0;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    seeks = atoi (argv[1]);
+  if (argc > 2)
+    sleep_time = atoi (argv[2]);
+
+  lock = g_mutex_new ();
+  cond = g_cond_new ();
+
+  desc = g_strdup_printf ("fakesrc can-activate-pull=TRUE sizetype=fixed "
+      "sizemax=4096 ! identity sleep-time=%u ! queue ! identity sleep-time=%u "
+      "! fakesink name=sink sync=FALSE signal-handoffs=TRUE", sleep_time,
+      sleep_time);
+  pipeline = gst_parse_launch (desc, &error);
+  if (pipeline == NULL) {
+    g_print ("could not create \"%s\": %s\n", desc,
+        error ? error->message : "unknown error");
+    exit (1);
+  }
+  if (error)
+    g_error_free (error);
+  g_free (desc);
+
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff), NULL);
+  pad = gst_element_get_static_pad (sink, "sink");
+  gst_pad_add_event_probe (pad, G_CALLBACK (flush_probe), NULL);
+  gst_object_unref (pad);
+  gst_object_unref (sink);
+
+  if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE) {
+    g_print ("pipeline doesn't want to play, aborting...\n");
+    exit (1);
+  }
+  gst_element_get_state (pipeline, NULL, NULL, GST_CLOCK_TIME_NONE);
+
+  for (i = 0; i < seeks; i++) {
+    latency = seek (pipeline, (gint64) i * 4096);
+    total += latency;
+    max = MAX (max, latency);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+
+  g_print ("%u seeks with %u us sleep per element: average %" GST_TIME_FORMAT
+      ", max %" GST_TIME_FORMAT "\n", seeks, sleep_time,
+      GST_TIME_ARGS (seeks ? total / seeks : 0), GST_TIME_ARGS (max));
+
+  g_mutex_free (lock);
+  g_cond_free (cond);
+
+  return 0;
+}
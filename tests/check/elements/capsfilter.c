@@ -78,6 +78,73 @@ GST_START_TEST (test_unfixed_downstream_caps)
 
 GST_END_TEST;
 
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GST_START_TEST (test_implicit_caps)
+{
+  GstElement *filter;
+  GstCaps *filter_caps;
+  GstPad *mysrcpad, *mysinkpad;
+  GstBuffer *buffer, *out;
+
+  filter = gst_check_setup_element ("capsfilter");
+  filter_caps = gst_caps_from_string ("audio/x-raw-int, channels=(int)1, "
+      "rate=(int)44100");
+  g_object_set (filter, "caps", filter_caps, NULL);
+
+  mysrcpad = gst_check_setup_src_pad (filter, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (filter, &sinktemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless_equals_int (gst_element_set_state (filter, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  /* the first buffer without caps gets the filter caps */
+  buffer = gst_buffer_new_and_alloc (4);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  out = GST_BUFFER_CAST (buffers->data);
+  fail_unless (GST_BUFFER_CAPS (out) != NULL);
+  fail_unless (gst_caps_is_equal (GST_BUFFER_CAPS (out), filter_caps));
+  fail_unless (GST_PAD_CAPS (mysinkpad) == GST_BUFFER_CAPS (out));
+
+  /* by default every buffer carries the caps, even when downstream knows
+   * them already */
+  buffer = gst_buffer_new_and_alloc (4);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  out = GST_BUFFER_CAST (buffers->next->data);
+  fail_unless (GST_BUFFER_CAPS (out) == GST_PAD_CAPS (mysinkpad));
+
+  /* with implicit caps, a shared buffer without caps is passed on without
+   * being copied */
+  g_object_set (filter, "implicit-caps", TRUE, NULL);
+  buffer = gst_buffer_new_and_alloc (4);
+  gst_buffer_ref (buffer);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  out = GST_BUFFER_CAST (buffers->next->next->data);
+  fail_unless (out == buffer);
+  fail_unless (GST_BUFFER_CAPS (out) == NULL);
+  gst_buffer_unref (buffer);
+
+  /* cleanup */
+  gst_check_drop_buffers ();
+  gst_element_set_state (filter, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (filter);
+  gst_check_teardown_sink_pad (filter);
+  gst_check_teardown_element (filter);
+  gst_caps_unref (filter_caps);
+}
+
+GST_END_TEST;
+
 static Suite *
 capsfilter_suite (void)
 {
@@ -86,6 +153,7 @@ capsfilter_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_unfixed_downstream_caps);
+  tcase_add_test (tc_chain, test_implicit_caps);
 
   return s;
 }
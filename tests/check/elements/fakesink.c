@@ -966,6 +966,67 @@ GST_START_TEST (test_notify_race)
 
 GST_END_TEST;
 
+GST_START_TEST (test_stats)
+{
+  GstElement *pipeline, *sink;
+  GstStructure *stats = NULL;
+  GstMessage *msg;
+  GstBus *bus;
+  guint64 buffers, bytes, min, p50, max;
+
+  pipeline = gst_parse_launch ("fakesrc num-buffers=20 sizetype=fixed "
+      "sizemax=100 ! fakesink name=sink collect-stats=true", NULL);
+  fail_unless (pipeline != NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  fail_unless (sink != NULL);
+  bus = gst_element_get_bus (pipeline);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+
+  /* the statistics are posted before the EOS message */
+  msg = gst_bus_poll (bus, GST_MESSAGE_ELEMENT | GST_MESSAGE_EOS, -1);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_ELEMENT);
+  fail_unless (GST_MESSAGE_SRC (msg) == GST_OBJECT (sink));
+  fail_unless (gst_structure_has_name (msg->structure, "GstFakeSinkStats"));
+  fail_unless (gst_structure_get_uint64 (msg->structure, "buffers", &buffers));
+  fail_unless (gst_structure_get_uint64 (msg->structure, "bytes", &bytes));
+  fail_unless_equals_uint64 (buffers, 20);
+  fail_unless_equals_uint64 (bytes, 20 * 100);
+  gst_message_unref (msg);
+
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS, -1);
+  gst_message_unref (msg);
+
+  /* the property returns the same numbers */
+  g_object_get (sink, "stats", &stats, NULL);
+  fail_unless (stats != NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "buffers", &buffers));
+  fail_unless_equals_uint64 (buffers, 20);
+  fail_unless (gst_structure_get_uint64 (stats, "interval-count", &buffers));
+  fail_unless_equals_uint64 (buffers, 19);
+  fail_unless (gst_structure_get_uint64 (stats, "interval-min", &min));
+  fail_unless (gst_structure_get_uint64 (stats, "interval-p50", &p50));
+  fail_unless (gst_structure_get_uint64 (stats, "interval-max", &max));
+  fail_unless (min <= p50 && p50 <= max);
+  gst_structure_free (stats);
+
+  /* going back to PAUSED clears the statistics */
+  gst_element_set_state (pipeline, GST_STATE_READY);
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  g_object_get (sink, "stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint64 (stats, "buffers", &buffers));
+  fail_unless_equals_uint64 (buffers, 0);
+  gst_structure_free (stats);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (bus);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 static Suite *
 fakesink_suite (void)
 {
@@ -981,6 +1042,7 @@ fakesink_suite (void)
   tcase_add_test (tc_chain, test_eos2);
   tcase_add_test (tc_chain, test_position);
   tcase_add_test (tc_chain, test_notify_race);
+  tcase_add_test (tc_chain, test_stats);
 
   return s;
 }
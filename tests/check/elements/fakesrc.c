@@ -209,6 +209,105 @@ GST_START_TEST (test_sizetype_random)
 
 GST_END_TEST;
 
+GST_START_TEST (test_data_ring)
+{
+  GstElement *src;
+  GList *l;
+  guint i;
+
+  src = setup_fakesrc ();
+
+  g_object_set (G_OBJECT (src), "data", 3, "ring-size", 2, "sizetype", 2,
+      "sizemax", 64, "filltype", 4, "buffer-rate", 25, "num-buffers", 6, NULL);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  while (!have_eos) {
+    g_usleep (1000);
+  }
+
+  fail_unless_equals_int (g_list_length (buffers), 6);
+  for (l = buffers, i = 0; l; l = l->next, i++) {
+    GstBuffer *buf = l->data;
+    GstBuffer *ring_buf = g_list_nth_data (buffers, i % 2);
+
+    fail_unless_equals_int (GST_BUFFER_SIZE (buf), 64);
+    /* the data is generated once and shared by the whole ring cycle */
+    fail_unless (GST_BUFFER_DATA (buf) == GST_BUFFER_DATA (ring_buf));
+    fail_unless_equals_int (GST_BUFFER_DATA (buf)[63], 63);
+    fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buf), i * GST_SECOND / 25);
+    fail_unless_equals_uint64 (GST_BUFFER_DURATION (buf), GST_SECOND / 25);
+  }
+  gst_check_drop_buffers ();
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  /* cleanup */
+  cleanup_fakesrc (src);
+}
+
+GST_END_TEST;
+
+static guint8 *ring_data[6];
+static gboolean ring_parent[6];
+static guint ring_count;
+
+static GstFlowReturn
+ring_chain_func (GstPad * pad, GstBuffer * buffer)
+{
+  if (ring_count < G_N_ELEMENTS (ring_data)) {
+    ring_data[ring_count] = GST_BUFFER_DATA (buffer);
+    /* sub-buffers do not own their data */
+    ring_parent[ring_count] = GST_BUFFER_MALLOCDATA (buffer) != NULL;
+  }
+  ring_count++;
+  gst_buffer_unref (buffer);
+
+  return GST_FLOW_OK;
+}
+
+GST_START_TEST (test_data_ring_reuse)
+{
+  GstElement *src;
+  guint i;
+
+  src = setup_fakesrc ();
+  gst_pad_set_chain_function (mysinkpad, ring_chain_func);
+  ring_count = 0;
+
+  g_object_set (G_OBJECT (src), "data", 3, "ring-size", 2, "sizetype", 2,
+      "sizemax", 64, "num-buffers", 6, NULL);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  while (!have_eos) {
+    g_usleep (1000);
+  }
+
+  /* every buffer was released before its turn came again, so the ring
+   * buffers themselves are pushed instead of sub-buffers. The first one is
+   * copied by basesrc to mark it DISCONT. */
+  fail_unless_equals_int (ring_count, 6);
+  for (i = 1; i < 6; i++)
+    fail_unless (ring_parent[i], "buffer %u is a sub-buffer", i);
+  for (i = 2; i < 6; i++)
+    fail_unless (ring_data[i] == ring_data[i - 2]);
+  fail_if (ring_data[0] == ring_data[1]);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  /* cleanup */
+  cleanup_fakesrc (src);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_no_preroll)
 {
   GstElement *src;
@@ -248,6 +347,8 @@ fakesrc_suite (void)
   tcase_add_test (tc_chain, test_sizetype_empty);
   tcase_add_test (tc_chain, test_sizetype_fixed);
   tcase_add_test (tc_chain, test_sizetype_random);
+  tcase_add_test (tc_chain, test_data_ring);
+  tcase_add_test (tc_chain, test_data_ring_reuse);
   tcase_add_test (tc_chain, test_no_preroll);
 
   return s;
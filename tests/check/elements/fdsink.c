@@ -0,0 +1,144 @@
+/* GStreamer
+ *
+ * unit test for fdsink
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <unistd.h>
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+GST_START_TEST (test_write)
+{
+  GstElement *fdsink;
+  GstPad *mysrcpad;
+  GstBuffer *buf;
+  guint8 result[4096];
+  gint fd[2];
+
+  fail_if (pipe (fd) < 0);
+
+  fdsink = gst_check_setup_element ("fdsink");
+  g_object_set (fdsink, "fd", fd[1], NULL);
+  mysrcpad = gst_check_setup_src_pad (fdsink, &srctemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  fail_if (gst_element_set_state (fdsink,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  buf = gst_buffer_new_and_alloc (sizeof (result));
+  memset (GST_BUFFER_DATA (buf), 'a', sizeof (result));
+  fail_unless (gst_pad_push (mysrcpad, buf) == GST_FLOW_OK);
+  fail_unless (read (fd[0], result, sizeof (result)) == sizeof (result));
+  fail_unless (result[0] == 'a' && result[sizeof (result) - 1] == 'a');
+
+  fail_unless (gst_element_set_state (fdsink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (fdsink);
+  gst_check_teardown_element (fdsink);
+
+  close (fd[0]);
+  close (fd[1]);
+}
+
+GST_END_TEST;
+
+#ifdef HAVE_VMSPLICE
+
+GST_START_TEST (test_vmsplice)
+{
+  GstElement *fdsink;
+  GstPad *mysrcpad;
+  GstBuffer *buf;
+  guint8 *data;
+  guint8 result[4096];
+  gint fd[2];
+
+  fail_if (pipe (fd) < 0);
+
+  fdsink = gst_check_setup_element ("fdsink");
+  g_object_set (fdsink, "fd", fd[1], "vmsplice", TRUE, NULL);
+  mysrcpad = gst_check_setup_src_pad (fdsink, &srctemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  fail_if (gst_element_set_state (fdsink,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  fail_unless (gst_pad_alloc_buffer (mysrcpad, 0, sizeof (result), NULL,
+          &buf) == GST_FLOW_OK);
+  data = GST_BUFFER_DATA (buf);
+  fail_unless ((gsize) data % getpagesize () == 0);
+  memset (data, 'a', sizeof (result));
+
+  /* the pipe references the pages of the buffer instead of a copy of them,
+   * so the reader sees what is written into them after the push */
+  fail_unless (gst_pad_push (mysrcpad, gst_buffer_ref (buf)) == GST_FLOW_OK);
+  memset (data, 'b', sizeof (result));
+  fail_unless (read (fd[0], result, sizeof (result)) == sizeof (result));
+  fail_unless (result[0] == 'b' && result[sizeof (result) - 1] == 'b');
+  gst_buffer_unref (buf);
+
+  /* the reader consumed the pages, so they are recycled */
+  fail_unless (gst_pad_alloc_buffer (mysrcpad, 0, sizeof (result), NULL,
+          &buf) == GST_FLOW_OK);
+  fail_unless (GST_BUFFER_DATA (buf) == data);
+
+  /* but not while the pipe still references them */
+  fail_unless (gst_pad_push (mysrcpad, buf) == GST_FLOW_OK);
+  fail_unless (gst_pad_alloc_buffer (mysrcpad, 0, sizeof (result), NULL,
+          &buf) == GST_FLOW_OK);
+  fail_if (GST_BUFFER_DATA (buf) == data);
+  gst_buffer_unref (buf);
+
+  fail_unless (gst_element_set_state (fdsink,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (fdsink);
+  gst_check_teardown_element (fdsink);
+
+  close (fd[0]);
+  close (fd[1]);
+}
+
+GST_END_TEST;
+#endif
+
+static Suite *
+fdsink_suite (void)
+{
+  Suite *s = suite_create ("fdsink");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_write);
+#ifdef HAVE_VMSPLICE
+  tcase_add_test (tc_chain, test_vmsplice);
+#endif
+
+  return s;
+}
+
+GST_CHECK_MAIN (fdsink);
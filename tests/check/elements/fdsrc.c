@@ -20,6 +20,10 @@
  * Boston, MA 02111-1307, USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -109,6 +113,55 @@ GST_START_TEST (test_num_buffers)
 
 GST_END_TEST;
 
+GST_START_TEST (test_adaptive_blocksize)
+{
+  GstElement *src;
+  gint pipe_fd[2];
+  gchar data[48 * 1024];
+  GList *l;
+  guint expected[] = { 4096, 8192, 16384, 16384 };
+  guint i;
+
+#ifndef G_OS_WIN32
+  fail_if (pipe (pipe_fd) < 0);
+#else
+  fail_if (_pipe (pipe_fd, 2048, _O_BINARY) < 0);
+#endif
+
+  /* have plenty of data waiting so that every read fills its buffer */
+  memset (data, 0, sizeof (data));
+  fail_if (write (pipe_fd[1], data, sizeof (data)) < 0);
+
+  src = setup_fdsrc ();
+  g_object_set (G_OBJECT (src), "num-buffers", 4, "blocksize", 4096,
+      "adaptive-blocksize", TRUE, "max-blocksize", 16384, NULL);
+  g_object_set (G_OBJECT (src), "fd", pipe_fd[0], NULL);
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  while (!have_eos)
+    g_usleep (1000);
+
+  fail_unless_equals_int (g_list_length (buffers), 4);
+  for (l = buffers, i = 0; l; l = l->next, i++)
+    fail_unless_equals_int (GST_BUFFER_SIZE (l->data), expected[i]);
+
+  fail_unless (gst_element_set_state (src,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+
+  /* cleanup */
+  cleanup_fdsrc (src);
+  close (pipe_fd[0]);
+  close (pipe_fd[1]);
+  g_list_foreach (buffers, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (buffers);
+  buffers = NULL;
+  have_eos = FALSE;
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_nonseeking)
 {
   GstElement *src;
@@ -188,6 +241,67 @@ GST_START_TEST (test_seeking)
 
 GST_END_TEST;
 
+GST_START_TEST (test_buffer_alloc_relay)
+{
+  GstElement *pipeline;
+  GstBus *bus;
+  GstMessage *msg;
+  gint in_fd[2], out_fd[2];
+  guint8 data[16384], result[16384];
+  gchar *desc;
+  guint i, n;
+
+#ifndef G_OS_WIN32
+  fail_if (pipe (in_fd) < 0);
+  fail_if (pipe (out_fd) < 0);
+#else
+  fail_if (_pipe (in_fd, 2048, _O_BINARY) < 0);
+  fail_if (_pipe (out_fd, 2048, _O_BINARY) < 0);
+#endif
+
+  for (i = 0; i < sizeof (data); i++)
+    data[i] = i % 251;
+
+  /* the relay must produce the same bytes, whether fdsink manages to
+   * vmsplice them or falls back to write */
+  desc = g_strdup_printf ("fdsrc fd=%d blocksize=4096 use-buffer-alloc=true ! "
+      "fdsink fd=%d vmsplice=true", in_fd[0], out_fd[1]);
+  pipeline = gst_parse_launch (desc, NULL);
+  g_free (desc);
+  fail_unless (pipeline != NULL);
+
+  fail_unless (write (in_fd[1], data, sizeof (data)) == sizeof (data));
+  close (in_fd[1]);
+
+  fail_if (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_FAILURE);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  gst_object_unref (pipeline);
+  close (out_fd[1]);
+
+  n = 0;
+  while (n < sizeof (result)) {
+    gint ret = read (out_fd[0], result + n, sizeof (result) - n);
+
+    fail_unless (ret > 0);
+    n += ret;
+  }
+  fail_unless (memcmp (data, result, sizeof (data)) == 0);
+
+  close (in_fd[0]);
+  close (out_fd[0]);
+}
+
+GST_END_TEST;
+
 static Suite *
 fdsrc_suite (void)
 {
@@ -196,8 +310,10 @@ fdsrc_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_num_buffers);
+  tcase_add_test (tc_chain, test_adaptive_blocksize);
   tcase_add_test (tc_chain, test_nonseeking);
   tcase_add_test (tc_chain, test_seeking);
+  tcase_add_test (tc_chain, test_buffer_alloc_relay);
 
   return s;
 }
@@ -24,6 +24,7 @@
 #endif
 
 #include <stdio.h>
+#include <string.h>
 
 #include <glib.h>
 #include <glib/gstdio.h>
@@ -33,6 +34,7 @@
 #endif
 
 #include <gst/check/gstcheck.h>
+#include <gst/base/gstbasesink.h>
 
 static GstPad *mysrcpad;
 
@@ -211,6 +213,110 @@ GST_START_TEST (test_seeking)
 
 GST_END_TEST;
 
+static GstFlowReturn (*parent_render) (GstBaseSink * sink, GstBuffer * buffer);
+static guint render_count;
+
+static GstFlowReturn
+counting_render (GstBaseSink * sink, GstBuffer * buffer)
+{
+  render_count++;
+
+  return parent_render (sink, buffer);
+}
+
+GST_START_TEST (test_buffer_list)
+{
+  const gchar *tmpdir;
+  GstElement *filesink;
+  GstBaseSinkClass *sink_class;
+  GstBufferList *list;
+  GstBufferListIterator *it;
+  GstBuffer *buf;
+  gchar *tmp_fn, *data = NULL;
+  gsize len;
+  gint fd, i, j;
+
+  tmpdir = g_get_tmp_dir ();
+  if (tmpdir == NULL)
+    return;
+
+  tmp_fn = g_build_filename (tmpdir, "gstreamer-filesink-test-XXXXXX", NULL);
+  fd = g_mkstemp (tmp_fn);
+  if (fd < 0) {
+    GST_ERROR ("can't create temp file %s: %s", tmp_fn, g_strerror (errno));
+    g_free (tmp_fn);
+    return;
+  }
+  close (fd);
+
+  filesink = setup_filesink ();
+  g_object_set (filesink, "location", tmp_fn, NULL);
+
+  /* count the buffers that are rendered one by one */
+  sink_class = GST_BASE_SINK_GET_CLASS (filesink);
+  parent_render = sink_class->render;
+  sink_class->render = counting_render;
+  render_count = 0;
+
+  fail_unless_equals_int (gst_element_set_state (filesink, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_ASYNC);
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_BYTES, 0, -1, 0)));
+
+  /* a small buffer first so that the list has to be written after it */
+  PUSH_BYTES (10);
+  fail_unless_equals_int (render_count, 1);
+  CHECK_QUERY_POSITION (filesink, GST_FORMAT_BYTES, 10);
+
+  /* groups of a small header and a larger payload, written without merging */
+  list = gst_buffer_list_new ();
+  it = gst_buffer_list_iterate (list);
+  for (i = 0; i < 4; i++) {
+    gst_buffer_list_iterator_add_group (it);
+    buf = gst_buffer_new_and_alloc (12);
+    memset (GST_BUFFER_DATA (buf), 'h', 12);
+    gst_buffer_list_iterator_add (it, buf);
+    buf = gst_buffer_new_and_alloc (10000);
+    memset (GST_BUFFER_DATA (buf), '0' + i, 10000);
+    gst_buffer_list_iterator_add (it, buf);
+  }
+  gst_buffer_list_iterator_free (it);
+
+  fail_unless_equals_int (gst_pad_push_list (mysrcpad, list), GST_FLOW_OK);
+  CHECK_QUERY_POSITION (filesink, GST_FORMAT_BYTES, 10 + 4 * 10012);
+#if defined (HAVE_WRITEV) && defined (HAVE_SYS_UIO_H)
+  /* the list is larger than the stdio buffer and written with writev() */
+  fail_unless_equals_int (render_count, 1);
+#else
+  fail_unless_equals_int (render_count, 1 + 8);
+#endif
+
+  PUSH_BYTES (10);
+  fail_unless (gst_pad_push_event (mysrcpad, gst_event_new_eos ()));
+
+  fail_unless_equals_int (gst_element_set_state (filesink, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  sink_class->render = parent_render;
+  cleanup_filesink (filesink);
+
+  fail_unless (g_file_get_contents (tmp_fn, &data, &len, NULL));
+  fail_unless_equals_int (len, 20 + 4 * 10012);
+  for (i = 0; i < 4; i++) {
+    guint8 *group = (guint8 *) data + 10 + i * 10012;
+
+    for (j = 0; j < 12; j++)
+      fail_unless_equals_int (group[j], 'h');
+    for (j = 12; j < 10012; j++)
+      fail_unless_equals_int (group[j], '0' + i);
+  }
+  g_free (data);
+
+  g_remove (tmp_fn);
+  g_free (tmp_fn);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_coverage)
 {
   GstElement *filesink;
@@ -308,6 +414,7 @@ filesink_suite (void)
   tcase_add_test (tc_chain, test_coverage);
   tcase_add_test (tc_chain, test_uri_interface);
   tcase_add_test (tc_chain, test_seeking);
+  tcase_add_test (tc_chain, test_buffer_list);
 
   return s;
 }
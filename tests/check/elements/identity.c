@@ -112,6 +112,118 @@ GST_START_TEST (test_one_buffer)
 
 GST_END_TEST;
 
+/* set when identity is about to wait on the buffer pushed by push_thread */
+static GMutex *handoff_lock;
+static GCond *handoff_cond;
+static gboolean have_handoff;
+
+static void
+handoff_cb (GstElement * identity, GstBuffer * buffer, gpointer data)
+{
+  g_mutex_lock (handoff_lock);
+  have_handoff = TRUE;
+  g_cond_signal (handoff_cond);
+  g_mutex_unlock (handoff_lock);
+}
+
+static gpointer
+push_thread (GstBuffer * buffer)
+{
+  return GINT_TO_POINTER (gst_pad_push (mysrcpad, buffer));
+}
+
+/* push @buffer from another thread, flush while identity is waiting on it and
+ * check that the wait ends at once with WRONG_STATE */
+static void
+check_flush_interrupts (GstElement * identity, GstBuffer * buffer)
+{
+  GThread *thread;
+  GTimer *timer;
+  GstFlowReturn ret;
+
+  handoff_lock = g_mutex_new ();
+  handoff_cond = g_cond_new ();
+  have_handoff = FALSE;
+  g_signal_connect (identity, "handoff", G_CALLBACK (handoff_cb), NULL);
+  g_object_set (identity, "signal-handoffs", TRUE, NULL);
+
+  timer = g_timer_new ();
+  thread = g_thread_create ((GThreadFunc) push_thread, buffer, TRUE, NULL);
+
+  g_mutex_lock (handoff_lock);
+  while (!have_handoff)
+    g_cond_wait (handoff_cond, handoff_lock);
+  g_mutex_unlock (handoff_lock);
+
+  gst_pad_push_event (mysrcpad, gst_event_new_flush_start ());
+  ret = GPOINTER_TO_INT (g_thread_join (thread));
+  fail_unless_equals_int (ret, GST_FLOW_WRONG_STATE);
+  fail_unless (g_timer_elapsed (timer, NULL) < 5.0);
+  fail_unless (buffers == NULL);
+  gst_pad_push_event (mysrcpad, gst_event_new_flush_stop ());
+
+  g_timer_destroy (timer);
+  g_cond_free (handoff_cond);
+  g_mutex_free (handoff_lock);
+}
+
+GST_START_TEST (test_flush_sleep)
+{
+  GstElement *identity;
+
+  identity = setup_identity ();
+  g_object_set (identity, "sleep-time", 60 * G_USEC_PER_SEC, NULL);
+  fail_unless (gst_element_set_state (identity,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  check_flush_interrupts (identity, gst_buffer_new_and_alloc (4));
+
+  /* after the flush the buffers flow again */
+  g_object_set (identity, "sleep-time", 0, NULL);
+  fail_unless_equals_int (gst_pad_push (mysrcpad,
+          gst_buffer_new_and_alloc (4)), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 1);
+
+  gst_check_drop_buffers ();
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_flush_sync)
+{
+  GstElement *identity;
+  GstClock *clock;
+  GstBuffer *buffer;
+
+  identity = setup_identity ();
+  g_object_set (identity, "sync", TRUE, NULL);
+
+  clock = gst_system_clock_obtain ();
+  gst_element_set_clock (identity, clock);
+  fail_unless (gst_element_set_state (identity,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+  gst_element_set_base_time (identity, gst_clock_get_time (clock));
+
+  /* identity only syncs in a TIME segment */
+  gst_pad_push_event (mysrcpad,
+      gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_TIME, 0, -1, 0));
+
+  /* a buffer that is due in an hour */
+  buffer = gst_buffer_new_and_alloc (4);
+  GST_BUFFER_TIMESTAMP (buffer) = 3600 * GST_SECOND;
+  check_flush_interrupts (identity, buffer);
+
+  gst_element_set_state (identity, GST_STATE_NULL);
+  gst_element_set_clock (identity, NULL);
+  gst_object_unref (clock);
+  cleanup_identity (identity);
+}
+
+GST_END_TEST;
+
 static Suite *
 identity_suite (void)
 {
@@ -120,6 +232,8 @@ identity_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_one_buffer);
+  tcase_add_test (tc_chain, test_flush_sleep);
+  tcase_add_test (tc_chain, test_flush_sync);
 
   return s;
 }
@@ -326,6 +326,132 @@ GST_START_TEST (test_leaky_downstream)
 
 GST_END_TEST;
 
+static GList *events = NULL;
+
+static gboolean
+event_func (GstPad * pad, GstEvent * event)
+{
+  events = g_list_append (events, event);
+
+  return TRUE;
+}
+
+static void
+push_timed_buffer (GstClockTime timestamp, GstClockTime duration)
+{
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_and_alloc (4);
+  GST_BUFFER_TIMESTAMP (buffer) = timestamp;
+  GST_BUFFER_DURATION (buffer) = duration;
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+}
+
+#define fail_unless_level(queue, n_buffers, time) G_STMT_START {        \
+  guint _buffers;                                                       \
+  guint64 _time;                                                        \
+                                                                        \
+  g_object_get (G_OBJECT (queue), "current-level-buffers", &_buffers,   \
+      "current-level-time", &_time, NULL);                              \
+  fail_unless_equals_int (_buffers, n_buffers);                         \
+  fail_unless_equals_uint64 (_time, time);                              \
+} G_STMT_END
+
+/* leak by time with a NEWSEGMENT in the queue, the time level is measured
+ * in running time and the NEWSEGMENT events are never leaked */
+GST_START_TEST (test_leaky_downstream_time)
+{
+  GstElement *queue;
+  GstPad *srcpad;
+  GstBuffer *buffer;
+  GstEvent *event;
+  GstFormat format;
+  gint64 start;
+
+  queue = setup_queue ();
+  mysrcpad = gst_check_setup_src_pad (queue, &srctemplate, NULL);
+  g_object_set (G_OBJECT (queue), "leaky", 2, "max-size-buffers", 0,
+      "max-size-bytes", 0, "max-size-time", 3 * GST_SECOND, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  /* the queue is not linked yet, so nothing is pushed out */
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_TIME, 0, -1, 0)));
+  push_timed_buffer (0, GST_SECOND);
+  push_timed_buffer (GST_SECOND, GST_SECOND);
+  push_timed_buffer (2 * GST_SECOND, GST_SECOND);
+  fail_unless_level (queue, 3, 3 * GST_SECOND);
+  fail_unless_equals_int (overrun_count, 0);
+
+  /* the new segment continues at running time 3 seconds */
+  fail_unless (gst_pad_push_event (mysrcpad,
+          gst_event_new_new_segment (FALSE, 1.0, GST_FORMAT_TIME,
+              10 * GST_SECOND, -1, 10 * GST_SECOND)));
+  fail_unless_level (queue, 3, 3 * GST_SECOND);
+
+  /* the queue is full, the oldest buffer goes */
+  push_timed_buffer (10 * GST_SECOND, GST_SECOND);
+  fail_unless_level (queue, 3, 3 * GST_SECOND);
+  fail_unless_equals_int (overrun_count, 1);
+
+  /* the next buffer goes and this one overfills the queue */
+  push_timed_buffer (11 * GST_SECOND, 4 * GST_SECOND);
+  fail_unless_level (queue, 3, 6 * GST_SECOND);
+  fail_unless_equals_int (overrun_count, 2);
+
+  /* all three buffers have to go at once to get below 3 seconds */
+  push_timed_buffer (15 * GST_SECOND, GST_SECOND);
+  fail_unless_level (queue, 1, GST_SECOND);
+  fail_unless_equals_int (overrun_count, 3);
+
+  /* link now, the task starts and pushes the events and the last buffer */
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  gst_pad_set_event_function (mysinkpad, event_func);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  g_mutex_lock (check_mutex);
+  srcpad = gst_element_get_static_pad (queue, "src");
+  fail_unless (gst_pad_link (srcpad, mysinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (srcpad);
+  while (buffers == NULL)
+    g_cond_wait (check_cond, check_mutex);
+  g_mutex_unlock (check_mutex);
+
+  gst_pad_set_active (mysinkpad, FALSE);
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buffer = GST_BUFFER_CAST (buffers->data);
+  fail_unless_equals_uint64 (GST_BUFFER_TIMESTAMP (buffer), 15 * GST_SECOND);
+  fail_unless (GST_BUFFER_FLAG_IS_SET (buffer, GST_BUFFER_FLAG_DISCONT));
+
+  fail_unless_equals_int (g_list_length (events), 2);
+  event = GST_EVENT_CAST (events->data);
+  fail_unless_equals_int (GST_EVENT_TYPE (event), GST_EVENT_NEWSEGMENT);
+  gst_event_parse_new_segment (event, NULL, NULL, &format, &start, NULL, NULL);
+  fail_unless_equals_uint64 (start, 0);
+  event = GST_EVENT_CAST (events->next->data);
+  fail_unless_equals_int (GST_EVENT_TYPE (event), GST_EVENT_NEWSEGMENT);
+  gst_event_parse_new_segment (event, NULL, NULL, &format, &start, NULL, NULL);
+  fail_unless_equals_uint64 (start, 10 * GST_SECOND);
+
+  /* cleanup */
+  g_list_foreach (events, (GFunc) gst_mini_object_unref, NULL);
+  g_list_free (events);
+  events = NULL;
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (queue);
+  gst_check_teardown_sink_pad (queue);
+  cleanup_queue (queue);
+}
+
+GST_END_TEST;
+
 /* set queue size to 5 buffers
  * pull 1 buffer
  * check over/underuns
@@ -430,6 +556,626 @@ GST_START_TEST (test_time_level)
 
 GST_END_TEST;
 
+GST_START_TEST (test_memory_usage_query)
+{
+  GstElement *queue;
+  GstStructure *s;
+  GstQuery *query;
+  guint bytes = 1, buffers = 1;
+  gint priority = 0;
+  gboolean throttled = TRUE;
+
+  queue = setup_queue ();
+  g_object_set (G_OBJECT (queue), "memory-priority", 3, NULL);
+
+  query = gst_query_new_application (GST_QUERY_CUSTOM,
+      gst_structure_empty_new ("GstQueueMemoryUsage"));
+  fail_unless (gst_element_query (queue, query));
+
+  s = gst_query_get_structure (query);
+  fail_unless (gst_structure_get_uint (s, "bytes", &bytes));
+  fail_unless (gst_structure_get_uint (s, "buffers", &buffers));
+  fail_unless (gst_structure_get_int (s, "priority", &priority));
+  fail_unless (gst_structure_get_boolean (s, "throttled", &throttled));
+  fail_unless (gst_structure_has_field (s, "total-bytes"));
+  fail_unless (gst_structure_has_field (s, "limit"));
+
+  fail_unless_equals_int (bytes, 0);
+  fail_unless_equals_int (buffers, 0);
+  fail_unless_equals_int (priority, 3);
+  fail_if (throttled);
+
+  gst_query_unref (query);
+  cleanup_queue (queue);
+}
+
+GST_END_TEST;
+
+static void
+query_memory_usage (GstElement * queue, guint * bytes, gboolean * throttled)
+{
+  GstStructure *s;
+  GstQuery *query;
+
+  query = gst_query_new_application (GST_QUERY_CUSTOM,
+      gst_structure_empty_new ("GstQueueMemoryUsage"));
+  fail_unless (gst_element_query (queue, query));
+
+  s = gst_query_get_structure (query);
+  fail_unless (gst_structure_get_uint (s, "bytes", bytes));
+  fail_unless (gst_structure_get_boolean (s, "throttled", throttled));
+
+  gst_query_unref (query);
+}
+
+static GstElement *
+setup_memory_queue (gint leaky)
+{
+  GstElement *queue;
+
+  queue = setup_queue ();
+  g_object_set (G_OBJECT (queue), "leaky", leaky, "max-size-buffers", 0,
+      "max-size-bytes", 0, "max-size-time", (guint64) 0, NULL);
+
+  /* nothing is linked to the src pad, so the task never starts */
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  return queue;
+}
+
+static void
+push_sized_buffer (GstPad * pad, guint size)
+{
+  fail_unless_equals_int (gst_pad_push (pad, gst_buffer_new_and_alloc (size)),
+      GST_FLOW_OK);
+}
+
+/* a leaky queue over the process-wide budget leaks its oldest buffers */
+GST_START_TEST (test_memory_limit_leak)
+{
+  GstElement *queue;
+  GstBuffer *buffer1;
+  guint bytes;
+  gboolean throttled;
+
+  g_setenv ("GST_QUEUE_MEMORY_LIMIT", "1000", TRUE);
+
+  queue = setup_memory_queue (2);
+  mysrcpad = gst_check_setup_src_pad (queue, &srctemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  buffer1 = gst_buffer_new_and_alloc (400);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, gst_buffer_ref (buffer1)),
+      GST_FLOW_OK);
+  push_sized_buffer (mysrcpad, 400);
+  query_memory_usage (queue, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 800);
+  fail_if (throttled);
+
+  push_sized_buffer (mysrcpad, 400);
+  query_memory_usage (queue, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 1200);
+  fail_unless (throttled);
+  fail_unless_equals_int (overrun_count, 0);
+
+  /* the next buffer makes the oldest one go */
+  push_sized_buffer (mysrcpad, 400);
+  query_memory_usage (queue, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 1200);
+  fail_unless_equals_int (overrun_count, 1);
+  ASSERT_BUFFER_REFCOUNT (buffer1, "buffer", 1);
+
+  /* cleanup */
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_buffer_unref (buffer1);
+  gst_check_teardown_src_pad (queue);
+  cleanup_queue (queue);
+  g_unsetenv ("GST_QUEUE_MEMORY_LIMIT");
+}
+
+GST_END_TEST;
+
+static gpointer
+push_sized_buffer_thread (gpointer data)
+{
+  return GINT_TO_POINTER (gst_pad_push (mysrcpad,
+          gst_buffer_new_and_alloc (GPOINTER_TO_UINT (data))));
+}
+
+/* a non-leaky queue over the process-wide budget blocks until it was
+ * drained */
+GST_START_TEST (test_memory_limit_block)
+{
+  GstElement *queue;
+  GstPad *srcpad;
+  GThread *thread;
+  guint bytes;
+  gboolean throttled;
+
+  g_setenv ("GST_QUEUE_MEMORY_LIMIT", "1000", TRUE);
+
+  queue = setup_memory_queue (0);
+  mysrcpad = gst_check_setup_src_pad (queue, &srctemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+
+  push_sized_buffer (mysrcpad, 400);
+  push_sized_buffer (mysrcpad, 400);
+  push_sized_buffer (mysrcpad, 400);
+
+  thread = g_thread_create (push_sized_buffer_thread, GUINT_TO_POINTER (400),
+      TRUE, NULL);
+  while (g_atomic_int_get (&overrun_count) == 0)
+    g_usleep (G_USEC_PER_SEC / 100);
+
+  /* give the push some time to get through if it wrongly would */
+  g_usleep (G_USEC_PER_SEC / 10);
+  query_memory_usage (queue, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 1200);
+  fail_unless (throttled);
+
+  /* link now, the task drains the queue and unblocks the push */
+  mysinkpad = gst_pad_new_from_static_template (&sinktemplate, "sink");
+  gst_pad_set_chain_function (mysinkpad, gst_check_chain_func);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  g_mutex_lock (check_mutex);
+  srcpad = gst_element_get_static_pad (queue, "src");
+  fail_unless (gst_pad_link (srcpad, mysinkpad) == GST_PAD_LINK_OK);
+  gst_object_unref (srcpad);
+  while (g_list_length (buffers) < 4)
+    g_cond_wait (check_cond, check_mutex);
+  g_mutex_unlock (check_mutex);
+
+  fail_unless_equals_int (GPOINTER_TO_INT (g_thread_join (thread)),
+      GST_FLOW_OK);
+  fail_unless_equals_int (overrun_count, 1);
+
+  /* cleanup */
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_drop_buffers ();
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_check_teardown_src_pad (queue);
+  gst_check_teardown_sink_pad (queue);
+  cleanup_queue (queue);
+  g_unsetenv ("GST_QUEUE_MEMORY_LIMIT");
+}
+
+GST_END_TEST;
+
+/* only the biggest queue of the lowest priority is throttled, so that a
+ * demuxer feeding several queues is not blocked on all of them */
+GST_START_TEST (test_memory_limit_priority)
+{
+  GstElement *queue1, *queue2;
+  GstPad *srcpad1, *srcpad2;
+  guint bytes;
+  gboolean throttled;
+
+  g_setenv ("GST_QUEUE_MEMORY_LIMIT", "1000", TRUE);
+
+  queue1 = setup_memory_queue (0);
+  srcpad1 = gst_check_setup_src_pad (queue1, &srctemplate, NULL);
+  gst_pad_set_active (srcpad1, TRUE);
+  queue2 = setup_memory_queue (0);
+  srcpad2 = gst_check_setup_src_pad (queue2, &srctemplate, NULL);
+  gst_pad_set_active (srcpad2, TRUE);
+
+  push_sized_buffer (srcpad1, 400);
+  push_sized_buffer (srcpad1, 400);
+  push_sized_buffer (srcpad2, 400);
+
+  query_memory_usage (queue1, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 800);
+  fail_unless (throttled);
+  query_memory_usage (queue2, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 400);
+  fail_if (throttled);
+
+  /* a lower priority goes first, even with less data */
+  g_object_set (G_OBJECT (queue2), "memory-priority", -1, NULL);
+  query_memory_usage (queue1, &bytes, &throttled);
+  fail_if (throttled);
+  query_memory_usage (queue2, &bytes, &throttled);
+  fail_unless (throttled);
+
+  /* cleanup */
+  gst_pad_set_active (srcpad1, FALSE);
+  gst_pad_set_active (srcpad2, FALSE);
+  gst_check_teardown_src_pad (queue1);
+  gst_check_teardown_src_pad (queue2);
+  cleanup_queue (queue1);
+  cleanup_queue (queue2);
+  g_unsetenv ("GST_QUEUE_MEMORY_LIMIT");
+}
+
+GST_END_TEST;
+
+/* a queue waiting for data keeps the queues of its own pipeline from being
+ * throttled, but not those of other pipelines */
+GST_START_TEST (test_memory_limit_starving)
+{
+  GstElement *queue1, *queue2, *bin;
+  GstPad *srcpad1;
+  guint bytes;
+  gboolean throttled;
+
+  g_setenv ("GST_QUEUE_MEMORY_LIMIT", "1000", TRUE);
+
+  bin = gst_bin_new ("bin");
+  queue1 = setup_memory_queue (0);
+  srcpad1 = gst_check_setup_src_pad (queue1, &srctemplate, NULL);
+  gst_pad_set_active (srcpad1, TRUE);
+  queue2 = setup_memory_queue (0);
+  gst_object_set_name (GST_OBJECT (queue2), "queue2");
+  gst_object_ref (queue1);
+  gst_object_ref (queue2);
+  fail_unless (gst_bin_add (GST_BIN (bin), queue1));
+  fail_unless (gst_bin_add (GST_BIN (bin), queue2));
+
+  push_sized_buffer (srcpad1, 400);
+  push_sized_buffer (srcpad1, 400);
+  push_sized_buffer (srcpad1, 400);
+  query_memory_usage (queue1, &bytes, &throttled);
+  fail_unless_equals_int (bytes, 1200);
+  fail_unless (throttled);
+
+  /* linking starts the task of queue2, which finds no data */
+  mysinkpad = gst_check_setup_sink_pad (queue2, &sinktemplate, NULL);
+  gst_pad_set_active (mysinkpad, TRUE);
+  while (g_atomic_int_get (&underrun_count) == 0)
+    g_usleep (G_USEC_PER_SEC / 100);
+
+  query_memory_usage (queue1, &bytes, &throttled);
+  fail_if (throttled);
+
+  /* a starving queue of another pipeline does not matter */
+  fail_unless (gst_bin_remove (GST_BIN (bin), queue1));
+  query_memory_usage (queue1, &bytes, &throttled);
+  fail_unless (throttled);
+
+  /* cleanup */
+  fail_unless (gst_bin_remove (GST_BIN (bin), queue2));
+  gst_object_unref (bin);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_pad_set_active (srcpad1, FALSE);
+  gst_check_teardown_src_pad (queue1);
+  gst_check_teardown_sink_pad (queue2);
+  cleanup_queue (queue1);
+  cleanup_queue (queue2);
+  g_unsetenv ("GST_QUEUE_MEMORY_LIMIT");
+}
+
+GST_END_TEST;
+
+/* a task pool running a single thread at a time, or a new thread for every
+ * job when spawn is set */
+typedef struct
+{
+  GstTaskPool parent;
+
+  GThreadPool *threads;
+
+  gboolean spawn;
+  GList *spawned;
+} TestSmallPool;
+
+typedef GstTaskPoolClass TestSmallPoolClass;
+
+typedef struct
+{
+  GstTaskPoolFunction func;
+  gpointer data;
+} TestSmallPoolJob;
+
+G_DEFINE_TYPE (TestSmallPool, test_small_pool, GST_TYPE_TASK_POOL);
+
+static void
+test_small_pool_func (TestSmallPoolJob * job, gpointer unused)
+{
+  job->func (job->data);
+  g_slice_free (TestSmallPoolJob, job);
+}
+
+static gpointer
+test_small_pool_thread (TestSmallPoolJob * job)
+{
+  test_small_pool_func (job, NULL);
+  return NULL;
+}
+
+static void
+test_small_pool_prepare (GstTaskPool * pool, GError ** error)
+{
+  TestSmallPool *spool = (TestSmallPool *) pool;
+
+  if (!spool->spawn)
+    spool->threads =
+        g_thread_pool_new ((GFunc) test_small_pool_func, NULL, 1, FALSE,
+        error);
+}
+
+static void
+test_small_pool_cleanup (GstTaskPool * pool)
+{
+  TestSmallPool *spool = (TestSmallPool *) pool;
+
+  if (spool->threads) {
+    g_thread_pool_free (spool->threads, FALSE, TRUE);
+    spool->threads = NULL;
+  }
+  /* the spawned threads are joined only now so that no two jobs get the same
+   * GThread */
+  g_list_foreach (spool->spawned, (GFunc) g_thread_join, NULL);
+  g_list_free (spool->spawned);
+  spool->spawned = NULL;
+}
+
+static gpointer
+test_small_pool_push (GstTaskPool * pool, GstTaskPoolFunction func,
+    gpointer data, GError ** error)
+{
+  TestSmallPool *spool = (TestSmallPool *) pool;
+  TestSmallPoolJob *job;
+  GThread *thread;
+
+  job = g_slice_new (TestSmallPoolJob);
+  job->func = func;
+  job->data = data;
+  if (spool->spawn) {
+    thread = g_thread_create ((GThreadFunc) test_small_pool_thread, job, TRUE,
+        error);
+    if (thread) {
+      GST_OBJECT_LOCK (pool);
+      spool->spawned = g_list_prepend (spool->spawned, thread);
+      GST_OBJECT_UNLOCK (pool);
+    } else {
+      g_slice_free (TestSmallPoolJob, job);
+    }
+  } else {
+    g_thread_pool_push (spool->threads, job, error);
+  }
+
+  return NULL;
+}
+
+static void
+test_small_pool_join (GstTaskPool * pool, gpointer id)
+{
+}
+
+static void
+test_small_pool_class_init (TestSmallPoolClass * klass)
+{
+  klass->prepare = test_small_pool_prepare;
+  klass->cleanup = test_small_pool_cleanup;
+  klass->push = test_small_pool_push;
+  klass->join = test_small_pool_join;
+}
+
+static void
+test_small_pool_init (TestSmallPool * pool)
+{
+}
+
+static GstTaskPool *small_pool;
+static gint enter_count, leave_count;
+
+static GstBusSyncReply
+cooperative_sync_handler (GstBus * bus, GstMessage * message, gpointer data)
+{
+  GstStreamStatusType type;
+  GstElement *owner;
+  GstTask *task;
+  guint level;
+
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_STREAM_STATUS) {
+    gst_message_parse_stream_status (message, &type, &owner);
+
+    switch (type) {
+      case GST_STREAM_STATUS_TYPE_CREATE:
+        task = g_value_get_object (gst_message_get_stream_status_object
+            (message));
+        gst_task_set_pool (task, small_pool);
+        gst_task_set_cooperative (task, TRUE);
+        break;
+      case GST_STREAM_STATUS_TYPE_ENTER:
+        g_atomic_int_inc (&enter_count);
+        break;
+      case GST_STREAM_STATUS_TYPE_LEAVE:
+        /* takes the queue lock, the queue must not hold it while the task
+         * leaves its thread */
+        g_object_get (G_OBJECT (owner), "current-level-buffers", &level, NULL);
+        g_atomic_int_inc (&leave_count);
+        break;
+      default:
+        break;
+    }
+  }
+  gst_message_unref (message);
+
+  return GST_BUS_DROP;
+}
+
+/* two queues with cooperative tasks share a pool of a single thread, they
+ * give it up while they wait for data. A task that is suspended is not left
+ * until it is resumed in another thread, so every task is entered once more
+ * than it is left while it runs. */
+GST_START_TEST (test_cooperative_task)
+{
+  GstElement *queue1, *queue2;
+  GstPad *srcpad1, *srcpad2, *sinkpad1, *sinkpad2;
+  GstBus *bus;
+  guint i;
+
+  small_pool = g_object_new (test_small_pool_get_type (), NULL);
+  gst_task_pool_prepare (small_pool, NULL);
+  enter_count = leave_count = 0;
+
+  bus = gst_bus_new ();
+  gst_bus_set_sync_handler (bus, cooperative_sync_handler, NULL);
+
+  queue1 = setup_queue ();
+  gst_element_set_bus (queue1, bus);
+  srcpad1 = gst_check_setup_src_pad (queue1, &srctemplate, NULL);
+  sinkpad1 = gst_check_setup_sink_pad (queue1, &sinktemplate, NULL);
+  gst_pad_set_active (srcpad1, TRUE);
+  gst_pad_set_active (sinkpad1, TRUE);
+
+  queue2 = setup_queue ();
+  gst_element_set_bus (queue2, bus);
+  srcpad2 = gst_check_setup_src_pad (queue2, &srctemplate, NULL);
+  sinkpad2 = gst_check_setup_sink_pad (queue2, &sinktemplate, NULL);
+  gst_pad_set_active (srcpad2, TRUE);
+  gst_pad_set_active (sinkpad2, TRUE);
+
+  fail_unless (gst_element_set_state (queue1,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+  fail_unless (gst_element_set_state (queue2,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* a task blocking the only thread would starve the other queue */
+  for (i = 1; i <= 3; i++) {
+    fail_unless_equals_int (gst_pad_push (srcpad1,
+            gst_buffer_new_and_alloc (4)), GST_FLOW_OK);
+    g_mutex_lock (check_mutex);
+    while (g_list_length (buffers) < 2 * i - 1)
+      g_cond_wait (check_cond, check_mutex);
+    g_mutex_unlock (check_mutex);
+
+    fail_unless_equals_int (gst_pad_push (srcpad2,
+            gst_buffer_new_and_alloc (4)), GST_FLOW_OK);
+    g_mutex_lock (check_mutex);
+    while (g_list_length (buffers) < 2 * i)
+      g_cond_wait (check_cond, check_mutex);
+    g_mutex_unlock (check_mutex);
+  }
+
+  /* every underrun suspended the tasks, both are still in a thread */
+  fail_unless (g_atomic_int_get (&enter_count) >= 2);
+  fail_unless_equals_int (g_atomic_int_get (&enter_count) -
+      g_atomic_int_get (&leave_count), 2);
+
+  fail_unless (gst_element_set_state (queue1,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  fail_unless (gst_element_set_state (queue2,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int (g_atomic_int_get (&leave_count),
+      g_atomic_int_get (&enter_count));
+
+  /* cleanup */
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad1, FALSE);
+  gst_pad_set_active (sinkpad1, FALSE);
+  gst_pad_set_active (srcpad2, FALSE);
+  gst_pad_set_active (sinkpad2, FALSE);
+  gst_element_set_bus (queue1, NULL);
+  gst_element_set_bus (queue2, NULL);
+  gst_object_unref (bus);
+  gst_check_teardown_src_pad (queue1);
+  gst_check_teardown_sink_pad (queue1);
+  gst_check_teardown_src_pad (queue2);
+  gst_check_teardown_sink_pad (queue2);
+  cleanup_queue (queue1);
+  cleanup_queue (queue2);
+  gst_task_pool_cleanup (small_pool);
+  gst_object_unref (small_pool);
+}
+
+GST_END_TEST;
+
+/* waits until the task of @queue gave up its thread */
+static void
+wait_for_suspended_task (GstElement * queue)
+{
+  GstPad *pad;
+  GstTask *task;
+  gboolean running = TRUE;
+
+  pad = gst_element_get_static_pad (queue, "src");
+  while (running) {
+    g_usleep (G_USEC_PER_SEC / 1000);
+
+    GST_OBJECT_LOCK (pad);
+    task = GST_PAD_TASK (pad);
+    fail_unless (task != NULL);
+    GST_OBJECT_LOCK (task);
+    running = task->running;
+    GST_OBJECT_UNLOCK (task);
+    GST_OBJECT_UNLOCK (pad);
+  }
+  gst_object_unref (pad);
+}
+
+/* a cooperative task that is resumed in another thread leaves the thread it
+ * was suspended in and enters the new one */
+GST_START_TEST (test_cooperative_task_new_thread)
+{
+  GstElement *queue;
+  GstPad *srcpad, *sinkpad;
+  GstBus *bus;
+  guint i;
+
+  small_pool = g_object_new (test_small_pool_get_type (), NULL);
+  ((TestSmallPool *) small_pool)->spawn = TRUE;
+  gst_task_pool_prepare (small_pool, NULL);
+  enter_count = leave_count = 0;
+
+  bus = gst_bus_new ();
+  gst_bus_set_sync_handler (bus, cooperative_sync_handler, NULL);
+
+  queue = setup_queue ();
+  gst_element_set_bus (queue, bus);
+  srcpad = gst_check_setup_src_pad (queue, &srctemplate, NULL);
+  sinkpad = gst_check_setup_sink_pad (queue, &sinktemplate, NULL);
+  gst_pad_set_active (srcpad, TRUE);
+  gst_pad_set_active (sinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* the task started, found the queue empty and gave up its thread */
+  wait_for_suspended_task (queue);
+  fail_unless_equals_int (g_atomic_int_get (&enter_count), 1);
+  fail_unless_equals_int (g_atomic_int_get (&leave_count), 0);
+
+  for (i = 1; i <= 3; i++) {
+    fail_unless_equals_int (gst_pad_push (srcpad,
+            gst_buffer_new_and_alloc (4)), GST_FLOW_OK);
+    g_mutex_lock (check_mutex);
+    while (g_list_length (buffers) < i)
+      g_cond_wait (check_cond, check_mutex);
+    g_mutex_unlock (check_mutex);
+
+    /* every resume got a new thread */
+    wait_for_suspended_task (queue);
+    fail_unless_equals_int (g_atomic_int_get (&enter_count), i + 1);
+    fail_unless_equals_int (g_atomic_int_get (&leave_count), i);
+  }
+
+  fail_unless (gst_element_set_state (queue,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+  fail_unless_equals_int (g_atomic_int_get (&leave_count), 4);
+
+  /* cleanup */
+  gst_check_drop_buffers ();
+  gst_pad_set_active (srcpad, FALSE);
+  gst_pad_set_active (sinkpad, FALSE);
+  gst_element_set_bus (queue, NULL);
+  gst_object_unref (bus);
+  gst_check_teardown_src_pad (queue);
+  gst_check_teardown_sink_pad (queue);
+  cleanup_queue (queue);
+  gst_task_pool_cleanup (small_pool);
+  gst_object_unref (small_pool);
+}
+
+GST_END_TEST;
+
 static Suite *
 queue_suite (void)
 {
@@ -441,7 +1187,15 @@ queue_suite (void)
   tcase_add_test (tc_chain, test_non_leaky_overrun);
   tcase_add_test (tc_chain, test_leaky_upstream);
   tcase_add_test (tc_chain, test_leaky_downstream);
+  tcase_add_test (tc_chain, test_leaky_downstream_time);
   tcase_add_test (tc_chain, test_time_level);
+  tcase_add_test (tc_chain, test_memory_usage_query);
+  tcase_add_test (tc_chain, test_memory_limit_leak);
+  tcase_add_test (tc_chain, test_memory_limit_block);
+  tcase_add_test (tc_chain, test_memory_limit_priority);
+  tcase_add_test (tc_chain, test_memory_limit_starving);
+  tcase_add_test (tc_chain, test_cooperative_task);
+  tcase_add_test (tc_chain, test_cooperative_task_new_thread);
 
   return s;
 }
@@ -586,6 +586,68 @@ GST_START_TEST (test_flow_aggregation)
 
 GST_END_TEST;
 
+static gint chain_refcount[2];
+
+static GstFlowReturn
+_refcount_chain (GstPad * pad, GstBuffer * buffer)
+{
+  gint idx = GPOINTER_TO_INT (g_object_get_data (G_OBJECT (pad), "idx"));
+
+  chain_refcount[idx] = GST_MINI_OBJECT_REFCOUNT_VALUE (buffer);
+  gst_buffer_unref (buffer);
+  return GST_FLOW_OK;
+}
+
+/* the last branch gets the reference of the tee, so it can modify the buffer
+ * without a copy when the other branches are done with it */
+GST_START_TEST (test_last_branch_writable)
+{
+  GstPad *mysrc, *mysink[2], *teesink, *teesrc[2];
+  GstElement *tee;
+  GstBuffer *buffer;
+  gint i;
+
+  tee = gst_element_factory_make ("tee", NULL);
+  fail_unless (tee != NULL);
+  teesink = gst_element_get_static_pad (tee, "sink");
+  mysrc = gst_pad_new ("mysrc", GST_PAD_SRC);
+  fail_unless (gst_pad_link (mysrc, teesink) == GST_PAD_LINK_OK);
+
+  for (i = 0; i < 2; i++) {
+    teesrc[i] = gst_element_get_request_pad (tee, "src%d");
+    fail_unless (teesrc[i] != NULL);
+    mysink[i] = gst_pad_new (NULL, GST_PAD_SINK);
+    g_object_set_data (G_OBJECT (mysink[i]), "idx", GINT_TO_POINTER (i));
+    gst_pad_set_chain_function (mysink[i], _refcount_chain);
+    gst_pad_set_active (mysink[i], TRUE);
+    fail_unless (gst_pad_link (teesrc[i], mysink[i]) == GST_PAD_LINK_OK);
+  }
+
+  fail_unless (gst_element_set_state (tee,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS);
+
+  buffer = gst_buffer_new_and_alloc (16);
+  fail_unless (gst_pad_push (mysrc, buffer) == GST_FLOW_OK);
+  fail_unless_equals_int (chain_refcount[0], 2);
+  fail_unless_equals_int (chain_refcount[1], 1);
+
+  fail_unless (gst_element_set_state (tee,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS);
+
+  for (i = 0; i < 2; i++) {
+    fail_unless (gst_pad_unlink (teesrc[i], mysink[i]) == TRUE);
+    gst_element_release_request_pad (tee, teesrc[i]);
+    gst_object_unref (teesrc[i]);
+    gst_object_unref (mysink[i]);
+  }
+  fail_unless (gst_pad_unlink (mysrc, teesink) == TRUE);
+  gst_object_unref (teesink);
+  gst_object_unref (mysrc);
+  gst_object_unref (tee);
+}
+
+GST_END_TEST;
+
 static Suite *
 tee_suite (void)
 {
@@ -602,6 +664,7 @@ tee_suite (void)
   tcase_add_test (tc_chain, test_release_while_second_buffer_alloc);
   tcase_add_test (tc_chain, test_internal_links);
   tcase_add_test (tc_chain, test_flow_aggregation);
+  tcase_add_test (tc_chain, test_last_branch_writable);
 
   return s;
 }
@@ -0,0 +1,298 @@
+/* GStreamer
+ *
+ * unit test for typefind
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#include <string.h>
+
+#include <gst/check/gstcheck.h>
+
+static GstPad *mysrcpad, *mysinkpad;
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
+    GST_PAD_SINK,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
+    GST_PAD_SRC,
+    GST_PAD_ALWAYS,
+    GST_STATIC_CAPS_ANY);
+
+/* the magic marker the test typefinder looks for */
+#define MAGIC_OFFSET 8192
+
+static guint magic_calls;
+
+static void
+magic_typefind (GstTypeFind * tf, gpointer unused)
+{
+  guint8 *data;
+
+  magic_calls++;
+
+  data = gst_type_find_peek (tf, MAGIC_OFFSET, 4);
+  if (data && memcmp (data, "TEST", 4) == 0) {
+    GstCaps *caps = gst_caps_new_simple ("test/x-magic", NULL);
+
+    gst_type_find_suggest (tf, GST_TYPE_FIND_MAXIMUM, caps);
+    gst_caps_unref (caps);
+  }
+}
+
+static void
+never_typefind (GstTypeFind * tf, gpointer unused)
+{
+  /* only looks at the start and never recognises anything */
+  gst_type_find_peek (tf, 0, 4);
+}
+
+static GstElement *
+setup_typefind (void)
+{
+  GstElement *typefind;
+
+  GST_DEBUG ("setup_typefind");
+
+  magic_calls = 0;
+
+  typefind = gst_check_setup_element ("typefind");
+  mysrcpad = gst_check_setup_src_pad (typefind, &srctemplate, NULL);
+  mysinkpad = gst_check_setup_sink_pad (typefind, &sinktemplate, NULL);
+  gst_pad_set_active (mysrcpad, TRUE);
+  gst_pad_set_active (mysinkpad, TRUE);
+
+  fail_unless (gst_element_set_state (typefind,
+          GST_STATE_PAUSED) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to paused");
+
+  return typefind;
+}
+
+static void
+cleanup_typefind (GstElement * typefind)
+{
+  GST_DEBUG ("cleanup_typefind");
+
+  gst_check_drop_buffers ();
+  gst_element_set_state (typefind, GST_STATE_NULL);
+  gst_pad_set_active (mysrcpad, FALSE);
+  gst_pad_set_active (mysinkpad, FALSE);
+  gst_check_teardown_src_pad (typefind);
+  gst_check_teardown_sink_pad (typefind);
+  gst_check_teardown_element (typefind);
+}
+
+/* a buffer of @size zero bytes, with the magic marker at @magic if it is
+ * inside the buffer */
+static GstBuffer *
+create_buffer (guint size, guint64 offset, gint magic)
+{
+  GstBuffer *buffer;
+
+  buffer = gst_buffer_new_and_alloc (size);
+  memset (GST_BUFFER_DATA (buffer), 0, size);
+  if (magic >= 0)
+    memcpy (GST_BUFFER_DATA (buffer) + magic, "TEST", 4);
+  GST_BUFFER_OFFSET (buffer) = offset;
+
+  return buffer;
+}
+
+static void
+check_found_buffer (guint size, guint64 offset)
+{
+  GstBuffer *buffer;
+  GstStructure *s;
+
+  fail_unless_equals_int (g_list_length (buffers), 1);
+  buffer = GST_BUFFER_CAST (buffers->data);
+
+  fail_unless_equals_int (GST_BUFFER_SIZE (buffer), size);
+  fail_unless_equals_uint64 (GST_BUFFER_OFFSET (buffer), offset);
+  fail_unless (memcmp (GST_BUFFER_DATA (buffer) + MAGIC_OFFSET, "TEST",
+          4) == 0);
+
+  fail_unless (GST_BUFFER_CAPS (buffer) != NULL);
+  s = gst_caps_get_structure (GST_BUFFER_CAPS (buffer), 0);
+  fail_unless (gst_structure_has_name (s, "test/x-magic"));
+}
+
+GST_START_TEST (test_incremental)
+{
+  GstElement *typefind;
+  guint i;
+
+  fail_unless (gst_type_find_register (NULL, "test-magic", GST_RANK_PRIMARY,
+          magic_typefind, NULL, NULL, NULL, NULL));
+  fail_unless (gst_type_find_register (NULL, "test-never", GST_RANK_PRIMARY,
+          never_typefind, NULL, NULL, NULL, NULL));
+
+  typefind = setup_typefind ();
+
+  /* the magic typefinder asks for data past the first buffer and is not
+   * called again until that much data has been collected */
+  for (i = 0; i < 4; i++) {
+    fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (2048,
+                i * 2048, -1)), GST_FLOW_OK);
+    fail_unless (buffers == NULL);
+    fail_unless_equals_int (magic_calls, 1);
+  }
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (2048,
+              4 * 2048, 0)), GST_FLOW_OK);
+  fail_unless_equals_int (magic_calls, 2);
+
+  /* all the data comes out as one buffer with the offset of the first one */
+  check_found_buffer (5 * 2048, 0);
+
+  cleanup_typefind (typefind);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_not_found_early)
+{
+  GstElement *typefind;
+  GstBus *bus;
+  GstMessage *msg;
+  GError *err = NULL;
+
+  fail_unless (gst_type_find_register (NULL, "test-never", GST_RANK_PRIMARY,
+          never_typefind, NULL, NULL, NULL, NULL));
+
+  typefind = setup_typefind ();
+  bus = gst_bus_new ();
+  gst_element_set_bus (typefind, bus);
+
+  /* the only typefinder saw all it wanted in the first buffer, so there is no
+   * point in waiting for more data */
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (2048, 0,
+              -1)), GST_FLOW_ERROR);
+
+  msg = gst_bus_poll (bus, GST_MESSAGE_ERROR, 0);
+  fail_unless (msg != NULL);
+  gst_message_parse_error (msg, &err, NULL);
+  fail_unless (g_error_matches (err, GST_STREAM_ERROR,
+          GST_STREAM_ERROR_TYPE_NOT_FOUND));
+  g_error_free (err);
+  gst_message_unref (msg);
+
+  gst_element_set_bus (typefind, NULL);
+  gst_object_unref (bus);
+  cleanup_typefind (typefind);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_flush_resets)
+{
+  GstElement *typefind;
+
+  fail_unless (gst_type_find_register (NULL, "test-magic", GST_RANK_PRIMARY,
+          magic_typefind, NULL, NULL, NULL, NULL));
+
+  typefind = setup_typefind ();
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (2048, 0,
+              -1)), GST_FLOW_OK);
+  fail_unless_equals_int (magic_calls, 1);
+
+  /* a flush drops the collected data and the state of the typefinders */
+  gst_pad_push_event (mysrcpad, gst_event_new_flush_start ());
+  gst_pad_push_event (mysrcpad, gst_event_new_flush_stop ());
+
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (5 * 2048,
+              100, MAGIC_OFFSET)), GST_FLOW_OK);
+  fail_unless_equals_int (magic_calls, 2);
+
+  check_found_buffer (5 * 2048, 100);
+
+  cleanup_typefind (typefind);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_implicit_caps)
+{
+  GstElement *typefind;
+  GstBuffer *buffer, *out;
+  GstCaps *caps;
+
+  fail_unless (gst_type_find_register (NULL, "test-magic", GST_RANK_PRIMARY,
+          magic_typefind, NULL, NULL, NULL, NULL));
+
+  typefind = setup_typefind ();
+
+  /* the buffer typefind pushes first configures downstream */
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (5 * 2048,
+              0, MAGIC_OFFSET)), GST_FLOW_OK);
+  check_found_buffer (5 * 2048, 0);
+  fail_unless (GST_PAD_CAPS (mysinkpad) ==
+      GST_BUFFER_CAPS (GST_BUFFER_CAST (buffers->data)));
+
+  /* by default every buffer carries the caps, even when downstream knows
+   * them already */
+  fail_unless_equals_int (gst_pad_push (mysrcpad, create_buffer (16,
+              5 * 2048, -1)), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 2);
+  out = GST_BUFFER_CAST (buffers->next->data);
+  fail_unless (GST_BUFFER_CAPS (out) == GST_PAD_CAPS (mysinkpad));
+
+  /* with implicit caps, a shared buffer without caps is passed on without
+   * being copied */
+  g_object_set (typefind, "implicit-caps", TRUE, NULL);
+  buffer = create_buffer (16, 5 * 2048 + 16, -1);
+  gst_buffer_ref (buffer);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 3);
+  out = GST_BUFFER_CAST (buffers->next->next->data);
+  fail_unless (out == buffer);
+  fail_unless (GST_BUFFER_CAPS (out) == NULL);
+  gst_buffer_unref (buffer);
+
+  /* a buffer with other caps gets ours */
+  caps = gst_caps_new_simple ("test/x-other", NULL);
+  buffer = create_buffer (16, 5 * 2048 + 32, -1);
+  gst_buffer_set_caps (buffer, caps);
+  gst_caps_unref (caps);
+  fail_unless_equals_int (gst_pad_push (mysrcpad, buffer), GST_FLOW_OK);
+  fail_unless_equals_int (g_list_length (buffers), 4);
+  out = GST_BUFFER_CAST (g_list_last (buffers)->data);
+  fail_unless (GST_BUFFER_CAPS (out) == GST_PAD_CAPS (mysinkpad));
+
+  cleanup_typefind (typefind);
+}
+
+GST_END_TEST;
+
+static Suite *
+typefind_suite (void)
+{
+  Suite *s = suite_create ("typefind");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_incremental);
+  tcase_add_test (tc_chain, test_not_found_early);
+  tcase_add_test (tc_chain, test_flush_resets);
+  tcase_add_test (tc_chain, test_implicit_caps);
+
+  return s;
+}
+
+GST_CHECK_MAIN (typefind);
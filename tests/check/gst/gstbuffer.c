@@ -145,6 +145,101 @@ GST_START_TEST (test_subbuffer)
 
 GST_END_TEST;
 
+GST_START_TEST (test_subbuffer_recycle)
+{
+  GstBuffer *buffer, *sub;
+  GstCaps *caps;
+  gint i;
+
+  buffer = gst_buffer_new_and_alloc (4);
+  caps = gst_caps_from_string ("audio/x-raw-int");
+  gst_buffer_set_caps (buffer, caps);
+  GST_BUFFER_FLAG_SET (buffer, GST_BUFFER_FLAG_DISCONT);
+
+  /* complete subbuffers copy flags and caps, partial ones must not inherit
+   * them from a recycled instance */
+  for (i = 0; i < 100; i++) {
+    sub = gst_buffer_create_sub (buffer, 0, 4);
+    fail_unless (GST_BUFFER_CAPS (sub) == caps);
+    fail_unless (GST_BUFFER_FLAG_IS_SET (sub, GST_BUFFER_FLAG_DISCONT));
+    ASSERT_CAPS_REFCOUNT (caps, "caps", 3);
+    gst_buffer_unref (sub);
+    ASSERT_CAPS_REFCOUNT (caps, "caps", 2);
+
+    sub = gst_buffer_create_sub (buffer, 1, 2);
+    ASSERT_BUFFER_REFCOUNT (buffer, "parent", 2);
+    ASSERT_BUFFER_REFCOUNT (sub, "subbuffer", 1);
+    fail_unless (GST_BUFFER_CAPS (sub) == NULL);
+    fail_unless (GST_BUFFER_MALLOCDATA (sub) == NULL);
+    fail_unless (GST_BUFFER_DATA (sub) == GST_BUFFER_DATA (buffer) + 1);
+    fail_unless (GST_BUFFER_FLAGS (sub) == GST_BUFFER_FLAG_READONLY);
+    fail_unless (GST_BUFFER_TIMESTAMP (sub) == GST_CLOCK_TIME_NONE);
+    gst_buffer_unref (sub);
+    ASSERT_BUFFER_REFCOUNT (buffer, "parent", 1);
+  }
+
+  gst_buffer_unref (buffer);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
+#define N_RELEASED 10
+
+static gpointer
+release_buffers (gpointer data)
+{
+  GstBuffer **buffers = data;
+  gint i;
+
+  for (i = 0; i < N_RELEASED; i++)
+    gst_buffer_unref (buffers[i]);
+
+  return NULL;
+}
+
+GST_START_TEST (test_recycle_other_thread)
+{
+  GstBuffer *released[N_RELEASED], *buffers[200];
+  GThread *thread;
+  gboolean found = FALSE;
+  gint i, j;
+
+  for (i = 0; i < N_RELEASED; i++) {
+    released[i] = gst_buffer_new_and_alloc (16);
+    GST_BUFFER_TIMESTAMP (released[i]) = i * GST_SECOND;
+    GST_BUFFER_OFFSET (released[i]) = i;
+    GST_BUFFER_FLAG_SET (released[i], GST_BUFFER_FLAG_DISCONT);
+  }
+
+  /* buffers released by another thread go back to the cache of this one */
+  thread = g_thread_create (release_buffers, released, TRUE, NULL);
+  fail_unless (thread != NULL);
+  g_thread_join (thread);
+
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++) {
+    buffers[i] = gst_buffer_new ();
+    ASSERT_BUFFER_REFCOUNT (buffers[i], "buffer", 1);
+    fail_unless (GST_BUFFER_DATA (buffers[i]) == NULL);
+    fail_unless (GST_BUFFER_MALLOCDATA (buffers[i]) == NULL);
+    fail_unless (GST_BUFFER_SIZE (buffers[i]) == 0);
+    fail_unless (GST_BUFFER_FLAGS (buffers[i]) == 0);
+    fail_unless (GST_BUFFER_TIMESTAMP (buffers[i]) == GST_CLOCK_TIME_NONE);
+    fail_unless (GST_BUFFER_OFFSET (buffers[i]) == GST_BUFFER_OFFSET_NONE);
+    fail_unless (GST_BUFFER_CAPS (buffers[i]) == NULL);
+
+    for (j = 0; j < N_RELEASED; j++)
+      if (buffers[i] == released[j])
+        found = TRUE;
+  }
+  fail_unless (found, "no buffer released by the other thread was reused");
+
+  for (i = 0; i < G_N_ELEMENTS (buffers); i++)
+    gst_buffer_unref (buffers[i]);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_is_span_fast)
 {
   GstBuffer *buffer, *sub1, *sub2;
@@ -460,6 +555,8 @@ gst_buffer_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_caps);
   tcase_add_test (tc_chain, test_subbuffer);
+  tcase_add_test (tc_chain, test_subbuffer_recycle);
+  tcase_add_test (tc_chain, test_recycle_other_thread);
   tcase_add_test (tc_chain, test_subbuffer_make_writable);
   tcase_add_test (tc_chain, test_make_writable);
   tcase_add_test (tc_chain, test_is_span_fast);
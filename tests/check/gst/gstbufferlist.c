@@ -766,6 +766,64 @@ GST_START_TEST (test_foreach)
 
 GST_END_TEST;
 
+GST_START_TEST (test_new_span)
+{
+  GstBufferList *span;
+  GstBufferListIterator *it;
+  GstBuffer *buf1, *buf2, *merged, *parent, *sub1, *sub2;
+
+  buf1 = buffer_from_string ("foo");
+  buf2 = buffer_from_string ("bar");
+
+  /* non-contiguous buffers are referenced, not copied */
+  span = gst_buffer_list_new_span (buf1, 1, buf2, 4);
+  fail_unless (gst_buffer_list_n_groups (span) == 1);
+  fail_unless (GST_BUFFER_DATA (gst_buffer_list_get (span, 0, 0)) ==
+      GST_BUFFER_DATA (buf1) + 1);
+  fail_unless (GST_BUFFER_DATA (gst_buffer_list_get (span, 0, 1)) ==
+      GST_BUFFER_DATA (buf2));
+  fail_unless (gst_buffer_list_get (span, 0, 2) == NULL);
+  ASSERT_BUFFER_REFCOUNT (buf1, "buf1", 2);
+  ASSERT_BUFFER_REFCOUNT (buf2, "buf2", 2);
+
+  it = gst_buffer_list_iterate (span);
+  fail_unless (gst_buffer_list_iterator_next_group (it));
+  merged = gst_buffer_list_iterator_merge_group (it);
+  gst_buffer_list_iterator_free (it);
+  fail_unless (GST_BUFFER_SIZE (merged) == 4);
+  fail_unless (memcmp (GST_BUFFER_DATA (merged), "ooba", 4) == 0);
+  gst_buffer_unref (merged);
+  gst_buffer_list_unref (span);
+
+  /* a span starting in the second buffer only references that one */
+  span = gst_buffer_list_new_span (buf1, 4, buf2, 2);
+  fail_unless (GST_BUFFER_DATA (gst_buffer_list_get (span, 0, 0)) ==
+      GST_BUFFER_DATA (buf2) + 1);
+  fail_unless (gst_buffer_list_get (span, 0, 1) == NULL);
+  ASSERT_BUFFER_REFCOUNT (buf1, "buf1", 1);
+  gst_buffer_list_unref (span);
+
+  gst_buffer_unref (buf1);
+  gst_buffer_unref (buf2);
+
+  /* contiguous subbuffers result in one subbuffer of the parent */
+  parent = buffer_from_string ("foobar");
+  sub1 = gst_buffer_create_sub (parent, 0, 3);
+  sub2 = gst_buffer_create_sub (parent, 3, 3);
+  span = gst_buffer_list_new_span (sub1, 0, sub2, 6);
+  fail_unless (GST_BUFFER_DATA (gst_buffer_list_get (span, 0, 0)) ==
+      GST_BUFFER_DATA (parent));
+  fail_unless (GST_BUFFER_SIZE (gst_buffer_list_get (span, 0, 0)) == 6);
+  fail_unless (gst_buffer_list_get (span, 0, 1) == NULL);
+  gst_buffer_list_unref (span);
+
+  gst_buffer_unref (sub1);
+  gst_buffer_unref (sub2);
+  gst_buffer_unref (parent);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 gst_buffer_list_suite (void)
@@ -783,6 +841,7 @@ gst_buffer_list_suite (void)
   tcase_add_test (tc_chain, test_do);
   tcase_add_test (tc_chain, test_merge);
   tcase_add_test (tc_chain, test_foreach);
+  tcase_add_test (tc_chain, test_new_span);
 
   return s;
 }
@@ -240,6 +240,189 @@ GST_START_TEST (test_two_instances)
 
 GST_END_TEST;
 
+GST_START_TEST (test_switch)
+{
+  GstElement *elem;
+  gboolean res;
+  gint val;
+
+  elem = gst_element_factory_make (GST_PRESET_TEST_NAME, NULL);
+  g_object_set (elem, "test", 1, NULL);
+  res = gst_preset_save_preset (GST_PRESET (elem), "one");
+  fail_unless (res);
+  g_object_set (elem, "test", 2, NULL);
+  res = gst_preset_save_preset (GST_PRESET (elem), "two");
+  fail_unless (res);
+
+  /* switching back and forth uses the deserialized values */
+  res = gst_preset_load_preset (GST_PRESET (elem), "one");
+  fail_unless (res);
+  g_object_get (elem, "test", &val, NULL);
+  fail_unless_equals_int (val, 1);
+  res = gst_preset_load_preset (GST_PRESET (elem), "two");
+  fail_unless (res);
+  g_object_get (elem, "test", &val, NULL);
+  fail_unless_equals_int (val, 2);
+
+  /* overwriting a preset must not leave the old values behind */
+  g_object_set (elem, "test", 3, NULL);
+  res = gst_preset_save_preset (GST_PRESET (elem), "one");
+  fail_unless (res);
+  res = gst_preset_load_preset (GST_PRESET (elem), "two");
+  fail_unless (res);
+  res = gst_preset_load_preset (GST_PRESET (elem), "one");
+  fail_unless (res);
+  g_object_get (elem, "test", &val, NULL);
+  fail_unless_equals_int (val, 3);
+
+  gst_object_unref (elem);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_file_changed)
+{
+  GstElement *elem;
+  gchar *preset_file_name;
+  const gchar *contents =
+      "[_presets_]\nelement-name=GstPresetTest\n\n[changed]\ntest=42\n";
+  gboolean res;
+  gint val;
+
+  elem = gst_element_factory_make (GST_PRESET_TEST_NAME, NULL);
+  g_object_set (elem, "test", 5, NULL);
+  res = gst_preset_save_preset (GST_PRESET (elem), "test");
+  fail_unless (res);
+  res = gst_preset_load_preset (GST_PRESET (elem), "test");
+  fail_unless (res);
+
+  /* another process replaces the preset file */
+  preset_file_name = g_build_filename (g_get_home_dir (),
+      ".gstreamer-" GST_MAJORMINOR, "presets", "GstPresetTest.prs", NULL);
+  res = g_file_set_contents (preset_file_name, contents, -1, NULL);
+  fail_unless (res);
+  g_free (preset_file_name);
+
+  res = gst_preset_load_preset (GST_PRESET (elem), "test");
+  fail_unless (!res);
+  res = gst_preset_load_preset (GST_PRESET (elem), "changed");
+  fail_unless (res);
+  g_object_get (elem, "test", &val, NULL);
+  fail_unless_equals_int (val, 42);
+
+  gst_object_unref (elem);
+}
+
+GST_END_TEST;
+
+
+GST_START_TEST (test_file_changed_same_size)
+{
+  GstElement *elem;
+  gchar *preset_file_name;
+  gboolean res;
+  gint val;
+
+  elem = gst_element_factory_make (GST_PRESET_TEST_NAME, NULL);
+  preset_file_name = g_build_filename (g_get_home_dir (),
+      ".gstreamer-" GST_MAJORMINOR, "presets", "GstPresetTest.prs", NULL);
+
+  g_object_set (elem, "test", 5, NULL);
+  res = gst_preset_save_preset (GST_PRESET (elem), "test");
+  fail_unless (res);
+
+  /* the file changes twice within the same second without changing its size,
+   * which cannot be seen from the mtime */
+  res = g_file_set_contents (preset_file_name,
+      "[_presets_]\nelement-name=GstPresetTest\n\n[test]\ntest=41\n", -1,
+      NULL);
+  fail_unless (res);
+  res = gst_preset_load_preset (GST_PRESET (elem), "test");
+  fail_unless (res);
+  g_object_get (elem, "test", &val, NULL);
+  fail_unless_equals_int (val, 41);
+
+  res = g_file_set_contents (preset_file_name,
+      "[_presets_]\nelement-name=GstPresetTest\n\n[test]\ntest=42\n", -1,
+      NULL);
+  fail_unless (res);
+  res = gst_preset_load_preset (GST_PRESET (elem), "test");
+  fail_unless (res);
+  g_object_get (elem, "test", &val, NULL);
+  fail_unless_equals_int (val, 42);
+
+  g_free (preset_file_name);
+  gst_object_unref (elem);
+}
+
+GST_END_TEST;
+
+#define LOAD_THREADS 4
+#define LOAD_LOOPS 200
+
+static volatile gint load_failures;
+
+static gpointer
+load_thread_func (gpointer data)
+{
+  GstElement *elem;
+  guint i;
+
+  elem = gst_element_factory_make (GST_PRESET_TEST_NAME, NULL);
+  for (i = 0; i < LOAD_LOOPS; i++) {
+    if (!gst_preset_load_preset (GST_PRESET (elem), (i & 1) ? "one" : "two"))
+      g_atomic_int_inc (&load_failures);
+  }
+  gst_object_unref (elem);
+
+  return NULL;
+}
+
+GST_START_TEST (test_load_threads)
+{
+  GstElement *elem;
+  GThread *threads[LOAD_THREADS];
+  gchar *preset_file_name, *contents;
+  gboolean res;
+  guint i;
+
+  elem = gst_element_factory_make (GST_PRESET_TEST_NAME, NULL);
+  res = gst_preset_save_preset (GST_PRESET (elem), "one");
+  fail_unless (res);
+  res = gst_preset_save_preset (GST_PRESET (elem), "two");
+  fail_unless (res);
+
+  preset_file_name = g_build_filename (g_get_home_dir (),
+      ".gstreamer-" GST_MAJORMINOR, "presets", "GstPresetTest.prs", NULL);
+
+  load_failures = 0;
+  for (i = 0; i < LOAD_THREADS; i++) {
+    threads[i] = g_thread_create (load_thread_func, NULL, TRUE, NULL);
+    fail_unless (threads[i] != NULL);
+  }
+
+  /* keep replacing the file so that the cached keyfile and values are dropped
+   * while the other threads use them */
+  for (i = 0; i < LOAD_LOOPS; i++) {
+    contents = g_strdup_printf ("[_presets_]\nelement-name=GstPresetTest\n\n"
+        "[one]\ntest=%u\n\n[two]\ntest=%u\n", i, i + 1);
+    res = g_file_set_contents (preset_file_name, contents, -1, NULL);
+    fail_unless (res);
+    g_free (contents);
+    g_thread_yield ();
+  }
+
+  for (i = 0; i < LOAD_THREADS; i++)
+    g_thread_join (threads[i]);
+
+  fail_unless_equals_int (load_failures, 0);
+
+  g_free (preset_file_name);
+  gst_object_unref (elem);
+}
+
+GST_END_TEST;
+
 
 static void
 remove_preset_file (void)
@@ -292,6 +475,10 @@ gst_preset_suite (void)
     tcase_add_test (tc, test_add);
     tcase_add_test (tc, test_del);
     tcase_add_test (tc, test_two_instances);
+    tcase_add_test (tc, test_switch);
+    tcase_add_test (tc, test_file_changed);
+    tcase_add_test (tc, test_file_changed_same_size);
+    tcase_add_test (tc, test_load_threads);
   }
   tcase_add_unchecked_fixture (tc, test_setup, test_teardown);
 
@@ -203,6 +203,134 @@ GST_START_TEST (test_registry_update)
 
 GST_END_TEST;
 
+GST_START_TEST (test_registry_remove_reload)
+{
+  GstRegistry *registry;
+  GstPlugin *plugin;
+  GstPluginFeature *feature;
+  GstElement *identity;
+  gchar *filename, *description, *longname;
+
+  /* the default registry was loaded from the binary cache, so the strings of
+   * the plugins and features point into the mapped cache file */
+  registry = gst_registry_get_default ();
+
+  plugin = gst_registry_find_plugin (registry, "coreelements");
+  fail_unless (plugin != NULL, "Can't find plugin 'coreelements'");
+  filename = g_strdup (gst_plugin_get_filename (plugin));
+  description = g_strdup (gst_plugin_get_description (plugin));
+  fail_unless (filename != NULL);
+
+  feature = gst_registry_lookup_feature (registry, "identity");
+  fail_unless (feature != NULL, "Can't find plugin feature 'identity'");
+  longname = g_strdup (gst_element_factory_get_longname (GST_ELEMENT_FACTORY
+          (feature)));
+  gst_object_unref (feature);
+
+  /* removing the plugin frees the plugin and its features, which must not
+   * free the strings they reference in the mapping */
+  gst_registry_remove_plugin (registry, plugin);
+  ASSERT_OBJECT_REFCOUNT (plugin, "removed plugin", 1);
+  gst_object_unref (plugin);
+
+  fail_unless (gst_registry_find_plugin (registry, "coreelements") == NULL);
+  fail_unless (gst_registry_lookup_feature (registry, "identity") == NULL);
+
+  /* scanning again reloads the plugin and writes a new cache while the old
+   * one is still mapped */
+  fail_unless (gst_update_registry () != FALSE, "registry update failed");
+
+  plugin = gst_registry_find_plugin (registry, "coreelements");
+  fail_unless (plugin != NULL, "Can't find plugin 'coreelements' again");
+  fail_unless_equals_string (gst_plugin_get_filename (plugin), filename);
+  fail_unless_equals_string (gst_plugin_get_description (plugin),
+      description);
+  gst_object_unref (plugin);
+
+  feature = gst_registry_lookup_feature (registry, "identity");
+  fail_unless (feature != NULL, "Can't find plugin feature 'identity' again");
+  fail_unless_equals_string (gst_element_factory_get_longname
+      (GST_ELEMENT_FACTORY (feature)), longname);
+  gst_object_unref (feature);
+
+  identity = gst_element_factory_make ("identity", NULL);
+  fail_unless (identity != NULL);
+  gst_object_unref (identity);
+
+  g_free (filename);
+  g_free (description);
+  g_free (longname);
+}
+
+GST_END_TEST;
+
+/* returns the sorted names of the plugins found in the test plugin path when
+ * scanning with @workers scanner processes */
+static GList *
+scan_plugin_names (const gchar * path, const gchar * workers)
+{
+  GstRegistry *registry;
+  GList *plugins, *l, *names = NULL;
+
+  g_setenv ("GST_PLUGIN_SCANNER_WORKERS", workers, TRUE);
+
+  registry = g_object_new (GST_TYPE_REGISTRY, NULL);
+  fail_unless (gst_registry_scan_path (registry, path));
+
+  plugins = gst_registry_get_plugin_list (registry);
+  for (l = plugins; l; l = l->next) {
+    GstPlugin *plugin = GST_PLUGIN (l->data);
+
+    print_plugin ("scanned", registry, plugin);
+
+    fail_if (plugin->flags & GST_PLUGIN_FLAG_BLACKLISTED,
+        "plugin %s was blacklisted", gst_plugin_get_filename (plugin));
+    names = g_list_prepend (names, g_strdup (gst_plugin_get_name (plugin)));
+  }
+  gst_plugin_list_free (plugins);
+
+  /* the plugins are added in the order the scanners finish */
+  names = g_list_sort (names, (GCompareFunc) strcmp);
+
+  gst_object_unref (registry);
+  g_unsetenv ("GST_PLUGIN_SCANNER_WORKERS");
+
+  return names;
+}
+
+static void
+free_names (GList * names)
+{
+  g_list_foreach (names, (GFunc) g_free, NULL);
+  g_list_free (names);
+}
+
+GST_START_TEST (test_scan_workers)
+{
+  const gchar *path;
+  GList *single, *pool, *a, *b;
+
+  path = g_getenv ("GST_PLUGIN_PATH");
+  if (path == NULL || !gst_registry_fork_is_enabled ())
+    return;
+
+  single = scan_plugin_names (path, "1");
+  fail_unless (g_list_find_custom (single, "coreelements",
+          (GCompareFunc) strcmp) != NULL);
+
+  /* more scanners than plugin files, all of them load the same plugins */
+  pool = scan_plugin_names (path, "4");
+
+  fail_unless_equals_int (g_list_length (pool), g_list_length (single));
+  for (a = single, b = pool; a && b; a = a->next, b = b->next)
+    fail_unless_equals_string (a->data, b->data);
+
+  free_names (single);
+  free_names (pool);
+}
+
+GST_END_TEST;
+
 static Suite *
 registry_suite (void)
 {
@@ -212,6 +340,8 @@ registry_suite (void)
   suite_add_tcase (s, tc_chain);
 
   tcase_add_test (tc_chain, test_registry_update);
+  tcase_add_test (tc_chain, test_registry_remove_reload);
+  tcase_add_test (tc_chain, test_scan_workers);
 
   return s;
 }
@@ -175,6 +175,80 @@ GST_START_TEST (test_no_lock)
 
 GST_END_TEST;
 
+static gint coop_count;
+
+static void
+task_func_coop (void *data)
+{
+  GstTask *t = *((GstTask **) data);
+
+  g_mutex_lock (task_lock);
+  coop_count++;
+  /* give the thread back instead of waiting for the next resume */
+  fail_unless (gst_task_suspend (t));
+  g_cond_signal (task_cond);
+  g_mutex_unlock (task_lock);
+}
+
+GST_START_TEST (test_cooperative)
+{
+  GstTask *t;
+  gboolean ret;
+  gint i;
+
+  t = gst_task_create (task_func_coop, &t);
+  fail_if (t == NULL);
+
+  gst_task_set_lock (t, &task_mutex);
+  gst_task_set_cooperative (t, TRUE);
+
+  task_cond = g_cond_new ();
+  task_lock = g_mutex_new ();
+  coop_count = 0;
+
+  g_mutex_lock (task_lock);
+  ret = gst_task_start (t);
+  fail_unless (ret == TRUE);
+
+  for (i = 1; i <= 3; i++) {
+    while (coop_count < i)
+      g_cond_wait (task_cond, task_lock);
+    g_mutex_unlock (task_lock);
+
+    /* the suspended task released its lock and is not called again until it
+     * is resumed */
+    g_static_rec_mutex_lock (&task_mutex);
+    g_static_rec_mutex_unlock (&task_mutex);
+    fail_unless (gst_task_get_state (t) == GST_TASK_STARTED);
+
+    g_mutex_lock (task_lock);
+    fail_unless_equals_int (coop_count, i);
+    g_mutex_unlock (task_lock);
+
+    ret = gst_task_resume (t);
+    fail_unless (ret == TRUE);
+    g_mutex_lock (task_lock);
+  }
+  while (coop_count < 4)
+    g_cond_wait (task_cond, task_lock);
+  g_mutex_unlock (task_lock);
+
+  /* joining a suspended task does not wait for anything */
+  ret = gst_task_join (t);
+  fail_unless (ret == TRUE);
+  fail_unless_equals_int (coop_count, 4);
+
+  /* resuming a stopped task does nothing */
+  ret = gst_task_resume (t);
+  fail_unless (ret == TRUE);
+
+  gst_task_cleanup_all ();
+
+  gst_object_unref (t);
+}
+
+GST_END_TEST;
+
 GST_START_TEST (test_create)
 {
   GstTask *t;
@@ -200,6 +274,7 @@ gst_task_suite (void)
   tcase_add_test (tc_chain, test_lock);
   tcase_add_test (tc_chain, test_lock_start);
   tcase_add_test (tc_chain, test_join);
+  tcase_add_test (tc_chain, test_cooperative);
 
   return s;
 }
@@ -70,6 +70,41 @@ GST_START_TEST (test_uri_get_location)
 
 GST_END_TEST;
 
+GST_START_TEST (test_protocol_lookup)
+{
+  GstElement *element;
+  gint i;
+
+  /* unknown protocols and invalid types are never supported, however often
+   * they are asked for */
+  for (i = 0; i < 3; i++) {
+    fail_if (gst_uri_protocol_is_supported (GST_URI_SRC, "nosuchprotocol"));
+    fail_if (gst_uri_protocol_is_supported (GST_URI_SINK, "nosuchprotocol"));
+    fail_if (gst_uri_protocol_is_supported (GST_URI_UNKNOWN, "file"));
+    fail_unless (gst_element_make_from_uri (GST_URI_SRC,
+            "nosuchprotocol://foo", NULL) == NULL);
+  }
+
+  element = gst_element_make_from_uri (GST_URI_SRC, "file:///foo/bar", NULL);
+
+  /* no element? probably no registry, bail out */
+  if (element == NULL)
+    return;
+
+  gst_object_unref (element);
+
+  /* repeated lookups must keep answering from the index */
+  for (i = 0; i < 3; i++) {
+    fail_unless (gst_uri_protocol_is_supported (GST_URI_SRC, "file"));
+    fail_unless (gst_uri_protocol_is_supported (GST_URI_SRC, "FiLe"));
+    element = gst_element_make_from_uri (GST_URI_SRC, "file:///foo/bar", NULL);
+    fail_unless (element != NULL);
+    gst_object_unref (element);
+  }
+}
+
+GST_END_TEST;
+
 #ifdef G_OS_WIN32
 
 GST_START_TEST (test_win32_uri)
@@ -116,6 +151,7 @@ gst_uri_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_protocol_case);
   tcase_add_test (tc_chain, test_uri_get_location);
+  tcase_add_test (tc_chain, test_protocol_lookup);
 #ifdef G_OS_WIN32
   tcase_add_test (tc_chain, test_win32_uri);
 #endif
@@ -596,6 +596,342 @@ GST_START_TEST (basesrc_seek_events_rate_update)
 GST_END_TEST;
 
 
+/* a source that produces its buffers in batches of BATCH_SIZE */
+#define BATCH_SIZE 4
+#define BATCH_DURATION (10 * GST_MSECOND)
+
+typedef GstBaseSrc GstBatchSrc;
+typedef GstBaseSrcClass GstBatchSrcClass;
+
+GType gst_batch_src_get_type (void);
+
+GST_BOILERPLATE (GstBatchSrc, gst_batch_src, GstBaseSrc, GST_TYPE_BASE_SRC);
+
+static GstFlowReturn
+gst_batch_src_create_list (GstBaseSrc * src, guint64 offset, guint size,
+    GstBufferList ** list)
+{
+  GstBufferListIterator *it;
+  gint i;
+
+  *list = gst_buffer_list_new ();
+  it = gst_buffer_list_iterate (*list);
+  for (i = 0; i < BATCH_SIZE; i++) {
+    GstBuffer *buf = gst_buffer_new_and_alloc (size);
+
+    GST_BUFFER_DURATION (buf) = BATCH_DURATION;
+    gst_buffer_list_iterator_add_group (it);
+    gst_buffer_list_iterator_add (it, buf);
+  }
+  gst_buffer_list_iterator_free (it);
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_batch_src_base_init (gpointer g_class)
+{
+  static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+      GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_set_details_simple (element_class, "BatchSrc",
+      "Source/Test", "Produces buffers in batches", "GStreamer");
+}
+
+static void
+gst_batch_src_class_init (GstBatchSrcClass * klass)
+{
+  klass->create_list = gst_batch_src_create_list;
+}
+
+static void
+gst_batch_src_init (GstBatchSrc * src, GstBatchSrcClass * klass)
+{
+  /* only produce in PLAYING, when there is a clock to timestamp against */
+  gst_base_src_set_live (src, TRUE);
+}
+
+static gboolean
+timestamp_collector (GstPad * pad, GstBuffer * buffer, GList ** timestamps)
+{
+  GstClockTime *ts = g_new (GstClockTime, 1);
+
+  *ts = GST_BUFFER_TIMESTAMP (buffer);
+  *timestamps = g_list_append (*timestamps, ts);
+
+  return TRUE;
+}
+
+/* basesrc_create_list:
+ *  - buffers created in batches are pushed one by one and timestamped
+ *    according to their durations with do-timestamp
+ */
+GST_START_TEST (basesrc_create_list)
+{
+  GstElement *src, *sink, *pipe;
+  GstMessage *msg;
+  GstBus *bus;
+  GstPad *srcpad;
+  GList *timestamps = NULL, *walk;
+  GstClockTime prev = GST_CLOCK_TIME_NONE;
+  guint probe, n = 0;
+
+  pipe = gst_pipeline_new ("pipeline");
+  src = g_object_new (gst_batch_src_get_type (), NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+
+  fail_unless (gst_bin_add (GST_BIN (pipe), src) == TRUE);
+  fail_unless (gst_bin_add (GST_BIN (pipe), sink) == TRUE);
+  fail_unless (gst_element_link (src, sink) == TRUE);
+
+  g_object_set (src, "num-buffers", 3 * BATCH_SIZE, "do-timestamp", TRUE,
+      "smooth-timestamps", TRUE, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  srcpad = gst_element_get_static_pad (src, "src");
+  probe = gst_pad_add_buffer_probe (srcpad,
+      G_CALLBACK (timestamp_collector), &timestamps);
+
+  bus = gst_element_get_bus (pipe);
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless (msg != NULL);
+  fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+
+  fail_unless_equals_int (g_list_length (timestamps), 3 * BATCH_SIZE);
+  for (walk = timestamps; walk; walk = g_list_next (walk), n++) {
+    GstClockTime ts = *(GstClockTime *) walk->data;
+
+    fail_unless (GST_CLOCK_TIME_IS_VALID (ts));
+    /* buffers of one batch are spaced by their duration */
+    if (n % BATCH_SIZE != 0)
+      fail_unless_equals_uint64 (ts - prev, BATCH_DURATION);
+    prev = ts;
+    g_free (walk->data);
+  }
+  g_list_free (timestamps);
+
+  gst_pad_remove_buffer_probe (srcpad, probe);
+  gst_object_unref (srcpad);
+  gst_object_unref (bus);
+  gst_object_unref (pipe);
+}
+
+GST_END_TEST;
+
+/* a clock that only advances when the test says so */
+typedef GstClock GstFakeClock;
+typedef GstClockClass GstFakeClockClass;
+
+GType gst_fake_clock_get_type (void);
+
+GST_BOILERPLATE (GstFakeClock, gst_fake_clock, GstClock, GST_TYPE_CLOCK);
+
+static GstClockTime fake_time;
+
+static GstClockTime
+gst_fake_clock_get_internal_time (GstClock * clock)
+{
+  return fake_time;
+}
+
+static void
+gst_fake_clock_base_init (gpointer g_class)
+{
+}
+
+static void
+gst_fake_clock_class_init (GstFakeClockClass * klass)
+{
+  klass->get_internal_time = gst_fake_clock_get_internal_time;
+}
+
+static void
+gst_fake_clock_init (GstFakeClock * clock, GstFakeClockClass * klass)
+{
+}
+
+/* a live source that captures a buffer every JITTER_PERIOD, give or take
+ * JITTER_MAX, and jumps JITTER_JUMP ahead at buffer JITTER_JUMP_AT */
+#define JITTER_BUFFERS 200
+#define JITTER_PERIOD (10 * GST_MSECOND)
+#define JITTER_MAX (2 * GST_MSECOND)
+#define JITTER_JUMP (500 * GST_MSECOND)
+#define JITTER_JUMP_AT 150
+
+typedef GstBaseSrc GstJitterSrc;
+typedef GstBaseSrcClass GstJitterSrcClass;
+
+GType gst_jitter_src_get_type (void);
+
+GST_BOILERPLATE (GstJitterSrc, gst_jitter_src, GstBaseSrc, GST_TYPE_BASE_SRC);
+
+static GstClockTime jitter_start;
+static GstClockTime captured[JITTER_BUFFERS];
+static guint n_captured;
+static GRand *jitter_rand;
+
+static GstFlowReturn
+gst_jitter_src_create (GstBaseSrc * src, guint64 offset, guint size,
+    GstBuffer ** buf)
+{
+  GstClockTime capture;
+
+  fail_unless (n_captured < JITTER_BUFFERS);
+
+  capture = jitter_start + (n_captured + 1) * JITTER_PERIOD +
+      g_rand_int_range (jitter_rand, 0, 2 * JITTER_MAX) - JITTER_MAX;
+  if (n_captured >= JITTER_JUMP_AT)
+    capture += JITTER_JUMP;
+
+  /* the buffer is timestamped with the clock time right after create */
+  fake_time = capture;
+  captured[n_captured++] = capture - GST_ELEMENT_CAST (src)->base_time;
+
+  *buf = gst_buffer_new_and_alloc (size);
+  GST_BUFFER_DURATION (*buf) = JITTER_PERIOD;
+
+  return GST_FLOW_OK;
+}
+
+static void
+gst_jitter_src_base_init (gpointer g_class)
+{
+  static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
+      GST_PAD_SRC, GST_PAD_ALWAYS, GST_STATIC_CAPS_ANY);
+  GstElementClass *element_class = GST_ELEMENT_CLASS (g_class);
+
+  gst_element_class_add_pad_template (element_class,
+      gst_static_pad_template_get (&src_template));
+  gst_element_class_set_details_simple (element_class, "JitterSrc",
+      "Source/Test", "Captures buffers at jittered times", "GStreamer");
+}
+
+static void
+gst_jitter_src_class_init (GstJitterSrcClass * klass)
+{
+  klass->create = gst_jitter_src_create;
+}
+
+static void
+gst_jitter_src_init (GstJitterSrc * src, GstJitterSrcClass * klass)
+{
+  gst_base_src_set_live (src, TRUE);
+}
+
+/* the largest deviation from JITTER_PERIOD of the intervals between the
+ * times in @times from @start to @end */
+static GstClockTime
+max_jitter (GstClockTime * times, guint start, guint end)
+{
+  GstClockTime res = 0, diff;
+  guint i;
+
+  for (i = MAX (start, 1); i < end; i++) {
+    diff = times[i] - times[i - 1];
+    diff = diff > JITTER_PERIOD ? diff - JITTER_PERIOD : JITTER_PERIOD - diff;
+    res = MAX (res, diff);
+  }
+
+  return res;
+}
+
+/* basesrc_smooth_timestamps:
+ *  - the timestamps of do-timestamp with smooth-timestamps have much less
+ *    jitter than the capture times
+ *  - a capture time that is more than 200 ms off restarts the smoothing
+ */
+GST_START_TEST (basesrc_smooth_timestamps)
+{
+  GstElement *src, *sink, *pipe;
+  GstClock *clock;
+  GstMessage *msg;
+  GstBus *bus;
+  GstPad *srcpad;
+  GList *timestamps = NULL, *walk;
+  GstClockTime smoothed[JITTER_BUFFERS];
+  GstClockTime in_jitter, out_jitter;
+  guint probe, n = 0;
+
+  fake_time = jitter_start = 10 * GST_SECOND;
+  n_captured = 0;
+  jitter_rand = g_rand_new_with_seed (1);
+
+  pipe = gst_pipeline_new ("pipeline");
+  src = g_object_new (gst_jitter_src_get_type (), NULL);
+  sink = gst_element_factory_make ("fakesink", "sink");
+
+  clock = g_object_new (gst_fake_clock_get_type (), NULL);
+  gst_pipeline_use_clock (GST_PIPELINE (pipe), clock);
+
+  fail_unless (gst_bin_add (GST_BIN (pipe), src) == TRUE);
+  fail_unless (gst_bin_add (GST_BIN (pipe), sink) == TRUE);
+  fail_unless (gst_element_link (src, sink) == TRUE);
+
+  g_object_set (src, "num-buffers", JITTER_BUFFERS, "do-timestamp", TRUE,
+      "smooth-timestamps", TRUE, NULL);
+  g_object_set (sink, "sync", FALSE, NULL);
+
+  srcpad = gst_element_get_static_pad (src, "src");
+  probe = gst_pad_add_buffer_probe (srcpad,
+      G_CALLBACK (timestamp_collector), &timestamps);
+
+  bus = gst_element_get_bus (pipe);
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+
+  msg = gst_bus_poll (bus, GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless (msg != NULL);
+  fail_unless (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+
+  fail_unless_equals_int (n_captured, JITTER_BUFFERS);
+  fail_unless_equals_int (g_list_length (timestamps), JITTER_BUFFERS);
+  for (walk = timestamps; walk; walk = g_list_next (walk), n++) {
+    smoothed[n] = *(GstClockTime *) walk->data;
+    fail_unless (GST_CLOCK_TIME_IS_VALID (smoothed[n]));
+    g_free (walk->data);
+  }
+  g_list_free (timestamps);
+
+  /* the loop starts on the first capture time */
+  fail_unless_equals_uint64 (smoothed[0], captured[0]);
+
+  in_jitter = max_jitter (captured, 0, JITTER_JUMP_AT);
+  out_jitter = max_jitter (smoothed, 0, JITTER_JUMP_AT);
+  GST_DEBUG ("jitter before the jump %" GST_TIME_FORMAT " -> %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (in_jitter), GST_TIME_ARGS (out_jitter));
+  fail_unless (in_jitter > JITTER_MAX);
+  fail_unless (out_jitter < in_jitter / 4);
+
+  /* the jump is too big to smooth, the loop restarts on the capture time */
+  fail_unless_equals_uint64 (smoothed[JITTER_JUMP_AT],
+      captured[JITTER_JUMP_AT]);
+
+  in_jitter = max_jitter (captured, JITTER_JUMP_AT + 1, JITTER_BUFFERS);
+  out_jitter = max_jitter (smoothed, JITTER_JUMP_AT + 1, JITTER_BUFFERS);
+  GST_DEBUG ("jitter after the jump %" GST_TIME_FORMAT " -> %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (in_jitter), GST_TIME_ARGS (out_jitter));
+  fail_unless (out_jitter < in_jitter / 4);
+
+  gst_pad_remove_buffer_probe (srcpad, probe);
+  gst_object_unref (srcpad);
+  gst_object_unref (bus);
+  gst_object_unref (clock);
+  gst_object_unref (pipe);
+  g_rand_free (jitter_rand);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_basesrc_suite (void)
 {
@@ -610,6 +946,8 @@ gst_basesrc_suite (void)
   tcase_add_test (tc, basesrc_eos_events_push_live_eos);
   tcase_add_test (tc, basesrc_eos_events_pull_live_eos);
   tcase_add_test (tc, basesrc_seek_events_rate_update);
+  tcase_add_test (tc, basesrc_create_list);
+  tcase_add_test (tc, basesrc_smooth_timestamps);
 
   return s;
 }
@@ -1260,6 +1260,167 @@ GST_START_TEST (basetransform_chain_ct3)
 
 GST_END_TEST;
 
+static GstFlowReturn
+transform_ip_parallel (GstBaseTransform * trans, GstBuffer * buf)
+{
+  /* make later buffers finish before earlier ones */
+  g_usleep ((10 - GST_BUFFER_OFFSET (buf) % 10) * 1000);
+
+  return GST_FLOW_OK;
+}
+
+/* buffers transformed in the thread pool are pushed in order */
+GST_START_TEST (basetransform_chain_parallel)
+{
+  TestTransData *trans;
+  GstBuffer *buffer;
+  GstFlowReturn res;
+  gint i;
+
+  klass_transform_ip = transform_ip_parallel;
+  trans = gst_test_trans_new ();
+
+  gst_base_transform_set_max_threads (GST_BASE_TRANSFORM (trans->trans), 4);
+  fail_unless (gst_base_transform_get_max_threads (GST_BASE_TRANSFORM
+          (trans->trans)) == 4);
+
+  for (i = 0; i < 20; i++) {
+    buffer = gst_buffer_new_and_alloc (20);
+    GST_BUFFER_OFFSET (buffer) = i;
+    res = gst_test_trans_push (trans, buffer);
+    fail_unless (res == GST_FLOW_OK);
+  }
+
+  /* going back to one thread pushes the pending buffers */
+  gst_base_transform_set_max_threads (GST_BASE_TRANSFORM (trans->trans), 1);
+
+  for (i = 0; i < 20; i++) {
+    buffer = gst_test_trans_pop (trans);
+    fail_unless (buffer != NULL);
+    fail_unless_equals_int (GST_BUFFER_OFFSET (buffer), i);
+    fail_unless (GST_BUFFER_SIZE (buffer) == 20);
+    gst_buffer_unref (buffer);
+  }
+  fail_unless (gst_test_trans_pop (trans) == NULL);
+
+  gst_test_trans_free (trans);
+}
+
+GST_END_TEST;
+
+static gboolean
+upstream_latency_query (GstPad * pad, GstQuery * query)
+{
+  if (GST_QUERY_TYPE (query) != GST_QUERY_LATENCY)
+    return FALSE;
+
+  gst_query_set_latency (query, TRUE, 5 * GST_MSECOND, 20 * GST_MSECOND);
+
+  return TRUE;
+}
+
+/* a transformed buffer is pushed without waiting for more input and the
+ * thread pool adds to the latency */
+GST_START_TEST (basetransform_chain_parallel_latency)
+{
+  TestTransData *trans;
+  GstBuffer *buffer;
+  GstFlowReturn res;
+  GstQuery *query;
+  GstPad *srcpad;
+  GstClockTime min, max;
+  gboolean live;
+  gint i;
+
+  klass_transform_ip = transform_ip_parallel;
+  trans = gst_test_trans_new ();
+  gst_pad_set_query_function (trans->srcpad, upstream_latency_query);
+
+  gst_base_transform_set_max_threads (GST_BASE_TRANSFORM (trans->trans), 4);
+
+  buffer = gst_buffer_new_and_alloc (20);
+  GST_BUFFER_OFFSET (buffer) = 0;
+  GST_BUFFER_DURATION (buffer) = 10 * GST_MSECOND;
+  res = gst_test_trans_push (trans, buffer);
+  fail_unless (res == GST_FLOW_OK);
+
+  /* the thread pool pushes it */
+  for (i = 0; i < 500; i++) {
+    if (g_atomic_pointer_get ((gpointer *) & trans->buffers) != NULL)
+      break;
+    g_usleep (10 * 1000);
+  }
+
+  buffer = gst_test_trans_pop (trans);
+  fail_unless (buffer != NULL);
+  fail_unless_equals_int (GST_BUFFER_OFFSET (buffer), 0);
+  gst_buffer_unref (buffer);
+
+  /* a buffer can wait for three others of 10ms */
+  query = gst_query_new_latency ();
+  srcpad = gst_element_get_static_pad (trans->trans, "src");
+  fail_unless (gst_pad_query (srcpad, query));
+  gst_object_unref (srcpad);
+  gst_query_parse_latency (query, &live, &min, &max);
+  fail_unless (live);
+  fail_unless_equals_uint64 (min, 35 * GST_MSECOND);
+  fail_unless_equals_uint64 (max, 50 * GST_MSECOND);
+  gst_query_unref (query);
+
+  gst_base_transform_set_max_threads (GST_BASE_TRANSFORM (trans->trans), 1);
+  fail_unless (gst_test_trans_pop (trans) == NULL);
+
+  gst_test_trans_free (trans);
+}
+
+GST_END_TEST;
+
+/* graded QoS lowers the quality level when late and raises it slowly */
+GST_START_TEST (basetransform_qos_quality)
+{
+  TestTransData *trans;
+  GstBaseTransform *base;
+  gint i;
+
+  klass_transform_ip = transform_ip_1;
+  trans = gst_test_trans_new ();
+  base = GST_BASE_TRANSFORM (trans->trans);
+
+  /* one level by default */
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 0);
+
+  gst_base_transform_set_qos_enabled (base, TRUE);
+  gst_base_transform_set_quality_levels (base, 3);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 2);
+
+  gst_base_transform_update_qos (base, 1.5, 10 * GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 1);
+  gst_base_transform_update_qos (base, 1.5, 10 * GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 0);
+  gst_base_transform_update_qos (base, 1.5, 10 * GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 0);
+
+  /* on time but no headroom, no change */
+  for (i = 0; i < 20; i++)
+    gst_base_transform_update_qos (base, 0.95, -GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 0);
+
+  for (i = 0; i < 7; i++)
+    gst_base_transform_update_qos (base, 0.5, -GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 0);
+  gst_base_transform_update_qos (base, 0.5, -GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 1);
+
+  /* without QoS the level is not changed */
+  gst_base_transform_set_qos_enabled (base, FALSE);
+  gst_base_transform_update_qos (base, 1.5, 10 * GST_MSECOND, GST_SECOND);
+  fail_unless_equals_int (gst_base_transform_get_quality (base), 1);
+
+  gst_test_trans_free (trans);
+}
+
+GST_END_TEST;
+
 static Suite *
 gst_basetransform_suite (void)
 {
@@ -1274,6 +1435,9 @@ gst_basetransform_suite (void)
   tcase_add_test (tc, basetransform_chain_ct1);
   tcase_add_test (tc, basetransform_chain_ct2);
   tcase_add_test (tc, basetransform_chain_ct3);
+  tcase_add_test (tc, basetransform_chain_parallel);
+  tcase_add_test (tc, basetransform_chain_parallel_latency);
+  tcase_add_test (tc, basetransform_qos_quality);
 
   return s;
 }
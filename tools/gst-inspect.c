@@ -34,9 +34,14 @@
 #include <glib/gprintf.h>
 
 static char *_name = NULL;
+static gboolean registry_only = FALSE;
+static gboolean json_output = FALSE;
 
 static int print_element_info (GstElementFactory * factory,
     gboolean print_names);
+static int print_element_registry_info (GstElementFactory * factory,
+    gboolean print_names);
+static void print_element_json (GstElementFactory * factory);
 
 static void
 n_print (const char *format, ...)
@@ -613,7 +618,9 @@ print_pad_templates_info (GstElement * element, GstElementFactory * factory)
     return;
   }
 
-  gstelement_class = GST_ELEMENT_CLASS (G_OBJECT_GET_CLASS (element));
+  /* without an element we only know what the registry knows */
+  gstelement_class =
+      element ? GST_ELEMENT_CLASS (G_OBJECT_GET_CLASS (element)) : NULL;
 
   pads = factory->staticpadtemplates;
   while (pads) {
@@ -633,8 +640,9 @@ print_pad_templates_info (GstElement * element, GstElementFactory * factory)
       n_print ("    Availability: Sometimes\n");
     else if (padtemplate->presence == GST_PAD_REQUEST) {
       n_print ("    Availability: On request\n");
-      n_print ("      Has request_new_pad() function: %s\n",
-          GST_DEBUG_FUNCPTR_NAME (gstelement_class->request_new_pad));
+      if (gstelement_class)
+        n_print ("      Has request_new_pad() function: %s\n",
+            GST_DEBUG_FUNCPTR_NAME (gstelement_class->request_new_pad));
     } else
       n_print ("    Availability: UNKNOWN!!!\n");
 
@@ -1094,7 +1102,20 @@ print_all_uri_handlers (void)
     for (f = features; f; f = f->next) {
       GstPluginFeature *feature = GST_PLUGIN_FEATURE (f->data);
 
-      if (GST_IS_ELEMENT_FACTORY (feature)) {
+      if (GST_IS_ELEMENT_FACTORY (feature) && registry_only) {
+        GstElementFactory *factory = GST_ELEMENT_FACTORY (feature);
+        gchar *joined;
+
+        if (!GST_URI_TYPE_IS_VALID (factory->uri_type))
+          continue;
+
+        joined = factory->uri_protocols ?
+            g_strjoinv (", ", factory->uri_protocols) : g_strdup ("");
+        g_print ("%s (%s, rank %u): %s\n", GST_PLUGIN_FEATURE_NAME (factory),
+            factory->uri_type == GST_URI_SRC ? "read" : "write",
+            gst_plugin_feature_get_rank (feature), joined);
+        g_free (joined);
+      } else if (GST_IS_ELEMENT_FACTORY (feature)) {
         GstElementFactory *factory;
         GstElement *element;
 
@@ -1268,6 +1289,13 @@ print_element_info (GstElementFactory * factory, gboolean print_names)
   GstElement *element;
   gint maxlevel = 0;
 
+  if (json_output) {
+    print_element_json (factory);
+    return 0;
+  }
+  if (registry_only)
+    return print_element_registry_info (factory, print_names);
+
   factory =
       GST_ELEMENT_FACTORY (gst_plugin_feature_load (GST_PLUGIN_FEATURE
           (factory)));
@@ -1321,6 +1349,465 @@ print_element_info (GstElementFactory * factory, gboolean print_names)
 }
 
 
+/* registry only inspection, all of this only uses what the registry knows
+ * about the factories and never loads a plugin */
+
+static void
+print_factory_interfaces_info (GstElementFactory * factory)
+{
+  GList *walk;
+
+  if (!factory->interfaces)
+    return;
+
+  n_print (_("Implemented Interfaces:\n"));
+  for (walk = factory->interfaces; walk; walk = walk->next)
+    n_print ("  %s\n", (gchar *) walk->data);
+  n_print ("\n");
+}
+
+static void
+print_factory_uri_handler_info (GstElementFactory * factory)
+{
+  const gchar *uri_type;
+  gchar **uri_protocols;
+
+  if (!GST_URI_TYPE_IS_VALID (factory->uri_type)) {
+    n_print ("Element has no URI handling capabilities.\n");
+    return;
+  }
+
+  uri_type = factory->uri_type == GST_URI_SRC ? "source" : "sink";
+  uri_protocols = factory->uri_protocols;
+
+  n_print ("\n");
+  n_print ("URI handling capabilities:\n");
+  n_print ("  Element can act as %s.\n", uri_type);
+
+  if (uri_protocols && *uri_protocols) {
+    n_print ("  Supported URI protocols:\n");
+    for (; *uri_protocols != NULL; uri_protocols++)
+      n_print ("    %s\n", *uri_protocols);
+  } else {
+    n_print ("  No supported URI protocols\n");
+  }
+}
+
+static int
+print_element_registry_info (GstElementFactory * factory, gboolean print_names)
+{
+  if (print_names)
+    _name = g_strdup_printf ("%s: ", GST_PLUGIN_FEATURE (factory)->name);
+  else
+    _name = NULL;
+
+  print_factory_details_info (factory);
+  if (GST_PLUGIN_FEATURE (factory)->plugin_name) {
+    GstPlugin *plugin;
+
+    plugin = gst_registry_find_plugin (gst_registry_get_default (),
+        GST_PLUGIN_FEATURE (factory)->plugin_name);
+    if (plugin) {
+      print_plugin_info (plugin);
+      gst_object_unref (plugin);
+    }
+  }
+
+  print_factory_interfaces_info (factory);
+  print_pad_templates_info (NULL, factory);
+  print_factory_uri_handler_info (factory);
+
+  g_free (_name);
+  _name = NULL;
+
+  return 0;
+}
+
+static void
+json_append_string (GString * json, const gchar * str)
+{
+  if (str == NULL) {
+    g_string_append (json, "null");
+    return;
+  }
+
+  g_string_append_c (json, '"');
+  for (; *str; str++) {
+    guchar c = *str;
+
+    switch (c) {
+      case '"':
+        g_string_append (json, "\\\"");
+        break;
+      case '\\':
+        g_string_append (json, "\\\\");
+        break;
+      case '\n':
+        g_string_append (json, "\\n");
+        break;
+      case '\t':
+        g_string_append (json, "\\t");
+        break;
+      default:
+        if (c < 0x20)
+          g_string_append_printf (json, "\\u%04x", c);
+        else
+          g_string_append_c (json, c);
+        break;
+    }
+  }
+  g_string_append_c (json, '"');
+}
+
+/* prints the registry information of @factory as one line of JSON */
+static void
+print_element_json (GstElementFactory * factory)
+{
+  static const gchar *directions[] = { "unknown", "src", "sink" };
+  static const gchar *presences[] = { "always", "sometimes", "request" };
+  GstPluginFeature *feature = GST_PLUGIN_FEATURE (factory);
+  GString *json;
+  GList *walk;
+
+  json = g_string_new ("{\"name\": ");
+  json_append_string (json, feature->name);
+  g_string_append (json, ", \"plugin\": ");
+  json_append_string (json, feature->plugin_name);
+  g_string_append (json, ", \"long-name\": ");
+  json_append_string (json, factory->details.longname);
+  g_string_append (json, ", \"klass\": ");
+  json_append_string (json, factory->details.klass);
+  g_string_append (json, ", \"description\": ");
+  json_append_string (json, factory->details.description);
+  g_string_append (json, ", \"author\": ");
+  json_append_string (json, factory->details.author);
+  g_string_append_printf (json, ", \"rank\": %u", feature->rank);
+
+  g_string_append (json, ", \"interfaces\": [");
+  for (walk = factory->interfaces; walk; walk = walk->next) {
+    if (walk != factory->interfaces)
+      g_string_append (json, ", ");
+    json_append_string (json, walk->data);
+  }
+
+  g_string_append (json, "], \"pad-templates\": [");
+  for (walk = factory->staticpadtemplates; walk; walk = walk->next) {
+    GstStaticPadTemplate *templ = walk->data;
+
+    if (walk != factory->staticpadtemplates)
+      g_string_append (json, ", ");
+    g_string_append (json, "{\"name-template\": ");
+    json_append_string (json, templ->name_template);
+    g_string_append (json, ", \"direction\": ");
+    json_append_string (json, directions[CLAMP (templ->direction, 0, 2)]);
+    g_string_append (json, ", \"presence\": ");
+    json_append_string (json, presences[CLAMP (templ->presence, 0, 2)]);
+    g_string_append (json, ", \"caps\": ");
+    json_append_string (json, templ->static_caps.string);
+    g_string_append_c (json, '}');
+  }
+  g_string_append (json, "]");
+
+  if (GST_URI_TYPE_IS_VALID (factory->uri_type)) {
+    gchar **protocols;
+
+    g_string_append (json, ", \"uri-type\": ");
+    json_append_string (json,
+        factory->uri_type == GST_URI_SRC ? "src" : "sink");
+    g_string_append (json, ", \"uri-protocols\": [");
+    for (protocols = factory->uri_protocols; protocols && *protocols;
+        protocols++) {
+      if (protocols != factory->uri_protocols)
+        g_string_append (json, ", ");
+      json_append_string (json, *protocols);
+    }
+    g_string_append (json, "]");
+  }
+  g_string_append_c (json, '}');
+
+  g_print ("%s\n", json->str);
+  g_string_free (json, TRUE);
+}
+
+/* a single KEY=VALUE term of a --query */
+typedef enum
+{
+  QUERY_NAME,
+  QUERY_PLUGIN,
+  QUERY_KLASS,
+  QUERY_SINK_CAPS,
+  QUERY_SRC_CAPS,
+  QUERY_URI_PROTOCOL,
+  QUERY_URI_TYPE,
+  QUERY_INTERFACE,
+  QUERY_RANK
+} QueryKey;
+
+typedef struct
+{
+  QueryKey key;
+  gchar *value;
+  GstCaps *caps;
+  GPatternSpec *pattern;
+  gint rank;
+  GstURIType uri_type;
+} QueryTerm;
+
+static gboolean
+query_key_from_string (const gchar * str, QueryKey * key)
+{
+  if (!strcmp (str, "name"))
+    *key = QUERY_NAME;
+  else if (!strcmp (str, "plugin"))
+    *key = QUERY_PLUGIN;
+  else if (!strcmp (str, "klass"))
+    *key = QUERY_KLASS;
+  else if (!strcmp (str, "sink-caps"))
+    *key = QUERY_SINK_CAPS;
+  else if (!strcmp (str, "src-caps"))
+    *key = QUERY_SRC_CAPS;
+  else if (!strcmp (str, "uri-protocol"))
+    *key = QUERY_URI_PROTOCOL;
+  else if (!strcmp (str, "uri-type"))
+    *key = QUERY_URI_TYPE;
+  else if (!strcmp (str, "interface"))
+    *key = QUERY_INTERFACE;
+  else if (!strcmp (str, "rank"))
+    *key = QUERY_RANK;
+  else
+    return FALSE;
+
+  return TRUE;
+}
+
+static gboolean
+parse_rank (const gchar * str, gint * rank)
+{
+  gchar *end;
+
+  if (!g_ascii_strcasecmp (str, "none"))
+    *rank = GST_RANK_NONE;
+  else if (!g_ascii_strcasecmp (str, "marginal"))
+    *rank = GST_RANK_MARGINAL;
+  else if (!g_ascii_strcasecmp (str, "secondary"))
+    *rank = GST_RANK_SECONDARY;
+  else if (!g_ascii_strcasecmp (str, "primary"))
+    *rank = GST_RANK_PRIMARY;
+  else {
+    *rank = strtol (str, &end, 10);
+    if (end == str || *end != '\0')
+      return FALSE;
+  }
+  return TRUE;
+}
+
+static void
+query_term_free (QueryTerm * term)
+{
+  g_free (term->value);
+  if (term->caps)
+    gst_caps_unref (term->caps);
+  if (term->pattern)
+    g_pattern_spec_free (term->pattern);
+  g_free (term);
+}
+
+static QueryTerm *
+query_term_parse (const gchar * str)
+{
+  QueryTerm *term;
+  const gchar *eq;
+  gchar *key;
+  gboolean known;
+
+  if (!(eq = strchr (str, '=')))
+    goto no_value;
+
+  term = g_new0 (QueryTerm, 1);
+  term->value = g_strdup (eq + 1);
+
+  key = g_strndup (str, eq - str);
+  known = query_key_from_string (key, &term->key);
+  g_free (key);
+  if (!known)
+    goto unknown_key;
+
+  switch (term->key) {
+    case QUERY_NAME:
+      term->pattern = g_pattern_spec_new (term->value);
+      break;
+    case QUERY_SINK_CAPS:
+    case QUERY_SRC_CAPS:
+      if (!(term->caps = gst_caps_from_string (term->value)))
+        goto invalid_value;
+      break;
+    case QUERY_URI_TYPE:
+      if (!strcmp (term->value, "src"))
+        term->uri_type = GST_URI_SRC;
+      else if (!strcmp (term->value, "sink"))
+        term->uri_type = GST_URI_SINK;
+      else
+        goto invalid_value;
+      break;
+    case QUERY_RANK:
+      if (!parse_rank (term->value, &term->rank))
+        goto invalid_value;
+      break;
+    default:
+      break;
+  }
+  return term;
+
+  /* ERRORS */
+no_value:
+  {
+    g_printerr (_("Query term '%s' is not of the form KEY=VALUE\n"), str);
+    return NULL;
+  }
+unknown_key:
+  {
+    g_printerr (_("Unknown query key in '%s'\n"), str);
+    query_term_free (term);
+    return NULL;
+  }
+invalid_value:
+  {
+    g_printerr (_("Invalid value in query term '%s'\n"), str);
+    query_term_free (term);
+    return NULL;
+  }
+}
+
+/* all components of the klass value must be in the factory klass, like
+ * "Decoder/Video" */
+static gboolean
+klass_matches (const gchar * klass, const gchar * value)
+{
+  gchar **parts, **part;
+  gboolean res = TRUE;
+
+  if (klass == NULL)
+    return FALSE;
+
+  parts = g_strsplit (value, "/", -1);
+  for (part = parts; *part && res; part++)
+    res = strstr (klass, *part) != NULL;
+  g_strfreev (parts);
+
+  return res;
+}
+
+static gboolean
+templates_can_intersect (GstElementFactory * factory, GstPadDirection dir,
+    const GstCaps * caps)
+{
+  GList *walk;
+
+  for (walk = factory->staticpadtemplates; walk; walk = walk->next) {
+    GstStaticPadTemplate *templ = walk->data;
+    GstCaps *templ_caps;
+    gboolean res;
+
+    if (templ->direction != dir)
+      continue;
+
+    templ_caps = gst_static_caps_get (&templ->static_caps);
+    res = gst_caps_can_intersect (templ_caps, caps);
+    gst_caps_unref (templ_caps);
+    if (res)
+      return TRUE;
+  }
+  return FALSE;
+}
+
+static gboolean
+query_term_matches (QueryTerm * term, GstElementFactory * factory)
+{
+  GstPluginFeature *feature = GST_PLUGIN_FEATURE (factory);
+
+  switch (term->key) {
+    case QUERY_NAME:
+      return g_pattern_match_string (term->pattern, feature->name);
+    case QUERY_PLUGIN:
+      return feature->plugin_name &&
+          !strcmp (feature->plugin_name, term->value);
+    case QUERY_KLASS:
+      return klass_matches (factory->details.klass, term->value);
+    case QUERY_SINK_CAPS:
+      return templates_can_intersect (factory, GST_PAD_SINK, term->caps);
+    case QUERY_SRC_CAPS:
+      return templates_can_intersect (factory, GST_PAD_SRC, term->caps);
+    case QUERY_URI_PROTOCOL:
+    {
+      gchar **protocols;
+
+      if (!GST_URI_TYPE_IS_VALID (factory->uri_type))
+        return FALSE;
+      for (protocols = factory->uri_protocols; protocols && *protocols;
+          protocols++) {
+        if (!g_ascii_strcasecmp (*protocols, term->value))
+          return TRUE;
+      }
+      return FALSE;
+    }
+    case QUERY_URI_TYPE:
+      return factory->uri_type == term->uri_type;
+    case QUERY_INTERFACE:
+      return g_list_find_custom (factory->interfaces, term->value,
+          (GCompareFunc) strcmp) != NULL;
+    case QUERY_RANK:
+      return (gint) feature->rank >= term->rank;
+  }
+  return FALSE;
+}
+
+/* prints the element factories that match all terms in @query, returns the
+ * number of matches or -1 if the query is invalid */
+static gint
+print_query_results (gchar ** query, gboolean as_json)
+{
+  GList *terms = NULL, *factories, *walk, *t;
+  gint count = 0;
+
+  for (; *query; query++) {
+    QueryTerm *term;
+
+    if (!(term = query_term_parse (*query))) {
+      g_list_foreach (terms, (GFunc) query_term_free, NULL);
+      g_list_free (terms);
+      return -1;
+    }
+    terms = g_list_append (terms, term);
+  }
+
+  factories = gst_registry_get_feature_list (gst_registry_get_default (),
+      GST_TYPE_ELEMENT_FACTORY);
+  for (walk = factories; walk; walk = walk->next) {
+    GstElementFactory *factory = GST_ELEMENT_FACTORY (walk->data);
+
+    for (t = terms; t; t = t->next) {
+      if (!query_term_matches (t->data, factory))
+        break;
+    }
+    if (t != NULL)
+      continue;
+
+    if (as_json)
+      print_element_json (factory);
+    else
+      g_print ("%s:  %s: %s\n", GST_PLUGIN_FEATURE (factory)->plugin_name,
+          GST_PLUGIN_FEATURE_NAME (factory),
+          gst_element_factory_get_longname (factory));
+    count++;
+  }
+  gst_plugin_feature_list_free (factories);
+
+  g_list_foreach (terms, (GFunc) query_term_free, NULL);
+  g_list_free (terms);
+
+  return count;
+}
+
 static void
 print_plugin_automatic_install_info_codecs (GstElementFactory * factory)
 {
@@ -1471,6 +1958,7 @@ main (int argc, char *argv[])
   gboolean plugin_name = FALSE;
   gboolean print_aii = FALSE;
   gboolean uri_handlers = FALSE;
+  gchar **query = NULL;
 #ifndef GST_DISABLE_OPTION_PARSING
   GOptionEntry options[] = {
     {"print-all", 'a', 0, G_OPTION_ARG_NONE, &print_all,
@@ -1488,6 +1976,20 @@ main (int argc, char *argv[])
           N_
           ("Print supported URI schemes, with the elements that implement them"),
         NULL},
+    {"registry-only", 'r', 0, G_OPTION_ARG_NONE, &registry_only,
+          N_("Only print what the registry knows about elements, without "
+              "loading any plugins"),
+        NULL},
+    {"json", '\0', 0, G_OPTION_ARG_NONE, &json_output,
+          N_("Print element information as JSON, one element per line. "
+              "Implies --registry-only"),
+        NULL},
+    {"query", 'Q', 0, G_OPTION_ARG_STRING_ARRAY, &query,
+          N_("List the elements matching KEY=VALUE, where KEY is one of name, "
+              "plugin, klass, sink-caps, src-caps, uri-protocol, uri-type, "
+              "interface or rank. Can be given multiple times, elements must "
+              "match all of them. Implies --registry-only"),
+        N_("KEY=VALUE")},
     GST_TOOLS_GOPTION_VERSION,
     {NULL}
   };
@@ -1530,8 +2032,26 @@ main (int argc, char *argv[])
     exit (1);
   }
 
+  if (query && argc > 1) {
+    g_print ("--query requires no extra arguments\n");
+    exit (1);
+  }
+
+  if (json_output || query)
+    registry_only = TRUE;
+
   /* if no arguments, print out list of elements */
-  if (uri_handlers) {
+  if (query) {
+    gint count = print_query_results (query, json_output);
+
+    g_strfreev (query);
+    if (count < 0)
+      return 1;
+  } else if (json_output && argc == 1) {
+    gchar *all[] = { NULL };
+
+    print_query_results (all, TRUE);
+  } else if (uri_handlers) {
     print_all_uri_handlers ();
   } else if (argc == 1 || print_all) {
     if (do_print_blacklist)
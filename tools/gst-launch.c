@@ -39,6 +39,10 @@
 #ifndef DISABLE_FAULT_HANDLER
 #include <sys/wait.h>
 #endif
+#ifndef HAVE_WIN32
+#include <sys/time.h>
+#include <sys/resource.h>
+#endif
 #include <locale.h>             /* for LC_ALL */
 #include "tools.h"
 
@@ -311,6 +315,461 @@ print_tag (const GstTagList * list, const gchar * tag, gpointer unused)
   }
 }
 
+/* statistics for --stats. Buffer probes on all pads count buffers and bytes
+ * and measure, per element, the time and thread CPU time from a buffer
+ * entering the element to the next buffer leaving it in the same thread.
+ * Streaming threads are found through stream-status messages, QoS drops
+ * through QoS messages, both handled in a sync handler. */
+typedef struct
+{
+  gchar *name;
+  guint64 buffers;
+  guint64 bytes;
+} PadStats;
+
+typedef struct _ThreadStats ThreadStats;
+
+typedef struct
+{
+  gchar *name;
+  GPtrArray *pads;
+
+  /* last buffer that entered the element */
+  ThreadStats *in_thread;
+  GstClockTime in_time;
+  GstClockTime in_cpu;
+
+  /* processing, from a buffer in to the next buffer out */
+  guint64 processed;
+  GstClockTime latency_total;
+  GstClockTime latency_max;
+  GstClockTime cpu;
+
+  /* queue levels, if the element has them */
+  gboolean is_queue;
+  gboolean have_levels;
+  guint level_buffers_min, level_buffers_max;
+  guint level_bytes_min, level_bytes_max;
+
+  /* from QoS messages */
+  guint64 qos_processed;
+  guint64 qos_dropped;
+} ElementStats;
+
+struct _ThreadStats
+{
+  gchar *owner;
+  gboolean running;
+  GstClockTime cpu;
+};
+
+static gboolean stats = FALSE;
+static gint stats_interval = 0;
+static GStaticMutex stats_lock = G_STATIC_MUTEX_INIT;
+static GstClockTime stats_start = GST_CLOCK_TIME_NONE;
+/* GstElement -> ElementStats, GThread -> ThreadStats */
+static GHashTable *stats_elements = NULL;
+static GHashTable *stats_threads = NULL;
+/* ElementStats in the order the elements were found */
+static GPtrArray *stats_element_list = NULL;
+
+static GstClockTime
+stats_thread_cpu_time (void)
+{
+#ifdef RUSAGE_THREAD
+  struct rusage ru;
+
+  if (getrusage (RUSAGE_THREAD, &ru) == 0)
+    return GST_TIMEVAL_TO_TIME (ru.ru_utime) +
+        GST_TIMEVAL_TO_TIME (ru.ru_stime);
+#endif
+  return 0;
+}
+
+/* with stats_lock, returns the stats of the calling thread */
+static ThreadStats *
+stats_get_thread (void)
+{
+  GThread *self = g_thread_self ();
+  ThreadStats *ts;
+
+  if (!(ts = g_hash_table_lookup (stats_threads, self))) {
+    ts = g_new0 (ThreadStats, 1);
+    ts->running = TRUE;
+    g_hash_table_insert (stats_threads, self, ts);
+  }
+  ts->cpu = stats_thread_cpu_time ();
+
+  return ts;
+}
+
+/* with stats_lock */
+static ElementStats *
+stats_get_element (GstElement * element)
+{
+  ElementStats *es;
+
+  if (!(es = g_hash_table_lookup (stats_elements, element))) {
+    GObjectClass *klass = G_OBJECT_GET_CLASS (element);
+
+    es = g_new0 (ElementStats, 1);
+    es->name = gst_object_get_path_string (GST_OBJECT_CAST (element));
+    es->pads = g_ptr_array_new ();
+    es->in_time = GST_CLOCK_TIME_NONE;
+    es->is_queue = g_object_class_find_property (klass, "current-level-buffers")
+        && g_object_class_find_property (klass, "current-level-bytes");
+    g_hash_table_insert (stats_elements, element, es);
+    g_ptr_array_add (stats_element_list, es);
+  }
+  return es;
+}
+
+static gboolean
+stats_buffer_probe (GstPad * pad, GstBuffer * buffer, PadStats * ps)
+{
+  GstElement *element;
+  ElementStats *es;
+  ThreadStats *ts;
+  GstClockTime now;
+  guint level_buffers = 0, level_bytes = 0;
+
+  if (!GST_IS_BUFFER (buffer))
+    return TRUE;
+
+  if (!(element = GST_PAD_PARENT (pad)))
+    return TRUE;
+  now = gst_util_get_timestamp ();
+
+  g_static_mutex_lock (&stats_lock);
+  es = stats_get_element (element);
+  g_static_mutex_unlock (&stats_lock);
+
+  /* the queue lock is not held when buffers go in or out, read the levels
+   * without holding our lock */
+  if (es->is_queue)
+    g_object_get (element, "current-level-buffers", &level_buffers,
+        "current-level-bytes", &level_bytes, NULL);
+
+  g_static_mutex_lock (&stats_lock);
+  ts = stats_get_thread ();
+
+  ps->buffers++;
+  ps->bytes += GST_BUFFER_SIZE (buffer);
+
+  if (GST_PAD_IS_SINK (pad)) {
+    es->in_thread = ts;
+    es->in_time = now;
+    es->in_cpu = ts->cpu;
+  } else if (es->in_thread == ts) {
+    GstClockTime latency = now - es->in_time;
+
+    es->processed++;
+    es->latency_total += latency;
+    es->latency_max = MAX (es->latency_max, latency);
+    es->cpu += ts->cpu - es->in_cpu;
+    es->in_thread = NULL;
+  }
+
+  if (es->is_queue) {
+    if (!es->have_levels) {
+      es->level_buffers_min = es->level_buffers_max = level_buffers;
+      es->level_bytes_min = es->level_bytes_max = level_bytes;
+      es->have_levels = TRUE;
+    } else {
+      es->level_buffers_min = MIN (es->level_buffers_min, level_buffers);
+      es->level_buffers_max = MAX (es->level_buffers_max, level_buffers);
+      es->level_bytes_min = MIN (es->level_bytes_min, level_bytes);
+      es->level_bytes_max = MAX (es->level_bytes_max, level_bytes);
+    }
+  }
+  g_static_mutex_unlock (&stats_lock);
+
+  return TRUE;
+}
+
+static void
+stats_hook_pad (GstElement * element, GstPad * pad, gpointer user_data)
+{
+  ElementStats *es;
+  PadStats *ps;
+
+  ps = g_new0 (PadStats, 1);
+  ps->name = gst_pad_get_name (pad);
+
+  g_static_mutex_lock (&stats_lock);
+  es = stats_get_element (element);
+  g_ptr_array_add (es->pads, ps);
+  g_static_mutex_unlock (&stats_lock);
+
+  gst_pad_add_buffer_probe (pad, G_CALLBACK (stats_buffer_probe), ps);
+}
+
+/* hooks the pads of @element, or the children when it is a bin */
+static void
+stats_hook_element (GstBin * bin, GstElement * element, gpointer user_data)
+{
+  GList *children, *walk;
+
+  GST_OBJECT_LOCK (element);
+  if (GST_IS_BIN (element)) {
+    children = g_list_copy (GST_BIN_CHILDREN (element));
+  } else {
+    children = g_list_copy (GST_ELEMENT_PADS (element));
+  }
+  g_list_foreach (children, (GFunc) gst_object_ref, NULL);
+  GST_OBJECT_UNLOCK (element);
+
+  for (walk = children; walk; walk = walk->next) {
+    if (GST_IS_BIN (element))
+      stats_hook_element (GST_BIN_CAST (element), walk->data, NULL);
+    else
+      stats_hook_pad (element, walk->data, NULL);
+    gst_object_unref (walk->data);
+  }
+  g_list_free (children);
+
+  /* the ghost pads of bins only proxy the pads of the children */
+  if (GST_IS_BIN (element)) {
+    g_signal_connect (element, "element-added",
+        G_CALLBACK (stats_hook_element), NULL);
+  } else {
+    g_signal_connect (element, "pad-added", G_CALLBACK (stats_hook_pad), NULL);
+  }
+}
+
+static GstBusSyncReply
+stats_sync_handler (GstBus * bus, GstMessage * message, gpointer user_data)
+{
+  switch (GST_MESSAGE_TYPE (message)) {
+    case GST_MESSAGE_STREAM_STATUS:
+    {
+      GstStreamStatusType type;
+      GstElement *owner;
+      ThreadStats *ts;
+
+      /* enter and leave are posted from the streaming thread itself */
+      gst_message_parse_stream_status (message, &type, &owner);
+      if (type != GST_STREAM_STATUS_TYPE_ENTER &&
+          type != GST_STREAM_STATUS_TYPE_LEAVE)
+        break;
+
+      g_static_mutex_lock (&stats_lock);
+      ts = stats_get_thread ();
+      if (type == GST_STREAM_STATUS_TYPE_ENTER) {
+        g_free (ts->owner);
+        ts->owner = gst_object_get_path_string (GST_OBJECT_CAST (owner));
+        ts->running = TRUE;
+      } else {
+        ts->running = FALSE;
+      }
+      g_static_mutex_unlock (&stats_lock);
+      break;
+    }
+    case GST_MESSAGE_QOS:
+    {
+      GstFormat format;
+      guint64 processed, dropped;
+      ElementStats *es;
+
+      if (!GST_IS_ELEMENT (GST_MESSAGE_SRC (message)))
+        break;
+
+      /* the stats in the message are totals */
+      gst_message_parse_qos_stats (message, &format, &processed, &dropped);
+
+      g_static_mutex_lock (&stats_lock);
+      es = stats_get_element (GST_ELEMENT_CAST (GST_MESSAGE_SRC (message)));
+      es->qos_processed = processed;
+      es->qos_dropped = dropped;
+      g_static_mutex_unlock (&stats_lock);
+      break;
+    }
+    default:
+      break;
+  }
+  return GST_BUS_PASS;
+}
+
+static void
+stats_setup (GstElement * pipeline)
+{
+  GstBus *bus;
+
+  stats_elements = g_hash_table_new (NULL, NULL);
+  stats_threads = g_hash_table_new (NULL, NULL);
+  stats_element_list = g_ptr_array_new ();
+
+  stats_hook_element (NULL, pipeline, NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  gst_bus_set_sync_handler (bus, stats_sync_handler, NULL);
+  gst_object_unref (bus);
+
+  stats_start = gst_util_get_timestamp ();
+}
+
+static void
+stats_append_json_string (GString * json, const gchar * str)
+{
+  g_string_append_c (json, '"');
+  for (; *str; str++) {
+    if (*str == '"' || *str == '\\')
+      g_string_append_c (json, '\\');
+    g_string_append_c (json, *str);
+  }
+  g_string_append_c (json, '"');
+}
+
+/* prints the statistics collected so far as one line of JSON */
+static gboolean
+stats_print_json (gpointer user_data)
+{
+  GString *json;
+  GHashTableIter iter;
+  gpointer value;
+  guint i, j;
+
+  json = g_string_new (NULL);
+
+  g_static_mutex_lock (&stats_lock);
+  g_string_append_printf (json, "{\"time\": %" G_GUINT64_FORMAT
+      ", \"threads\": [", gst_util_get_timestamp () - stats_start);
+  i = 0;
+  g_hash_table_iter_init (&iter, stats_threads);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    ThreadStats *ts = value;
+
+    g_string_append_printf (json, "%s{\"owner\": ", i++ ? ", " : "");
+    if (ts->owner)
+      stats_append_json_string (json, ts->owner);
+    else
+      g_string_append (json, "null");
+    g_string_append_printf (json, ", \"running\": %s, \"cpu\": %"
+        G_GUINT64_FORMAT "}", ts->running ? "true" : "false", ts->cpu);
+  }
+  g_string_append (json, "], \"elements\": [");
+  for (i = 0; i < stats_element_list->len; i++) {
+    ElementStats *es = g_ptr_array_index (stats_element_list, i);
+
+    g_string_append_printf (json, "%s{\"name\": ", i ? ", " : "");
+    stats_append_json_string (json, es->name);
+    g_string_append_printf (json, ", \"processed\": %" G_GUINT64_FORMAT
+        ", \"cpu\": %" G_GUINT64_FORMAT ", \"latency-avg\": %"
+        G_GUINT64_FORMAT ", \"latency-max\": %" G_GUINT64_FORMAT
+        ", \"qos-processed\": %" G_GUINT64_FORMAT ", \"qos-dropped\": %"
+        G_GUINT64_FORMAT, es->processed, es->cpu,
+        es->processed ? es->latency_total / es->processed : 0,
+        es->latency_max, es->qos_processed, es->qos_dropped);
+    if (es->have_levels) {
+      g_string_append_printf (json, ", \"level-buffers-min\": %u"
+          ", \"level-buffers-max\": %u, \"level-bytes-min\": %u"
+          ", \"level-bytes-max\": %u", es->level_buffers_min,
+          es->level_buffers_max, es->level_bytes_min, es->level_bytes_max);
+    }
+    g_string_append (json, ", \"pads\": [");
+    for (j = 0; j < es->pads->len; j++) {
+      PadStats *ps = g_ptr_array_index (es->pads, j);
+
+      g_string_append_printf (json, "%s{\"name\": ", j ? ", " : "");
+      stats_append_json_string (json, ps->name);
+      g_string_append_printf (json, ", \"buffers\": %" G_GUINT64_FORMAT
+          ", \"bytes\": %" G_GUINT64_FORMAT "}", ps->buffers, ps->bytes);
+    }
+    g_string_append (json, "]}");
+  }
+  g_string_append (json, "]}");
+  g_static_mutex_unlock (&stats_lock);
+
+  g_print ("%s\n", json->str);
+  g_string_free (json, TRUE);
+
+  return TRUE;
+}
+
+static void
+stats_print (void)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint i, j;
+
+  g_static_mutex_lock (&stats_lock);
+
+  g_print (_("Statistics:\n"));
+  for (i = 0; i < stats_element_list->len; i++) {
+    ElementStats *es = g_ptr_array_index (stats_element_list, i);
+
+    g_print ("  %s\n", es->name);
+    for (j = 0; j < es->pads->len; j++) {
+      PadStats *ps = g_ptr_array_index (es->pads, j);
+
+      g_print (_("    pad %s: %" G_GUINT64_FORMAT " buffers, %"
+              G_GUINT64_FORMAT " bytes\n"), ps->name, ps->buffers, ps->bytes);
+    }
+    if (es->processed) {
+      g_print (_("    processing: %" G_GUINT64_FORMAT " buffers, cpu %"
+              GST_TIME_FORMAT ", latency avg %" GST_TIME_FORMAT ", max %"
+              GST_TIME_FORMAT "\n"), es->processed, GST_TIME_ARGS (es->cpu),
+          GST_TIME_ARGS (es->latency_total / es->processed),
+          GST_TIME_ARGS (es->latency_max));
+    }
+    if (es->have_levels) {
+      g_print (_("    level: %u - %u buffers, %u - %u bytes\n"),
+          es->level_buffers_min, es->level_buffers_max, es->level_bytes_min,
+          es->level_bytes_max);
+    }
+    if (es->qos_processed || es->qos_dropped) {
+      g_print (_("    qos: %" G_GUINT64_FORMAT " processed, %"
+              G_GUINT64_FORMAT " dropped\n"), es->qos_processed,
+          es->qos_dropped);
+    }
+  }
+
+  g_print (_("  threads: %u\n"), g_hash_table_size (stats_threads));
+  g_hash_table_iter_init (&iter, stats_threads);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    ThreadStats *ts = value;
+
+    g_print (_("    %s: cpu %" GST_TIME_FORMAT "\n"),
+        ts->owner ? ts->owner : _("(unknown)"), GST_TIME_ARGS (ts->cpu));
+  }
+
+  g_static_mutex_unlock (&stats_lock);
+}
+
+static void
+stats_free (void)
+{
+  GHashTableIter iter;
+  gpointer value;
+  guint i, j;
+
+  for (i = 0; i < stats_element_list->len; i++) {
+    ElementStats *es = g_ptr_array_index (stats_element_list, i);
+
+    for (j = 0; j < es->pads->len; j++) {
+      PadStats *ps = g_ptr_array_index (es->pads, j);
+
+      g_free (ps->name);
+      g_free (ps);
+    }
+    g_ptr_array_free (es->pads, TRUE);
+    g_free (es->name);
+    g_free (es);
+  }
+  g_ptr_array_free (stats_element_list, TRUE);
+  g_hash_table_destroy (stats_elements);
+
+  g_hash_table_iter_init (&iter, stats_threads);
+  while (g_hash_table_iter_next (&iter, NULL, &value)) {
+    ThreadStats *ts = value;
+
+    g_free (ts->owner);
+    g_free (ts);
+  }
+  g_hash_table_destroy (stats_threads);
+}
+
 #ifndef DISABLE_FAULT_HANDLER
 /* we only use sighandler here because the registers are not important */
 static void
@@ -715,6 +1174,12 @@ main (int argc, char *argv[])
         N_("Print alloc trace (if enabled at compile time)"), NULL},
     {"eos-on-shutdown", 'e', 0, G_OPTION_ARG_NONE, &eos_on_shutdown,
         N_("Force EOS on sources before shutting the pipeline down"), NULL},
+    {"stats", '\0', 0, G_OPTION_ARG_NONE, &stats,
+        N_("Print buffer, processing, queue level, QoS and thread statistics"),
+        NULL},
+    {"stats-interval", '\0', 0, G_OPTION_ARG_INT, &stats_interval,
+        N_("Also print the statistics as JSON every MSECS milliseconds"),
+        N_("MSECS")},
     GST_TOOLS_GOPTION_VERSION,
     {NULL}
   };
@@ -724,6 +1189,7 @@ main (int argc, char *argv[])
   gchar **argvn;
   GError *error = NULL;
   gint res = 0;
+  guint stats_timeout_id = 0;
 
   free (malloc (8));            /* -lefence */
 
@@ -839,6 +1305,15 @@ main (int argc, char *argv[])
       gst_bin_add (GST_BIN (real_pipeline), pipeline);
       pipeline = real_pipeline;
     }
+
+    if (stats || stats_interval > 0) {
+      stats = TRUE;
+      stats_setup (pipeline);
+      if (stats_interval > 0)
+        stats_timeout_id = g_timeout_add (stats_interval, stats_print_json,
+            NULL);
+    }
+
     PRINT (_("Setting pipeline to PAUSED ...\n"));
     ret = gst_element_set_state (pipeline, GST_STATE_PAUSED);
 
@@ -931,11 +1406,20 @@ main (int argc, char *argv[])
     PRINT (_("Setting pipeline to NULL ...\n"));
     gst_element_set_state (pipeline, GST_STATE_NULL);
     gst_element_get_state (pipeline, &state, &pending, GST_CLOCK_TIME_NONE);
+
+    if (stats) {
+      if (stats_timeout_id)
+        g_source_remove (stats_timeout_id);
+      stats_print ();
+    }
   }
 
   PRINT (_("Freeing pipeline ...\n"));
   gst_object_unref (pipeline);
 
+  if (stats)
+    stats_free ();
+
   gst_deinit ();
   if (trace)
     gst_alloc_trace_print_live ();